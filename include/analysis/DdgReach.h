@@ -0,0 +1,93 @@
+//===- DdgReach.h -- sink reachability index over the data dependence -------//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _DDGREACH_H_
+#define _DDGREACH_H_
+#include "analysis/Dependence.h"
+
+/* per SCC of the EA_DD subgraph */
+struct T_ReachScc
+{
+    DWORD m_Size;
+    bool  m_HasSink;
+    bool  m_SuccReach;    /* a successor SCC reaches a sink */
+};
+
+/*
+   the EA_DD subgraph of a built DgGraph is condensed into SCCs, an SCC reaches a
+   sink when it holds one or a successor SCC reaches one. the forward slicing only
+   follows EA_DD edges, so a source that can not reach a sink here has no sink in
+   its forward slice.
+*/
+class DdgReach
+{
+typedef std::set<DgNode*> DgNodeSet;
+
+private:
+    DgGraph *m_Dg;
+    DgNodeSet *m_Sinks;
+
+    std::vector<DWORD> m_NodeToScc;      /* node id -> scc id */
+    std::vector<T_ReachScc> m_Scc;
+
+    DWORD m_BuildTime;
+    DWORD m_ReachNum;
+
+public:
+    DdgReach (DgGraph *Dg, DgNodeSet *Sinks)
+    {
+        m_Dg    = Dg;
+        m_Sinks = Sinks;
+
+        m_BuildTime = 0;
+        m_ReachNum  = 0;
+
+        Build ();
+    }
+
+    ~DdgReach ()
+    {
+    }
+
+    /* Node reaches a sink through one edge at least, as ForwardDfs requires */
+    inline bool CanReach (DgNode *Node)
+    {
+        DWORD Id = Node->GetId ();
+        if (Id >= m_NodeToScc.size ())
+        {
+            return true;
+        }
+
+        T_ReachScc &Scc = m_Scc[m_NodeToScc[Id]];
+        return (Scc.m_SuccReach || (Scc.m_HasSink && Scc.m_Size > 1));
+    }
+
+    VOID PrintStat ();
+
+private:
+    VOID Build ();
+
+    inline bool IsReachScc (DWORD SccId)
+    {
+        return (m_Scc[SccId].m_HasSink || m_Scc[SccId].m_SuccReach);
+    }
+};
+
+#endif
@@ -32,32 +32,58 @@
 #include <llvm/ADT/STLExtras.h>	
 #include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/SparseBitVector.h>
+#include <llvm/ADT/BitVector.h>
 #include "llvm/IR/Instructions.h"
 #include "common/BasicMacro.h"
+#include "common/Checkpoint.h"
 #include "callgraph/GenericGraph.h"
 #include "callgraph/CallGraph.h"
 #include "graphviz/GraphViz.h"
 
 
 class DgNode;
+class DgSnapshot;
+
+/* the build phase an edge was first added by */
+typedef enum
+{
+    EO_CFG    = 0,
+    EO_INTRA  = 1,
+    EO_INTER  = 2,
+    EO_GLOBAL = 3,
+}EDGE_ORIGIN;
 
 class DgEdge : public GenericEdge<DgNode> 
 {
 private:
-
+    DWORD m_Origin;
 
 public:
     /// Constructor
     DgEdge(DgNode* s, DgNode* d, DWORD Attr=EA_CFG):GenericEdge<DgNode>(s, d, Attr)                       
     {
+        m_Origin = EO_CFG;
     }
 
     ~DgEdge() 
     {
-    }    
+    }
+
+    inline VOID SetOrigin (DWORD Origin)
+    {
+        m_Origin = Origin;
+    }
+
+    inline DWORD GetOrigin ()
+    {
+        return m_Origin;
+    }
 };
 
-class DgNode : public GenericNode<DgEdge> 
+/* cfg and dd edges are kept apart: traversals only walk one kind at a time */
+#define DG_EDGE_KINDS (EA_CFG|EA_DD)
+
+class DgNode : public GenericNode<DgEdge, DG_EDGE_KINDS> 
 {
 public:
     typedef std::set<llvm::Instruction*> T_InstSet;  
@@ -66,6 +92,7 @@ public:
 
 private:
     llvm::Instruction* m_Inst;
+    llvm::Value* m_Global;
     DefUse *m_DefUse;
         
     T_DefIdSet m_InSet;  
@@ -76,9 +103,11 @@ private:
 
 public:
     
-    DgNode(DWORD Id,  llvm::Instruction* Inst) : GenericNode<DgEdge>(Id)
+    /* a hub has no instruction: it stands for all defs and uses of Global */
+    DgNode(DWORD Id,  llvm::Instruction* Inst, llvm::Value* Global = NULL) : GenericNode<DgEdge, DG_EDGE_KINDS>(Id)
     {
         m_Inst    = Inst;
+        m_Global  = Global;
         m_DefUse  = NULL;
         m_KillSet = NULL;
     }
@@ -156,14 +185,24 @@ public:
         return m_Inst;
     }
 
+    inline BOOL IsHub () const
+    {
+        return (m_Inst == NULL);
+    }
+
+    inline llvm::Value* GetGlobal() const 
+    {
+        return m_Global;
+    }
+
     inline llvm::BasicBlock* GetBasicBlock() const 
     {
-        return m_Inst->getParent ();
+        return (m_Inst != NULL) ? m_Inst->getParent () : NULL;
     }
 
     inline llvm::Function* GetFunction() const 
     {
-        return m_Inst->getParent ()->getParent ();
+        return (m_Inst != NULL) ? m_Inst->getParent ()->getParent () : NULL;
     }
 
     inline VOID SetDefUse (DefUse *Du)
@@ -235,6 +274,65 @@ struct T_DefVal
 };
 
 
+/* one edge the inter-procedure pass tried to add for a call site */
+struct T_InterEdge
+{
+    DgNode *m_CsNode;
+    DgNode *m_Src;
+    DgNode *m_Dst;
+    DWORD m_Attr;
+    llvm::Value *m_Value;
+
+    T_InterEdge (DgNode *CsNode, DgNode *Src, DgNode *Dst, DWORD Attr, llvm::Value *Value)
+    {
+        m_CsNode = CsNode;
+        m_Src    = Src;
+        m_Dst    = Dst;
+        m_Attr   = Attr;
+        m_Value  = Value;
+    }
+};
+
+/* what a callee exposes to its call sites, computed once per callee */
+struct T_CalleeSum
+{
+    BOOL m_HasPDef;                    /* defines through a pointer para */
+    std::vector<DgNode*> m_FpNode;     /* formal no -> node storing the formal */
+    DgNode *m_RetNode;
+
+    T_CalleeSum ()
+    {
+        m_HasPDef = AF_FALSE;
+        m_RetNode = NULL;
+    }
+};
+
+/* the nodes of a caller by what they use, and the blocks each block reaches: the uses
+   a call site flows to are looked up, not walked once per call site */
+struct T_CallerIndex
+{
+    std::map<std::pair<llvm::Value*, T_ElemOffset>, std::vector<DgNode*>> m_GepUse;  /* <base, offset> of a gep */
+    llvm::DenseMap<llvm::Value*, std::vector<DgNode*>> m_ValUse;                   /* other uses, pointer uses excluded */
+
+    llvm::DenseMap<llvm::BasicBlock*, DWORD> m_BbIdx;
+    llvm::DenseMap<llvm::BasicBlock*, DWORD> m_BbToScc;
+    std::vector<llvm::BitVector> m_SccReach;          /* blocks reached by one edge or more from a block of the scc */
+    llvm::DenseMap<llvm::Instruction*, DWORD> m_InstPos;
+
+    /* Inst runs after CsInst in the caller */
+    inline BOOL IsAfter (llvm::Instruction *CsInst, llvm::Instruction *Inst)
+    {
+        auto It = m_BbToScc.find (CsInst->getParent ());
+        if (It != m_BbToScc.end () && m_SccReach[It->second].test (m_BbIdx[Inst->getParent ()]))
+        {
+            return AF_TRUE;
+        }
+
+        return (Inst->getParent () == CsInst->getParent () && m_InstPos[Inst] > m_InstPos[CsInst]);
+    }
+};
+
+
 class DgGraph;
 
 class FuncDg
@@ -310,6 +408,7 @@ public:
     /* data dependence */
     VOID ReachingDefs ();
     VOID BuildDdg ();
+    VOID ReleaseDdg ();
 
     FuncDg (DgGraph *Dg, llvm::Function *Function, T_InstVector* CallsiteSet)
     {
@@ -435,7 +534,39 @@ private:
 
     std::set<llvm::Function*> m_UpdatePtsFunc;
 
+    /* (function, call-path context) already updated, see CallGraph::DFSNode */
+    std::set<std::pair<llvm::Function*, ULONG>> m_UpdatePtsCtx;
+    DWORD m_PtsVisitNum;
+    DWORD m_PtsReplayNum;
+
     std::set<llvm::Value*> m_ValueSet;
+
+    /* origin stamped on new edges, and the inter-procedure log kept for the snapshot */
+    DWORD m_Origin;
+    DgNode *m_OriginCs;
+    BOOL m_IsLogInter;
+    std::vector<T_InterEdge> m_InterLog;
+
+    /* ms of the last full ddg build */
+    DWORD m_DdgTime;
+
+    /* per-callee summaries for the inter-procedure pass */
+    llvm::DenseMap<llvm::Function*, T_CalleeSum> m_CalleeSum;
+    llvm::DenseMap<llvm::Function*, T_CallerIndex> m_CallerIndex;
+
+    /* lazy mode: functions are materialized when a traversal enters them */
+    BOOL m_IsLazy;
+    BOOL m_IsRef;
+    DWORD m_LazyFuncNum;
+    DWORD m_LazyTotal;
+    DWORD m_LazyTime;
+    std::set<llvm::Function*> m_ExpandFunc;
+    llvm::DenseMap<llvm::Instruction*, std::set<DgNode*>*> m_WatchInst;
+    llvm::DenseMap<llvm::Value*, std::vector<llvm::Instruction*>> m_GlobUseInst;
+
+    /* global hubs: defs -> hub -> uses instead of an edge per def-use pair */
+    BOOL m_IsGlobHub;
+    llvm::DenseMap<llvm::Value*, DgNode*> m_GlobToHub;
     
     DWORD GetInstNum (); 
 
@@ -445,9 +576,13 @@ private:
 
     VOID BuildDdg ();
     VOID BuildIntraDdg ();
+    static VOID IntraDdgTask (VOID *Ctx, llvm::Function *Func);
     VOID BuildInterDdg ();
+    VOID RelateCallSite (DgNode *CsNode, CallGraphEdgeSet *CgEdgeSet);
     VOID RelateFpRet(FuncDg* Fdg, DgNode *CsNode, Function *Callee);
     VOID RelateActPara(FuncDg* Fdg, DgNode *CsNode);
+    T_CallerIndex* GetCallerIndex (llvm::Function *Caller);
+    T_CalleeSum* GetCalleeSum (FuncDg *Fdg);
     
     llvm::Value* GetFpByAp(llvm::ImmutableCallSite &Cs, llvm::Function* Func, llvm::Value* Actual);
 
@@ -467,15 +602,66 @@ private:
 
     VOID DumpCfgWeight();
 
-public:
-    DgGraph(ModuleManage &ModMng)
+    BOOL LoadDgGraph ();
+    VOID StoreDgGraph ();
+
+    /* incremental ddg against the snapshot of an older input */
+    BOOL BuildIncrDdg ();
+    VOID VerifyIncrDdg ();
+    VOID GetDirtyFunc (DgSnapshot &Snapshot, std::set<llvm::Function*> &Dirty);
+    VOID GetDirtyCaller (DgSnapshot &Snapshot, std::set<llvm::Function*> &Dirty, 
+                         std::set<llvm::Function*> &DirtyCaller);
+    BOOL IsRetUnstable (llvm::Function *Func);
+
+    /* lazy mode */
+    VOID InitLazy ();
+    FuncDg* Materialize (llvm::Function *Func);
+    VOID Expand (llvm::Function *Func);
+    VOID GetLinkPair (FuncDg *Fdg, std::vector<std::pair<DgNode*, FuncDg*>> &LinkPair);
+    VOID LinkCallSite (DgNode *CsNode, FuncDg *CalleeFdg);
+    VOID LinkGlobalDd (FuncDg *Fdg);
+    VOID GetNeighbor (llvm::Function *Func, std::vector<llvm::Function*> &Neighbor);
+
+    inline VOID SetOrigin (DWORD Origin, DgNode *CsNode = NULL)
     {
-        m_NodeNum = 0;
+        m_Origin   = Origin;
+        m_OriginCs = m_IsLogInter ? CsNode : NULL;
+    }
+
+public:
+    /* a reference graph is built eagerly without hubs and never touches a snapshot */
+    DgGraph(ModuleManage &ModMng, BOOL IsRef = AF_FALSE)
+    {
+        m_NodeNum  = 0;
+        m_DdgTime  = 0;
+        m_PtsVisitNum  = 0;
+        m_PtsReplayNum = 0;
+        m_Origin   = EO_CFG;
+        m_OriginCs = NULL;
+        m_IsRef      = IsRef;
+        m_IsLogInter = !IsRef && (llaf::GetParaValue (PARA_DDG_SNAPSHOT) != "" || Checkpoint::GetStorePath (CK_DDG) != "");
+        m_IsLazy     = !IsRef && (llaf::GetParaValue (PARA_LAZY_DDG) == "1" || llaf::GetParaValue (PARA_LAZY_DDG) == "verify");
+        m_LazyFuncNum = 0;
+        m_LazyTotal   = 0;
+        m_LazyTime    = 0;
+        m_IsGlobHub   = (!IsRef && !m_IsLazy && llaf::GetParaValue (PARA_GLOBAL_HUB) == "1");
         
         m_CallGraph = new CallGraph (ModMng);
         //m_CallGraph->PrintCg ();
-        
-        BuildDgGraph();
+
+        if (m_IsLazy)
+        {
+            InitLazy ();
+        }
+        else if (IsRef)
+        {
+            BuildDgGraph();
+        }
+        else if (!LoadDgGraph ())
+        {
+            BuildDgGraph();
+            StoreDgGraph ();
+        }
     }
     
     ~DgGraph() 
@@ -512,24 +698,39 @@ public:
         AddNode(m_NodeNum, Node);
         
         m_InstToNode[Inst] = Node;
+
+        if (m_IsLazy)
+        {
+            auto It = m_WatchInst.find (Inst);
+            if (It != m_WatchInst.end ())
+            {
+                It->second->insert (Node);
+            }
+        }
     
         return Node;
     }
     
-    inline VOID AddDdgEdge (DgNode *Src, DgNode *Dst, llvm::Value *Val)
+    inline DgNode* AddHubNode (llvm::Value *Global)
     {
-        DgEdge *Edge = new DgEdge(Src, Dst, EA_DD);
-        if (!AddEdge(Edge, Val))
-        {
-            delete Edge;
-        }
+        DgNode* Node = new DgNode (++m_NodeNum, NULL, Global);
     
-        return;
+        AddNode(m_NodeNum, Node);
+
+        m_GlobToHub[Global] = Node;
+    
+        return Node;
     }
 
-    inline VOID AddDdgCallEdge (DgNode *Src, DgNode *Dst, llvm::Value *Val)
+    inline VOID AddDgEdge (DgNode *Src, DgNode *Dst, DWORD Attr, llvm::Value *Val = NULL)
     {
-        DgEdge *Edge = new DgEdge(Src, Dst, EA_DD|EA_CALL);
+        if (m_OriginCs != NULL)
+        {
+            m_InterLog.push_back (T_InterEdge (m_OriginCs, Src, Dst, Attr, Val));
+        }
+
+        DgEdge *Edge = new DgEdge(Src, Dst, Attr);
+        Edge->SetOrigin (m_Origin);
         if (!AddEdge(Edge, Val))
         {
             delete Edge;
@@ -538,59 +739,88 @@ public:
         return;
     }
 
+    inline VOID AddDdgEdge (DgNode *Src, DgNode *Dst, llvm::Value *Val)
+    {
+        AddDgEdge (Src, Dst, EA_DD, Val);
+    }
+
+    inline VOID AddDdgCallEdge (DgNode *Src, DgNode *Dst, llvm::Value *Val)
+    {
+        AddDgEdge (Src, Dst, EA_DD|EA_CALL, Val);
+    }
+
     inline VOID AddDdgRetEdge (DgNode *Src, DgNode *Dst, llvm::Value *Val)
     {
-        DgEdge *Edge = new DgEdge(Src, Dst, EA_DD|EA_RET);
-        if (!AddEdge(Edge, Val))
-        {
-            delete Edge;
-        }
-    
-        return;
+        AddDgEdge (Src, Dst, EA_DD|EA_RET, Val);
     }
 
     inline VOID AddCfgEdge (DgNode *Src, DgNode *Dst)
     {
-        DgEdge *Edge = new DgEdge(Src, Dst, EA_CFG);
-        if (!AddEdge(Edge))
-        {
-            delete Edge;
-        }
-    
-        return;
+        AddDgEdge (Src, Dst, EA_CFG);
     }
 
     inline VOID AddCfgCallEdge (DgNode *Src, DgNode *Dst)
     {
-        DgEdge *Edge = new DgEdge(Src, Dst, EA_CFG|EA_CALL);
-        if (!AddEdge(Edge))
-        {
-            delete Edge;
-        }
-    
-        return;
+        AddDgEdge (Src, Dst, EA_CFG|EA_CALL);
     }
 
     inline VOID AddCfgRetEdge (DgNode *Src, DgNode *Dst)
     {
-        DgEdge *Edge = new DgEdge(Src, Dst, EA_CFG|EA_RET);
-        if (!AddEdge(Edge))
+        AddDgEdge (Src, Dst, EA_CFG|EA_RET);
+    }
+
+    VOID BuildDgGraph();
+
+    inline BOOL IsGlobHub ()
+    {
+        return m_IsGlobHub;
+    }
+
+    DgNode* GetHubNode (llvm::Value *Global, std::set<llvm::Instruction*> *DefInstSet);
+    VOID PrintHubStat ();
+
+    inline BOOL IsLazy ()
+    {
+        return m_IsLazy;
+    }
+
+    /* a traversal reads the edges of this node: in lazy mode its function and
+       every function it shares an edge with must be materialized */
+    inline VOID ExpandNode (DgNode *Node)
+    {
+        if (m_IsLazy)
         {
-            delete Edge;
+            Expand (Node->GetFunction ());
         }
-    
-        return;
     }
 
-    VOID BuildDgGraph();
+    DgNode* RequireDgNode (llvm::Instruction *Inst);
+    VOID WatchDgNode (llvm::Instruction *Inst, std::set<DgNode*> *NodeSet);
+    VOID PrintLazyStat ();
+    VOID VerifyLazyDdg (ModuleManage &ModMng);
 
-    VOID UpdatePtsByFs(std::vector<Function*> &NodeStack);
+    VOID UpdatePtsByFs(std::vector<Function*> &NodeStack, std::vector<ULONG> &CtxStack);
 
     inline CallGraph *GetCallGraph () 
     {
         return m_CallGraph;
     }
 
+    inline std::vector<T_InterEdge>& GetInterLog ()
+    {
+        return m_InterLog;
+    }
+
+    inline DWORD GetDdgTime ()
+    {
+        return m_DdgTime;
+    }
+
+    inline VOID SetDdgTime (DWORD DdgTime)
+    {
+        m_DdgTime = DdgTime;
+    }
+
     inline set<DWORD>* GetKillSet (DgNode *Node)
     {
         llvm::Function* CurFunc = Node->GetInst ()->getParent ()->getParent ();
@@ -624,6 +854,11 @@ public:
         raw_string_ostream RawStr(str);
 
         RawStr << "N" << Node->GetId () <<"\\n";
+        if (Node->IsHub ())
+        {
+            RawStr << "hub: " << Node->GetGlobal ()->getName ();
+            return RawStr.str();
+        }
         
         InstGraphViz InstGv (Node->GetInst());
         RawStr << InstGv.GetGraphViz ();
@@ -662,6 +897,11 @@ public:
         raw_string_ostream RawStr(str);
 
         RawStr << "N" << Node->GetId () <<"\\n";
+        if (Node->IsHub ())
+        {
+            RawStr << "hub: " << Node->GetGlobal ()->getName ();
+            return RawStr.str();
+        }
         
         InstGraphViz InstGv (Node->GetInst());
         RawStr << InstGv.GetGraphViz ();
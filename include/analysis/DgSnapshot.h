@@ -0,0 +1,233 @@
+//===- DgSnapshot.h -- binary snapshot of the dependence graph ---------------//
+//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _DGSNAPSHOT_H_
+#define _DGSNAPSHOT_H_
+#include "analysis/Dependence.h"
+
+#define DG_SNAPSHOT_MAGIC      (0x47444350)  /* "PCDG" */
+#define DG_SNAPSHOT_VERSION    (6)
+#define SNAP_HUB_FUNC          (0xFFFFFFFF)  /* SnapNode of a global hub, InstOrd: value index */
+
+/*
+   snapshot layout, all sections are 4-byte aligned:
+   SnapHeader | SnapFunc[FuncNum] | SnapNode[NodeNum] | DWORD OutOffset[NodeNum+1] |
+   SnapEdge[EdgeNum] | SnapInter[InterNum] | SnapValue[ValueNum] | CHAR StrTab[StrSize]
+
+   node i of the table is the DgNode with id i+1, its outgoing edges are
+   SnapEdge[OutOffset[i] ... OutOffset[i+1]).
+   SnapInter is the log of every edge the inter-procedure pass tried to add,
+   in order and per call site, duplicates included: an incremental build
+   replays it for the call sites it does not recompute.
+
+   a load maps the file and checks it before any node is created, then creates
+   every node and edge again: it costs a pass over the graph, not a ddg build.
+*/
+
+typedef enum
+{
+    VK_NULL    = 0,
+    VK_INST    = 1,   /* Scope: function index, Index: instruction ordinal */
+    VK_ARG     = 2,   /* Scope: function index, Index: argument number */
+    VK_GLOBAL  = 3,   /* Scope: module id,      Index: name offset */
+    VK_OPERAND = 4,   /* Scope: function index, Index: instruction ordinal, OpNo: operand */
+    VK_USEROP  = 5,   /* Scope: value index of a constant or global user, OpNo: operand */
+}VALUE_KIND;
+
+struct SnapHeader
+{
+    DWORD Magic;
+    DWORD Version;
+    ULONG FingerPrint;
+
+    DWORD FuncNum;
+    DWORD NodeNum;
+    DWORD EdgeNum;
+    DWORD InterNum;
+    DWORD ValueNum;
+    DWORD StrSize;
+    DWORD DdgTime;    /* ms of the last full ddg build */
+    DWORD Reserved;
+};
+
+struct SnapFunc
+{
+    DWORD ModuleId;
+    DWORD NameOff;
+    DWORD InstNum;
+    DWORD Reserved;
+    ULONG BodyHash;
+    ULONG PtsHash;    /* pts of the pointer operands of its loads, stores and calls */
+};
+
+struct SnapNode
+{
+    DWORD FuncIdx;
+    DWORD InstOrd;
+};
+
+struct SnapEdge
+{
+    DWORD DstId;
+    DWORD Attr;
+    DWORD ValIdx;
+    DWORD Origin;
+};
+
+struct SnapInter
+{
+    DWORD CsId;
+    DWORD SrcId;
+    DWORD DstId;
+    DWORD Attr;
+    DWORD ValIdx;
+};
+
+struct SnapValue
+{
+    DWORD Kind;
+    DWORD Scope;
+    DWORD Index;
+    DWORD OpNo;
+};
+
+
+class DgSnapshot
+{
+private:
+    DgGraph *m_Dg;
+    ModuleManage m_ModMng;
+    std::string m_Path;
+
+    llvm::DenseMap<llvm::Module*, DWORD> m_ModuleToId;
+    llvm::DenseMap<llvm::Function*, ULONG> m_FuncToHash;
+    llvm::DenseMap<llvm::Function*, DWORD> m_FuncToIdx;
+    llvm::DenseMap<llvm::Function*, ULONG> m_FuncToPts;
+    llvm::DenseMap<llvm::Value*, DWORD> m_LocalPos;
+    std::set<llvm::Function*> m_PosFuncs;
+
+    /* store side */
+    std::vector<SnapFunc> m_Funcs;
+    std::vector<SnapValue> m_Values;
+    std::string m_StrTab;
+    llvm::DenseMap<llvm::Instruction*, DWORD> m_InstToOrd;
+    llvm::DenseMap<llvm::Value*, DWORD> m_ValueToIdx;
+
+    /* load side */
+    VOID *m_Base;
+    size_t m_Size;
+    const SnapHeader *m_Hdr;
+    const SnapFunc   *m_SFuncs;
+    const SnapNode   *m_SNodes;
+    const DWORD      *m_SOutOff;
+    const SnapEdge   *m_SEdges;
+    const SnapInter  *m_SInters;
+    const SnapValue  *m_SValues;
+    const CHAR       *m_SStrTab;
+
+    std::vector<llvm::Function*> m_IdxToFunc;
+    std::vector<std::vector<llvm::Instruction*>> m_OrdToInst;
+    std::vector<llvm::Value*> m_IdxToValue;
+
+    /* incremental side: snapshot node -> node of the current graph */
+    std::vector<DgNode*> m_SnapToNode;
+    std::vector<std::vector<DWORD>> m_FuncNodes;
+    llvm::DenseMap<DgNode*, std::vector<DWORD>> m_CsToInter;
+    std::set<DgNode*> m_ImportedCs;
+    DWORD m_ImportNum;
+    DWORD m_LostNum;
+
+public:
+    DgSnapshot (DgGraph *Dg, std::string Path)
+    {
+        m_Dg   = Dg;
+        m_Path = Path;
+
+        m_Base = NULL;
+        m_Size = 0;
+        m_Hdr  = NULL;
+
+        m_ImportNum = 0;
+        m_LostNum   = 0;
+
+        for (DWORD Id = 0; Id < m_ModMng.GetModuleNum (); Id++)
+        {
+            m_ModuleToId[m_ModMng.GetModule (Id)] = Id;
+        }
+    }
+
+    ~DgSnapshot ()
+    {
+        Unmap ();
+    }
+
+    BOOL Load ();
+    VOID Store ();
+
+    /* incremental build against a snapshot of an older input */
+    BOOL Open ();
+    BOOL IsFuncSame (llvm::Function *Func);
+    BOOL IsCfgSame (llvm::Function *Func);
+    VOID ImportIntraDdg (llvm::Function *Func);
+    VOID ImportInterDdg (DgNode *CsNode);
+    BOOL VerifyIntraDdg (llvm::Function *Func);
+    BOOL VerifyInterDdg (DgNode *CsNode, std::vector<T_InterEdge*> &Fresh);
+
+    inline DWORD GetDdgTime ()
+    {
+        return (m_Hdr != NULL) ? m_Hdr->DdgTime : 0;
+    }
+
+    inline DWORD GetImportNum ()
+    {
+        return m_ImportNum;
+    }
+
+    inline DWORD GetLostNum ()
+    {
+        return m_LostNum;
+    }
+
+private:
+    ULONG FingerPrint ();
+    ULONG BodyHash (llvm::Function *Func);
+    ULONG PtsHash (llvm::Function *Func);
+    ULONG TargetHash (llvm::Value *Val);
+
+    BOOL Map ();
+    VOID Unmap ();
+    BOOL CheckLayout ();
+
+    DWORD AddString (llvm::StringRef Str);
+    DWORD GetFuncIdx (llvm::Function *Func);
+    DWORD GetValueIdx (llvm::Value *Val);
+
+    llvm::Function* ResolveFunc (DWORD Idx);
+    llvm::Value* ResolveValue (const SnapValue *Sv);
+    VOID ResolveNodes ();
+
+    inline DgNode* GetNode (DWORD SnapId)
+    {
+        return m_SnapToNode[SnapId-1];
+    }
+};
+
+#endif
@@ -26,6 +26,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/CallSite.h"
 #include "common/BasicMacro.h"
+#include "llvmadpt/FuncClass.h"
 
 typedef enum
 {
@@ -38,27 +39,20 @@ typedef enum
     EXT_Cast
 }EXT_TYPE;
 
+/* the external function types come from the interned function classes */
 class ExternalLib 
 {
 private:
-    static std::vector<std::string> m_Normal;
-    static std::vector<std::string> m_Malloc;
-    static std::vector<std::string> m_Realloc;
-    static std::vector<std::string> m_Memcpy;
-    static std::vector<std::string> m_RetArg0;
-    static std::vector<std::string> m_Cast;
-
-
-    std::map<std::string, EXT_TYPE> m_ExtFuncMap;
+    FuncClass *m_FuncClass;
 
     EXT_TYPE m_CacheType;
     
 public:
     
-    ExternalLib()
+    ExternalLib(FuncClass *FClass)
     {
+        m_FuncClass = FClass;
         m_CacheType = EXT_Null;
-        InitExtLib ();
     }
 
     ~ ExternalLib()
@@ -73,38 +67,26 @@ public:
     bool IsRetArg0 ();
     bool IsMemcpy ();
     bool IsCast ();
-
-private:
-
-    EXT_TYPE Search (std::string Str);
-    VOID InitExtLib ();
-
-    
 };
 
 
 class DebugLib 
 {
 private:
-    static std::vector<std::string> m_Debug;
-    std::set<std::string> m_DebugFuncSet;
+    FuncClass *m_FuncClass;
     
 public:
     
-    DebugLib()
+    DebugLib(FuncClass *FClass)
     {
-        InitDebugLib ();
+        m_FuncClass = FClass;
     }
 
     ~ DebugLib()
     {
     }
 
-    bool IsDebugFunction (std::string FuncName);
-
-private:
-
-    VOID InitDebugLib ();
+    bool IsDebugFunction (const llvm::Function *Func);
 };
 
 
@@ -0,0 +1,121 @@
+//===- FreeSum.h -- bottom-up free summaries of the formal parameters -------//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _FREESUM_H_
+#define _FREESUM_H_
+#include "analysis/Dependence.h"
+
+typedef enum
+{
+    FS_NEVER = 0,   /* some path does not free the formal */
+    FS_ALL   = 1,   /* every path from the entry frees it before the return or an exit */
+}FREE_STATE;
+
+struct T_FormalSum
+{
+    DWORD m_Free;       /* FREE_STATE */
+
+    T_FormalSum ()
+    {
+        m_Free = FS_NEVER;
+    }
+};
+
+struct T_FuncSum
+{
+    std::vector<T_FormalSum> m_Formal;
+    bool m_IsDone;
+    bool m_IsClosed;    /* no sink in it or its callees, every path returns */
+
+    T_FuncSum ()
+    {
+        m_IsDone   = false;
+        m_IsClosed = false;
+    }
+};
+
+/*
+   per-function, per-formal summaries of a built DgGraph against a sink set,
+   computed once bottom-up over the call graph: a formal is followed through the
+   local slots it is the only value stored to and the casts of it, a free point is a sink or a
+   call whose callees all free the formal it is passed to. a function in a
+   recursive SCC sees its callees of the same SCC as not summarized.
+*/
+class FreeSum
+{
+typedef std::set<DgNode*> DgNodeSet;
+
+private:
+    DgGraph *m_Dg;
+    DgNodeSet *m_Sinks;
+
+    llvm::DenseMap<llvm::Function*, T_FuncSum> m_FuncSum;
+    llvm::DenseMap<llvm::Function*, std::vector<DgNode*>> m_FuncNodes;
+
+    DWORD m_BuildTime;
+
+public:
+    FreeSum (DgGraph *Dg, DgNodeSet *Sinks)
+    {
+        m_Dg    = Dg;
+        m_Sinks = Sinks;
+
+        m_BuildTime = 0;
+    }
+
+    ~FreeSum ()
+    {
+    }
+
+    VOID Build (DWORD ThreadNum);
+
+    /* nothing on the paths through Func can reach a sink */
+    inline bool IsClosed (llvm::Function *Func)
+    {
+        T_FuncSum *Sum = GetSum (Func);
+        return (Sum != NULL && Sum->m_IsClosed);
+    }
+
+    bool IsFreedByCall (DgNode *CsNode, llvm::Value *Actual);
+
+    VOID PrintStat ();
+
+private:
+    static VOID SumTask (VOID *Ctx, llvm::Function *Func);
+    VOID Summarize (llvm::Function *Func);
+    VOID SummarizeFormal (llvm::Function *Func, llvm::Argument *Formal, T_FormalSum &FSum);
+    bool IsFreePoint (DgNode *Node, llvm::Value *Val);
+    bool IsOnlyStore (DgNode *LoadNode, DgNode *StoreNode);
+    bool IsFreeOnAllPaths (llvm::Function *Func, DgNodeSet &FreePoints);
+    VOID GetCallees (DgNode *CsNode, std::vector<llvm::Function*> &Callees);
+
+    inline T_FuncSum* GetSum (llvm::Function *Func)
+    {
+        auto It = m_FuncSum.find (Func);
+        if (It == m_FuncSum.end () || !It->second.m_IsDone)
+        {
+            return NULL;
+        }
+
+        return &It->second;
+    }
+};
+
+#endif
@@ -0,0 +1,115 @@
+//===- FwdBatch.h -- bit-parallel forward reachability of many sources ------//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _FWDBATCH_H_
+#define _FWDBATCH_H_
+#include "analysis/Dependence.h"
+
+/* a sweep carries FB_WIDTH sources, one bit each in FB_WORDS words per node */
+#define FB_WORDS        (4)
+#define FB_WIDTH        (FB_WORDS * 64)
+
+/* fewer sources are sliced one by one, see PARA_FWD_BATCH */
+#define FB_MIN_SOURCES  (FB_WIDTH)
+
+/*
+   the sources are propagated over the EA_DD edges of a built DgGraph FB_WIDTH at a
+   time, a sink ends a path as in ForwardDfs. the sinks a source reaches here hold
+   every sink its forward slice can reach, ForwardDfs only skips some of them.
+*/
+class FwdBatch
+{
+typedef std::set<DgNode*> DgNodeSet;
+
+private:
+    DgGraph *m_Dg;
+    DgNodeSet *m_Sinks;
+
+    std::vector<DgNode*> m_Nodes;        /* node id -> node */
+    std::vector<bool> m_IsSink;
+
+    std::vector<ULONG> m_Mask;           /* sources reaching a node */
+    std::vector<ULONG> m_SinkMask;       /* sources reaching a sink, not propagated */
+
+    std::map<DgNode*, DWORD> m_SrcNo;
+    std::vector<DgNodeSet> m_ReachSinks; /* per source */
+
+    DWORD m_SweepNum;
+    ULONG m_EdgeNum;
+    DWORD m_Time;
+
+public:
+    FwdBatch (DgGraph *Dg, DgNodeSet *Sinks)
+    {
+        m_Dg    = Dg;
+        m_Sinks = Sinks;
+
+        m_SweepNum = 0;
+        m_EdgeNum  = 0;
+        m_Time     = 0;
+    }
+
+    ~FwdBatch ()
+    {
+    }
+
+    VOID Run (DgNodeSet &Sources);
+
+    /* the sinks reached by a source of Run */
+    inline DgNodeSet* GetReachSinks (DgNode *Source)
+    {
+        auto It = m_SrcNo.find (Source);
+        assert (It != m_SrcNo.end ());
+
+        return &m_ReachSinks[It->second];
+    }
+
+    VOID PrintStat ();
+
+private:
+    VOID Sweep (std::vector<DgNode*> &Sources, DWORD Start, DWORD Num);
+
+    static inline bool IsZero (const ULONG *Mask)
+    {
+        ULONG Bits = 0;
+        for (DWORD W = 0; W < FB_WORDS; W++)
+        {
+            Bits |= Mask[W];
+        }
+        
+        return (Bits == 0);
+    }
+
+    /* Dst |= Src, true if Dst changes */
+    static inline bool Merge (ULONG *Dst, const ULONG *Src)
+    {
+        ULONG Diff = 0;
+        for (DWORD W = 0; W < FB_WORDS; W++)
+        {
+            ULONG New = Dst[W] | Src[W];
+            Diff  |= New ^ Dst[W];
+            Dst[W] = New;
+        }
+
+        return (Diff != 0);
+    }
+};
+
+#endif
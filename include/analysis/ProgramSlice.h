@@ -21,7 +21,10 @@
 #ifndef _PROGRAMSLICE_H_
 #define _PROGRAMSLICE_H_
 #include "common/WorkList.h"
+#include "common/VisitMark.h"
 #include "analysis/Dependence.h"
+#include "analysis/FreeSum.h"
+#include "common/Stat.h"
 
 using namespace std;
 
@@ -31,8 +34,95 @@ typedef enum
     REACH_NONE    = 0,
     REACH_PARITAL = 1,
     REACH_ALL     = 2,  
+    REACH_INCONCLUSIVE = 3,   /* a budget ran out, see ProgramSlice::GetBudgetInfo */
 }REACH_TYPE;
 
+typedef enum
+{
+    BG_NONE  = 0,
+    BG_TIME  = 1,
+    BG_NODES = 2,
+    BG_PATHS = 3,
+    BG_TOTAL = 4,   /* the budget of the whole detection */
+}BUDGET_TYPE;
+
+/* per-source limits and the limit of the whole detection, 0 for no limit */
+struct T_SliceBudget
+{
+    DWORD m_TimeMs;
+    DWORD m_NodeNum;
+    DWORD m_PathNum;
+    DWORD m_TotalMs;
+    DWORD m_TotalStart;   /* wall time the detection started */
+
+    T_SliceBudget ()
+    {
+        m_TimeMs  = 0;
+        m_NodeNum = 0;
+        m_PathNum = 0;
+        m_TotalMs = 0;
+        m_TotalStart = 0;
+    }
+};
+
+/* a node on the explicit stack of the iterative traversals */
+struct T_SliceFrame
+{
+    DgNode *m_Node;
+    DWORD m_Next;       /* next edge of the node to visit */
+    DWORD m_EdgeType;   /* CfgPathDfs: edge kinds to follow */
+
+    T_SliceFrame (DgNode *Node, DWORD EdgeType = 0)
+    {
+        m_Node     = Node;
+        m_Next     = 0;
+        m_EdgeType = EdgeType;
+    }
+};
+
+/* engines of ComputePathReachable, see PARA_PATH_ENGINE */
+typedef enum
+{
+    PE_DFS      = 0,   /* enumerate the cfg paths */
+    PE_DATAFLOW = 1,   /* must-free dataflow */
+    PE_COMPARE  = 2,   /* both, report disagreements, keep the dfs result */
+}PATH_ENGINE;
+
+/* must-free values, ordered: a join takes the max */
+typedef enum
+{
+    MF_MUST   = 0,   /* every path ends in a valid sink, an exit or a cycle */
+    MF_RET    = 1,   /* in a callee: the other paths return to the call site */
+    MF_ESCAPE = 2,   /* some path leaves the slice */
+}MF_VALUE;
+
+typedef enum
+{
+    FC_TOP    = 0,   /* the function of the source and its callers by return */
+    FC_CALLEE = 1,   /* entered by a call edge, the tail returns to the call site */
+    FC_SINK   = 2,   /* value fixed by IsPathValid */
+}FLOW_CTX;
+
+#define MF_NO_RET  (0xFFFFFFFF)
+
+/* a state depends on m_State, or on m_RetState when m_State is a callee returning */
+struct T_FlowDep
+{
+    DWORD m_State;
+    DWORD m_RetState;
+};
+
+/* a cfg node in a context: the slice level, inside a called function, or a sink */
+struct T_FlowState
+{
+    DgNode *m_Node;
+    DWORD m_Ctx;
+    DWORD m_Value;
+    bool m_IsFixed;
+    std::vector<T_FlowDep> m_Deps;
+    std::vector<DWORD> m_Users;
+};
+
 class ProgramSlice 
 {
 typedef set<DgNode*> DgNodeSet;
@@ -47,13 +137,18 @@ private:
     DgNode* m_Root;
     DgGraph *m_Dg;
     
-    DgNodeSet m_ForwardSlice;
+    VisitMark m_ForwardSlice;
     FunctionSet m_FdFuncSet;
 
-    DgNodeSet m_BackwardSlice;
+    VisitMark m_BackwardSlice;
     FunctionSet m_BdFuncSet;
     FunctionSet m_PathFuncSet;
 
+    /* nodes of the backward path in visiting order, the ones from m_BdFlushed on
+       are not in m_BackwardSlice yet */
+    std::vector<DgNode*> m_BdPath;
+    DWORD m_BdFlushed;
+
     FuncToMaxId m_FuncToMaxId;
     
     
@@ -65,11 +160,34 @@ private:
     REACH_TYPE m_ReachType;
 
     
-    ComQueue<DgNode *> m_Queue;
+    MarkQueue<DgNode *> m_Queue;
 
     bool m_ReachOut;
     DWORD m_CrossFuncNum;
 
+    DWORD m_Depth;
+    DWORD m_MaxDepth;
+
+    /* budget: nodes visited by all the traversals, cfg paths completed */
+    T_SliceBudget m_Budget;
+    DWORD m_OverBudget;
+    DWORD m_StartTime;
+    DWORD m_VisitNum;
+    DWORD m_PathNum;
+    const CHAR *m_Stage;
+
+    /* callee summaries: lookups and the ones answered by them, a callee
+       stepped over is looked up once per slice */
+    FreeSum *m_FreeSum;
+    DWORD m_SumLookup;
+    DWORD m_SumHit;
+    llvm::DenseMap<llvm::Function*, bool> m_StepOver;
+
+    /* must-free dataflow */
+    DWORD m_PathEngine;
+    std::vector<T_FlowState> m_Flow;
+    llvm::DenseMap<DgNode*, DWORD> m_FlowIdx[3];
+
 public:
 
     ProgramSlice(DgNode* Root, DgGraph* Dg)
@@ -81,6 +199,26 @@ public:
         m_ReachOut  = false;
 
         m_CrossFuncNum = 0;
+        m_BdFlushed    = 0;
+
+        m_ForwardSlice.Reset (Dg->GetNodeNum () + 1);
+        m_BackwardSlice.Reset (Dg->GetNodeNum () + 1);
+
+        m_Depth    = 0;
+        m_MaxDepth = 0;
+
+        std::string Engine = llaf::GetParaValue (PARA_PATH_ENGINE);
+        m_PathEngine = (Engine == "dataflow") ? PE_DATAFLOW : ((Engine == "compare") ? PE_COMPARE : PE_DFS);
+
+        m_OverBudget = BG_NONE;
+        m_StartTime  = 0;
+        m_VisitNum   = 0;
+        m_PathNum    = 0;
+        m_Stage      = "forward";
+
+        m_FreeSum   = NULL;
+        m_SumLookup = 0;
+        m_SumHit    = 0;
     }
 
     ~ProgramSlice() 
@@ -95,15 +233,49 @@ public:
         return m_ReachType;
     }
 
+    inline VOID SetBudget (T_SliceBudget &Budget)
+    {
+        m_Budget = Budget;
+    }
+
+    inline DWORD GetOverBudget ()
+    {
+        return m_OverBudget;
+    }
+
+    std::string GetBudgetInfo ();
+
+    inline VOID SetFreeSum (FreeSum *Fs)
+    {
+        m_FreeSum = Fs;
+    }
+
+    inline DWORD GetSumLookup ()
+    {
+        return m_SumLookup;
+    }
+
+    inline DWORD GetSumHit ()
+    {
+        return m_SumHit;
+    }
+
+    /* deepest traversal stack of the slice, in nodes */
+    inline DWORD GetMaxDepth ()
+    {
+        return m_MaxDepth;
+    }
+
 private:
 
     bool IsForward (DgNode *Node);
     VOID ForwardTraverse(DgNodeSet &SinksSet);
     VOID ForwardBfs(DgNodeSet &Sinks);
-    VOID ForwardDfs (DgNode *Node, DgNodeSet *Visited, DgNodeSet &SinksSet);
+    VOID ForwardDfs (DgNode *Node, VisitMark *Visited, DgNodeSet &SinksSet);
     
     VOID BackwardTraverse(DgNode *Node);
-    VOID BackwardDfs (DgNode *Node, DgNodeSet *Visited);
+    VOID BackwardDfs (DgNode *Node, VisitMark *Path);
+    VOID UpdateBackwardSlice (DgNode *SrcNode);
 
     bool IsExit (DgNode *DstNode);
     DgNode* GetPredom (DgNode *Node);
@@ -111,8 +283,57 @@ private:
     DWORD VisitEdgeType (DgNode *Node, DgNodeSet *Path);
     bool IsRetContext (DgNodeSet *Path, DgNode *DstNode);
     bool IsPathValid (DgNode *SinkNode, DgNodeSet *Path);
+    bool IsCallFreed (DgNode *CsNode, DgNodeSet *Path);
+    bool IsCalleeClosed (DgNode *Entry);
+    bool IsReturnOut (DgNode *Entry);
+
+    /* one node visited, true once a budget is exceeded; the clock is read every 1024 visits */
+    inline bool Charge ()
+    {
+        if (m_OverBudget != BG_NONE)
+        {
+            return true;
+        }
+
+        m_VisitNum++;
+        if (m_Budget.m_NodeNum != 0 && m_VisitNum > m_Budget.m_NodeNum)
+        {
+            m_OverBudget = BG_NODES;
+        }
+        else if (m_Budget.m_PathNum != 0 && m_PathNum > m_Budget.m_PathNum)
+        {
+            m_OverBudget = BG_PATHS;
+        }
+        else if ((m_VisitNum & 0x3FF) == 0 && (m_Budget.m_TimeMs != 0 || m_Budget.m_TotalMs != 0))
+        {
+            DWORD Now = Stat::GetWallTime ();
+            if (m_Budget.m_TimeMs != 0 && Now - m_StartTime > m_Budget.m_TimeMs)
+            {
+                m_OverBudget = BG_TIME;
+            }
+            else if (m_Budget.m_TotalMs != 0 && Now - m_Budget.m_TotalStart > m_Budget.m_TotalMs)
+            {
+                m_OverBudget = BG_TOTAL;
+            }
+        }
+
+        return (m_OverBudget != BG_NONE);
+    }
+
+    inline VOID EnterDepth ()
+    {
+        m_Depth++;
+        m_MaxDepth = (m_Depth > m_MaxDepth) ? m_Depth : m_MaxDepth;
+    }
     
     VOID CfgPathDfs (DgNode *Node, DgNodeSet *Path);
+
+    DWORD AddFlowState (DgNode *Node, DWORD Ctx);
+    DWORD GetFlowState (DgNode *Node, DWORD Ctx);
+    DgNode* GetRetSite (DgNode *CsNode);
+    VOID BuildFlowDeps (DWORD StateId);
+    DWORD GetDepValue (T_FlowDep &Dep);
+    bool ComputeMustFree ();
     VOID ComputePathReachable();
 
 };
@@ -42,11 +42,16 @@ public:
         m_WorkList = new BitQueue ();
         assert (m_WorkList != NULL);
         
-        m_ExtLib   = new ExternalLib ();
+        m_ExtLib   = new ExternalLib (m_ModMange.GetFuncClass ());
         assert (m_ExtLib != NULL);
         
-        m_DebugLib = new DebugLib ();
+        m_DebugLib = new DebugLib (m_ModMange.GetFuncClass ());
         assert (m_DebugLib != NULL);
+
+        m_IsStream   = AF_FALSE;
+        m_StreamNum  = 0;
+        m_StreamTime = 0;
+        m_CstPrint   = 0;
         
 
         /* Init node */
@@ -81,6 +86,10 @@ public:
     }
 
     DWORD RunPtsAnalysis ();
+
+    /* pipelined load: StreamHook collects each module as it is parsed */
+    VOID BeginStream ();
+    static VOID StreamHook (VOID *Ctx, llvm::Module *Mod);
     
     VOID GetPtsTo (Value *Src, std::vector<Value*>& Dst);
 
@@ -114,9 +123,9 @@ public:
         return Pst->end ();
     }
 
-    inline bool IsDebugFunction (std::string FuncName)
+    inline bool IsDebugFunction (const llvm::Function *Func)
     {
-        return m_DebugLib->IsDebugFunction (FuncName);
+        return m_DebugLib->IsDebugFunction (Func);
     }
 
 private:
@@ -138,6 +147,15 @@ private:
 
     std::set<llvm::Value*> m_FuncPointer;
 
+    /* pipelined collection, the call sites wait for all modules */
+    BOOL m_IsStream;
+    DWORD m_StreamNum;
+    DWORD m_StreamTime;
+
+    /* hash of the collected constraints, a checkpoint is only restored on the same */
+    ULONG m_CstPrint;
+    std::vector<llvm::Instruction*> m_DeferCall;
+
 private:
 
     VOID InitCstGraph();
@@ -151,11 +169,22 @@ private:
     BOOL AddExtLibCst(ImmutableCallSite Cs, const Function *Func);
     VOID AddFuncArgCst(ImmutableCallSite Cs, Function *Func);
     
+    BOOL CreateGlobalNode (GlobalVariable *Global);
+    VOID CreateFuncNode (Function *Func);
+    VOID AddGlobalInitCst (GlobalVariable *Global);
     VOID CollectCstOfGlobal();
     VOID CollectCstOfInst(Instruction *Inst);
+    VOID CollectCstOfFunc (Function *Func);
 
+    VOID InitConstraints();
+    VOID ClearCollect();
 	VOID CollectConstraints();
+    VOID CollectModule (llvm::Module *Mod);
+    VOID EndStream ();
 	DWORD SolveConstraints ();
+    ULONG GetCstPrint ();
+    BOOL LoadCheckpoint ();
+    VOID StoreCheckpoint ();
 
     
     VOID CollectAlloca(Instruction *Inst);   
@@ -55,6 +55,14 @@ public:
         RunPtsAnalysis (Type);
     }
 
+    /* pipelined: the modules are loaded into the empty Mm while their constraints are collected */
+    PointsTo(ModuleManage &Mm, T_PTS Type, const std::vector<std::string> &ModulePathVec) 
+    {
+        m_ModMange = Mm;
+
+        RunPipeline (Type, ModulePathVec);
+    }
+
     ~ PointsTo() 
     {
     }
@@ -78,13 +86,14 @@ public:
         }
     }
 
-    inline bool IsDebugFunction (std::string FuncName)
+    inline bool IsDebugFunction (const llvm::Function *Func)
     {
-        return m_Andersen->IsDebugFunction (FuncName);
+        return m_Andersen->IsDebugFunction (Func);
     } 
 
 private:
     DWORD RunPtsAnalysis (T_PTS Type);
+    DWORD RunPipeline (T_PTS Type, const std::vector<std::string> &ModulePathVec);
 
 
 };
@@ -0,0 +1,87 @@
+//===- CheckerRegistry.h -- dependence-based checkers on one graph ---------//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _CHECKERREGISTRY_H_
+#define _CHECKERREGISTRY_H_
+#include "app/leakdetect/LeakDetect.h"
+
+class MemLeak;
+
+typedef LeakDetector* (*CheckerCreate) (DgGraph *Dg);
+
+struct T_CheckerEntry
+{
+    std::string m_Name;
+    CheckerCreate m_Create;
+    std::string m_Desc;
+};
+
+/* a checker of a run and its cost */
+struct T_CheckerRun
+{
+    std::string m_Name;
+    LeakDetector *m_Checker;
+    DWORD m_Time;
+};
+
+/*
+   the checkers are created by name on the graph of the run, which is built
+   once, and run in the order given.
+   a checker is added to the table by Register or in InitBuiltin.
+*/
+class CheckerRegistry
+{
+private:
+    static std::vector<T_CheckerEntry> m_Entries;
+    
+    DgGraph *m_Dg;
+    std::vector<T_CheckerRun> m_Runs;
+
+public:
+    CheckerRegistry (DgGraph *Dg)
+    {
+        m_Dg = Dg;
+        InitBuiltin ();
+    }
+
+    ~CheckerRegistry ()
+    {
+        for (auto It = m_Runs.begin (), End = m_Runs.end (); It != End; It++)
+        {
+            delete It->m_Checker;
+        }
+    }
+
+    static VOID Register (std::string Name, CheckerCreate Create, std::string Desc);
+    
+    /* Names: comma separated, empty for the memory leak checker */
+    DWORD Run (std::string Names);
+    LeakDetector* GetChecker (std::string Name);
+
+    /* the builtin memory leak checker, NULL when it is not run */
+    MemLeak* GetMemLeak ();
+
+private:
+    static VOID InitBuiltin ();
+    static T_CheckerEntry* GetEntry (std::string &Name);
+    VOID PrintStat ();
+};
+
+#endif
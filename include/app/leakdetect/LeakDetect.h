@@ -34,6 +34,7 @@ typedef enum
     NEVER_LEAK
 }LEAK_TYPE;
 
+/* the graph belongs to the run, a detector only uses it */
 class LeakDetector 
 {
 public:
@@ -51,12 +52,18 @@ public:
         m_DgGraph = Dg;
     }
 
-    ~LeakDetector() 
+    virtual ~LeakDetector() 
     {
-        if (m_DgGraph != NULL)
-        {
-            delete m_DgGraph;
-        }
+    }
+
+    inline DWORD GetSrcNum ()
+    {
+        return m_SrcSet.size ();
+    }
+
+    inline DWORD GetSinkNum ()
+    {
+        return m_SinkSet.size ();
     }
   
     virtual VOID CollectSources() = 0;
@@ -24,42 +24,100 @@
 #define _MEMLEAK_H_
 #include "app/leakdetect/LeakDetect.h"
 #include "analysis/ProgramSlice.h"
+#include "analysis/DdgReach.h"
+#include "analysis/FwdBatch.h"
 
 
 using namespace std;
 
 
-typedef enum
+class MemLeak;
+
+/* one source of a parallel run, the slice result is kept until reported in source order */
+struct T_SliceTask
 {
-    F_MALLOC = 1,
-    F_FREE,
-}F_TYPE;
+    MemLeak *m_Leak;
+    DgNode *m_Source;
+    DWORD m_Reach;
+    DWORD m_Depth;
+    std::set<DgNode*> *m_Sinks;   /* the sinks the source may reach */
+    DWORD m_Budget;       /* BUDGET_TYPE that made the result inconclusive */
+    std::string m_Info;   /* what was explored before the budget ran out */
+    DWORD m_SumLookup;
+    DWORD m_SumHit;
+};
 
 
 class MemLeak:public LeakDetector 
 {
 private:
-    static vector<string> m_Malloc;
-    static vector<string> m_Free;
-
-    map<string, DWORD> m_MemFuncMap;
+    /* leak_source and leak_sink of the interned function classes */
+    FuncClass *m_FuncClass;
 
     map<string, DWORD> m_CheckResult;
+
+    /* optional sink reachability index, sources it prunes are never sliced */
+    DdgReach *m_Reach;
+    DWORD m_PrunedNum;
+
+    /* reached sinks of all sources by bit-parallel sweeps, built for many sources */
+    FwdBatch *m_Batch;
+    DWORD m_BatchPruned;
+
+    /* optional callee free summaries consulted at the call sites */
+    FreeSum *m_FreeSum;
+    DWORD m_SumLookup;
+    DWORD m_SumHit;
+
+    /* per-source and whole-detection budgets */
+    T_SliceBudget m_Budget;
+    DWORD m_BudgetNum;
     
 public:
     MemLeak(DgGraph *Dg):LeakDetector (Dg)
     {
-        InitFuncMap ();
+        m_Reach     = NULL;
+        m_PrunedNum = 0;
+
+        m_Batch       = NULL;
+        m_BatchPruned = 0;
+
+        m_FreeSum   = NULL;
+        m_SumLookup = 0;
+        m_SumHit    = 0;
+
+        m_BudgetNum  = 0;
+        
+        ModuleManage ModMng;
+        m_FuncClass = ModMng.GetFuncClass ();
+    }
+
+    static LeakDetector* Create (DgGraph *Dg)
+    {
+        return new MemLeak (Dg);
     }
 
     ~MemLeak() 
     {
-        
+        if (m_Reach != NULL)
+        {
+            delete m_Reach;
+        }
+
+        if (m_Batch != NULL)
+        {
+            delete m_Batch;
+        }
+
+        if (m_FreeSum != NULL)
+        {
+            delete m_FreeSum;
+        }
     }
 
 protected:  
     bool IsNormalCheck(llvm::Function *CallFunc);
-    bool IsSrcInAWrapper(DgNode *Root, ComQueue<DgNode *>* SrcQueue);
+    bool IsSrcInAWrapper(DgNode *Root, MarkQueue<DgNode *>* SrcQueue);
     VOID CollectSources();
     VOID CollectSinks();
 
@@ -71,33 +129,46 @@ protected:
     
     inline BOOL IsSourceFunc(const Function* Func)
     {
-        auto fIt = m_MemFuncMap.find (Func->getName().str());
-        if (fIt == m_MemFuncMap.end ())
-        {
-            return AF_FALSE;
-        }
-
-        return (BOOL)(fIt->second == F_MALLOC);
+        return (BOOL)m_FuncClass->Is (Func, FF_LEAK_SRC);
     }
 
     inline BOOL IsSinkFunc(const Function* Func)
     {
-        auto fIt = m_MemFuncMap.find (Func->getName().str());
-        if (fIt == m_MemFuncMap.end ())
+        return (BOOL)m_FuncClass->Is (Func, FF_LEAK_SINK);
+    }
+
+    VOID InitBudget ();
+    VOID InitTask (T_SliceTask &Task, DgNode *Source);
+    VOID ReportTask (T_SliceTask &Task);
+    VOID ReportInconclusive (DgNode *Source, DWORD Budget, std::string &Info);
+    DWORD RunSlicing (DWORD ThreadNum);
+
+    inline bool IsPruned (DgNode *Source)
+    {
+        if (m_Reach != NULL && !m_Reach->CanReach (Source))
         {
-            return AF_FALSE;
+            m_PrunedNum++;
+            return true;
         }
 
-        return (BOOL)(fIt->second == F_FREE);
+        if (m_Batch != NULL && m_Batch->GetReachSinks (Source)->empty ())
+        {
+            m_BatchPruned++;
+            return true;
+        }
+
+        return false;
     }
 
-    VOID InitFuncMap ();
-    VOID InitFuncMap (std::vector<std::string> FuncVec, F_TYPE Type);
+    static VOID* SliceTask (VOID *Arg);
+    VOID ReportBug(DgNode *Source, DWORD Reach);
 
 
 public:
     DWORD RunDetector ();
-    VOID  ReportBug(ProgramSlice *PgSlice, DgNode *Source);
+
+    /* slice the sources of Func again after the run, nothing is reported */
+    DWORD CheckFunction (const llvm::Function *Func, map<string, DWORD> &Result);
 
     inline map<string, DWORD>::iterator BugBegin ()
     {
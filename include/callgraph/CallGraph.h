@@ -200,11 +200,20 @@ private:
     DWORD m_PathCount;
     DWORD m_PathDepth;
 
+    /* a call-path context is the set of functions above a node, encoded as the
+       xor of their keys; a subtree is walked once per (node, context) */
+    ULONG m_CtxHash;
+    std::vector<ULONG> m_CtxStack;
+    std::set<std::pair<CallGraphNode*, ULONG>> m_DfsCtx;
+    DWORD m_MergeNum;
+
 public:
     CallGraph(ModuleManage &ModMng)
     {
         m_PathCount = 0;
         m_PathDepth = 5;
+        m_CtxHash   = 0;
+        m_MergeNum  = 0;
 
         m_ModMange = ModMng; 
         
@@ -230,6 +239,17 @@ public:
         return it->second;
     }
 
+    inline CallGraphNode* LookupCgNode(llvm::Function* Func) const 
+    {
+        T_FunToCallGraphNodeMap::const_iterator it = m_FuncToCgNodeMap.find(Func);
+        if (it == m_FuncToCgNodeMap.end())
+        {
+            return NULL;
+        }
+        
+        return it->second;
+    }
+
     inline BOOL IsFuncReached(llvm::Function* Func)
     {
         CallGraphNode* CgNode = GetCgNode(Func);
@@ -277,6 +297,11 @@ public:
         return m_CsToIdMap.size();
     }
 
+    inline DWORD GetPathDepth() 
+    {
+        return m_PathDepth;
+    }
+
     inline CallGraphNode* GetEntryNode() 
     {
         llvm::Function* Entry = m_ModMange.GetEntryFunction();
@@ -300,6 +325,16 @@ private:
 
     VOID DFSNode (DgGraph *Dg, CallGraphNode *Node);
 
+    /* splitmix64 of the node id */
+    inline ULONG GetCtxKey (CallGraphNode *Node)
+    {
+        ULONG Key = (ULONG)Node->GetId () + 0x9E3779B97F4A7C15UL;
+
+        Key = (Key ^ (Key >> 30)) * 0xBF58476D1CE4E5B9UL;
+        Key = (Key ^ (Key >> 27)) * 0x94D049BB133111EBUL;
+        return Key ^ (Key >> 31);
+    }
+
     inline VOID AddCallSiteMap(llvm::CallSite Cs, llvm::Function* Callee) 
     {
         std::pair<llvm::CallSite, const llvm::Function*> newCS(std::make_pair(Cs, Callee));
@@ -0,0 +1,114 @@
+//===- CgScheduler.h -- bottom-up SCC wavefront over the call graph ----------//
+//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+
+
+#ifndef _CGSCHEDULER_H_
+#define _CGSCHEDULER_H_
+#include "callgraph/CallGraph.h"
+#include "common/MultiTask.h"
+
+/* per-function task of a phase, Ctx is the phase owner */
+typedef VOID (*CgTask)(VOID *Ctx, llvm::Function *Func);
+
+struct CgScc
+{
+    std::vector<llvm::Function*> m_Funcs;
+    std::vector<DWORD> m_Callers;      /* caller sccs, distinct */
+    DWORD m_CalleeNum;                 /* callee sccs, distinct */
+    DWORD m_Wave;                      /* 0 for leaves, 1 + max wave of the callees */
+
+    /* per run */
+    DWORD m_Pending;
+    DWORD m_Time;
+    DWORD m_CpTime;                    /* m_Time + the slowest chain of callees */
+
+    CgScc ()
+    {
+        m_CalleeNum = 0;
+        m_Wave      = 0;
+        m_Pending   = 0;
+        m_Time      = 0;
+        m_CpTime    = 0;
+    }
+};
+
+/*
+   the reachable functions with a body are condensed into SCCs in bottom-up order,
+   an SCC is run as one task (its functions in order) as soon as all its callee SCCs
+   are done, so callees always finish before their callers and SCCs that do not
+   call each other run in parallel.
+*/
+class CgScheduler
+{
+private:
+    CallGraph *m_CallGraph;
+    std::vector<CgScc> m_Scc;
+    DWORD m_WaveNum;
+
+    /* per run */
+    CgTask m_Task;
+    VOID *m_Ctx;
+    MultiTask *m_Pool;
+    pthread_mutex_t m_Mutex;
+    std::vector<std::pair<CgScheduler*, DWORD>> m_SccArg;
+
+public:
+    CgScheduler (CallGraph *Cg)
+    {
+        m_CallGraph = Cg;
+        m_WaveNum   = 0;
+
+        m_Task = NULL;
+        m_Ctx  = NULL;
+        m_Pool = NULL;
+        pthread_mutex_init (&m_Mutex, NULL);
+
+        Condense ();
+    }
+
+    ~CgScheduler ()
+    {
+        pthread_mutex_destroy (&m_Mutex);
+    }
+
+    VOID Run (std::string Phase, CgTask Task, VOID *Ctx, DWORD ThreadNum);
+
+    inline DWORD GetSccNum ()
+    {
+        return m_Scc.size ();
+    }
+
+    inline DWORD GetWaveNum ()
+    {
+        return m_WaveNum;
+    }
+
+private:
+    VOID Condense ();
+    VOID GetCallee (CallGraphNode *Node, std::vector<CallGraphNode*> &Callee);
+
+    static VOID* SccProc (VOID *Arg);
+    VOID RunScc (DWORD SccId);
+
+    VOID PrintStat (std::string &Phase, DWORD ThreadNum, DWORD WallTime);
+};
+
+#endif
@@ -26,6 +26,7 @@
 #include <llvm/ADT/STLExtras.h>	
 #include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/SparseBitVector.h>
+#include <llvm/ADT/iterator_range.h>
 #include "common/BasicMacro.h"
 
 typedef enum
@@ -127,19 +128,77 @@ public:
 };
 
 
-template<class EdgeTy> class GenericNode 
+/* number of edge kinds selected by a node layout mask */
+constexpr DWORD EdgeKindNum (DWORD KindMask)
+{
+    return (KindMask == 0) ? 0 : ((KindMask & 1) + EdgeKindNum (KindMask >> 1));
+}
+
+/* position of an edge kind inside the per-kind lists of a node layout */
+constexpr DWORD EdgeKindSlot (DWORD KindMask, DWORD Kind)
+{
+    return EdgeKindNum (KindMask & (Kind - 1));
+}
+
+/* 
+   KindMask selects the EdgeAttr kinds that are additionally kept in their own
+   contiguous list, ordered as in the edge set. A kind in the mask must not be
+   set or cleared by SetAttr once the edge is added to the node.
+*/
+template<class EdgeTy, DWORD KindMask = 0> class GenericNode 
 {
 
 public:
     typedef std::set<EdgeTy*, typename EdgeTy::EqualGEdge> T_GEdgeSet;
     typedef typename T_GEdgeSet::iterator iterator;
 
+    typedef std::vector<EdgeTy*> T_GEdgeVec;
+    typedef typename T_GEdgeVec::iterator kind_iterator;
+    typedef llvm::iterator_range<kind_iterator> kind_range;
+
 private:
     DWORD m_Id;
 
     T_GEdgeSet m_InEdgeSet;  
     T_GEdgeSet m_OutEdgeSet;  
 
+    T_GEdgeVec m_InKindEdges[EdgeKindNum (KindMask) + 1];
+    T_GEdgeVec m_OutKindEdges[EdgeKindNum (KindMask) + 1];
+
+private:
+    inline VOID AddKindEdge (T_GEdgeVec *KindEdges, EdgeTy* Edge)
+    {
+        DWORD Slot = 0;
+        for (DWORD Kind = 1; Kind <= KindMask; Kind <<= 1)
+        {
+            if (!(KindMask & Kind))
+            {
+                continue;
+            }
+
+            if (Edge->GetAttr () & Kind)
+            {
+                T_GEdgeVec &Vec = KindEdges[Slot];
+                Vec.insert (std::upper_bound (Vec.begin (), Vec.end (), Edge, typename EdgeTy::EqualGEdge ()), Edge);
+            }
+            Slot++;
+        }
+    }
+
+    inline VOID RmKindEdge (T_GEdgeVec *KindEdges, EdgeTy* Edge)
+    {
+        for (DWORD Slot = 0; Slot < EdgeKindNum (KindMask); Slot++)
+        {
+            T_GEdgeVec &Vec = KindEdges[Slot];
+            
+            auto It = std::find (Vec.begin (), Vec.end (), Edge);
+            if (It != Vec.end ())
+            {
+                Vec.erase (It);
+            }
+        }
+    }
+
 public:
     GenericNode(DWORD Id): m_Id(Id) 
     {
@@ -163,6 +222,12 @@ public:
             RmOutgoingEdge(*In);      
         }
         m_OutEdgeSet.clear();
+
+        for (DWORD Slot = 0; Slot < EdgeKindNum (KindMask); Slot++)
+        {
+            m_InKindEdges[Slot].clear ();
+            m_OutKindEdges[Slot].clear ();
+        }
     }
 
     inline DWORD GetId() const
@@ -195,14 +260,61 @@ public:
         return m_InEdgeSet.end();
     }
 
+    /* edges of one kind only, e.g: Node->OutEdges<EA_DD> () */
+    template<DWORD Kind> inline kind_range OutEdges ()
+    {
+        static_assert ((KindMask & Kind) == Kind && EdgeKindNum (Kind) == 1, 
+                       "edge kind is not partitioned in this node layout");
+        
+        T_GEdgeVec &Vec = m_OutKindEdges[EdgeKindSlot (KindMask, Kind)];
+        return kind_range (Vec.begin (), Vec.end ());
+    }
+
+    template<DWORD Kind> inline kind_range InEdges ()
+    {
+        static_assert ((KindMask & Kind) == Kind && EdgeKindNum (Kind) == 1, 
+                       "edge kind is not partitioned in this node layout");
+        
+        T_GEdgeVec &Vec = m_InKindEdges[EdgeKindSlot (KindMask, Kind)];
+        return kind_range (Vec.begin (), Vec.end ());
+    }
+
+    template<DWORD Kind> inline DWORD OutEdgeNum ()
+    {
+        static_assert ((KindMask & Kind) == Kind && EdgeKindNum (Kind) == 1, 
+                       "edge kind is not partitioned in this node layout");
+        
+        return m_OutKindEdges[EdgeKindSlot (KindMask, Kind)].size ();
+    }
+
+    template<DWORD Kind> inline DWORD InEdgeNum ()
+    {
+        static_assert ((KindMask & Kind) == Kind && EdgeKindNum (Kind) == 1, 
+                       "edge kind is not partitioned in this node layout");
+        
+        return m_InKindEdges[EdgeKindSlot (KindMask, Kind)].size ();
+    }
+
     inline bool AddIncomingEdge(EdgeTy* InEdge)
     {
-        return m_InEdgeSet.insert(InEdge).second;
+        if (!m_InEdgeSet.insert(InEdge).second)
+        {
+            return false;
+        }
+
+        AddKindEdge (m_InKindEdges, InEdge);
+        return true;
     }
     
     inline bool AddOutgoingEdge(EdgeTy* OutEdge) 
     {
-        return m_OutEdgeSet.insert(OutEdge).second;
+        if (!m_OutEdgeSet.insert(OutEdge).second)
+        {
+            return false;
+        }
+
+        AddKindEdge (m_OutKindEdges, OutEdge);
+        return true;
     }
 
     inline VOID RmIncomingEdge(EdgeTy* InEdge) 
@@ -214,6 +326,7 @@ public:
         }
 
         m_InEdgeSet.erase(InEdge);
+        RmKindEdge (m_InKindEdges, InEdge);
         return;
     }
     
@@ -226,6 +339,7 @@ public:
         }
 
         m_OutEdgeSet.erase(OutEdge);
+        RmKindEdge (m_OutKindEdges, OutEdge);
         return;
     }
 
@@ -317,7 +431,8 @@ public:
             
             Edge->SetEdgeValue(Val);
 
-            m_EdgeNum++;
+            /* per-function phases may add edges from several threads */
+            __sync_fetch_and_add (&m_EdgeNum, 1);
 
             return true;
         }
@@ -330,7 +445,7 @@ public:
         Edge->GetDstNode()->RmIncomingEdge(Edge);
         Edge->GetSrcNode()->RmOutgoingEdge(Edge);
             
-        m_EdgeNum--;
+        __sync_fetch_and_sub (&m_EdgeNum, 1);
         delete Edge;
         return;
     }
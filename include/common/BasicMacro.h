@@ -22,7 +22,7 @@
 #define AF_FALSE            (0)
 
 
-#define FUNC_MODULE         ("Func_Module.map")
+#define FUNC_MODULE         ("Func_Module.idx")
 
 
 
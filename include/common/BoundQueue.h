@@ -0,0 +1,131 @@
+//===- BoundQueue.h - bounded blocking queue between pipeline stages --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Push blocks while the queue is full, Front blocks while it is empty. the ms
+/// each side spent blocked is kept as the idle time of its stage.
+///
+//===----------------------------------------------------------------------===//
+#ifndef _BOUNDQUEUE_H_
+#define _BOUNDQUEUE_H_
+#include "common/Stat.h"
+#include <pthread.h>
+#include <queue>
+
+template<class Data> class BoundQueue
+{
+private:
+    DWORD m_Capacity;
+    std::queue<Data> m_Queue;
+
+    pthread_mutex_t m_Mutex;
+    pthread_cond_t  m_NotFull;
+    pthread_cond_t  m_NotEmpty;
+
+    DWORD m_PushWait;
+    DWORD m_PopWait;
+
+    BoundQueue (const BoundQueue&);
+    BoundQueue& operator= (const BoundQueue&);
+
+public:
+    BoundQueue (DWORD Capacity = 1)
+    {
+        m_Capacity = Capacity;
+        assert (m_Capacity != 0);
+
+        m_PushWait = 0;
+        m_PopWait  = 0;
+
+        pthread_mutex_init (&m_Mutex, NULL);
+        pthread_cond_init (&m_NotFull, NULL);
+        pthread_cond_init (&m_NotEmpty, NULL);
+    }
+
+    ~BoundQueue ()
+    {
+        pthread_cond_destroy (&m_NotEmpty);
+        pthread_cond_destroy (&m_NotFull);
+        pthread_mutex_destroy (&m_Mutex);
+    }
+
+    inline VOID Push (Data data)
+    {
+        pthread_mutex_lock (&m_Mutex);
+        if (m_Queue.size () >= m_Capacity)
+        {
+            DWORD Start = Stat::GetWallTime ();
+            while (m_Queue.size () >= m_Capacity)
+            {
+                pthread_cond_wait (&m_NotFull, &m_Mutex);
+            }
+            m_PushWait += Stat::GetWallTime () - Start;
+        }
+
+        m_Queue.push (data);
+        pthread_cond_signal (&m_NotEmpty);
+        pthread_mutex_unlock (&m_Mutex);
+    }
+
+    /* the head stays queued until Pop, so a producer in WaitEmpty waits for its consumer */
+    inline Data Front ()
+    {
+        pthread_mutex_lock (&m_Mutex);
+        if (m_Queue.empty ())
+        {
+            DWORD Start = Stat::GetWallTime ();
+            while (m_Queue.empty ())
+            {
+                pthread_cond_wait (&m_NotEmpty, &m_Mutex);
+            }
+            m_PopWait += Stat::GetWallTime () - Start;
+        }
+
+        Data data = m_Queue.front ();
+        pthread_mutex_unlock (&m_Mutex);
+
+        return data;
+    }
+
+    inline VOID Pop ()
+    {
+        pthread_mutex_lock (&m_Mutex);
+        assert (!m_Queue.empty () && "Trying to pop an empty queue!");
+        m_Queue.pop ();
+        pthread_cond_broadcast (&m_NotFull);
+        pthread_mutex_unlock (&m_Mutex);
+    }
+
+    inline VOID WaitEmpty ()
+    {
+        pthread_mutex_lock (&m_Mutex);
+        if (!m_Queue.empty ())
+        {
+            DWORD Start = Stat::GetWallTime ();
+            while (!m_Queue.empty ())
+            {
+                pthread_cond_wait (&m_NotFull, &m_Mutex);
+            }
+            m_PushWait += Stat::GetWallTime () - Start;
+        }
+        pthread_mutex_unlock (&m_Mutex);
+    }
+
+    inline DWORD GetPushWait ()
+    {
+        return m_PushWait;
+    }
+
+    inline DWORD GetPopWait ()
+    {
+        return m_PopWait;
+    }
+};
+
+#endif
@@ -0,0 +1,108 @@
+//===- Checkpoint.h - phase checkpoints of a long run ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// a phase writes its result to the -checkpoint-dir when it completes, a run
+/// with -resume-from takes the result of every phase whose checkpoint was
+/// written for the same inputs and settings instead of computing it again.
+///
+//===----------------------------------------------------------------------===//
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+#include "common/BasicMacro.h"
+
+#define CK_MAGIC            (0x50434B50)  /* "PKCP" */
+#define CK_VERSION          (2)
+#define CK_SECTION_MAX      (16)
+#define CK_HASH_INIT        (14695981039346656037UL)
+
+typedef enum
+{
+    CK_LOAD = 0,    /* the module list */
+    CK_PTS  = 1,    /* merge targets and points-to sets of the solved constraint graph */
+    CK_DDG  = 2,    /* the stamp of the dependence graph snapshot written beside it */
+    CK_PHASE_NUM,
+}CK_PHASE;
+
+/*
+   checkpoint layout, all sections are 4-byte aligned:
+   CkHeader | DWORD SecSize[SecNum] | section 0 | section 1 ...
+
+   the ddg phase is a DgSnapshot in ddg.snap, which checks its own fingerprint,
+   and ddg.ckpt, whose one section is the size and mtime of that snapshot.
+*/
+struct CkHeader
+{
+    DWORD Magic;
+    DWORD Version;
+    DWORD Phase;
+    DWORD SecNum;
+    ULONG InputPrint;   /* the settings, the modules loaded with their mtime and size, the class data */
+};
+
+class Checkpoint
+{
+private:
+    static ULONG m_InputPrint;
+    static std::string m_StoreDir;
+    static std::string m_ResumeDir;
+
+    static std::string GetPath (std::string &Dir, DWORD Phase);
+    static std::string GetSnapPath (std::string &Dir);
+    static BOOL ReadHeader (std::string &Path, DWORD Phase, CkHeader &Hdr);
+    static BOOL IsSnapStamped (std::string &Dir);
+
+public:
+    static VOID Init ();
+
+    /* after the modules are loaded, on demand ones too: no phase is read or written before */
+    static VOID SetInputs (const std::vector<std::string> &ModulePathVec, const std::string &DataFile);
+
+    static inline ULONG HashBytes (ULONG Hash, const VOID *Data, DWORD Size)
+    {
+        const BYTE *Byte = (const BYTE *)Data;
+        for (DWORD Index = 0; Index < Size; Index++)
+        {
+            Hash ^= Byte[Index];
+            Hash *= 1099511628211UL;
+        }
+
+        return Hash;
+    }
+
+    /* "" when the phase is not written or not resumed */
+    static std::string GetStorePath (DWORD Phase);
+    static std::string GetResumePath (DWORD Phase);
+
+    /* the ddg snapshot: "" when not written, or not resumed from a stamped one */
+    static std::string GetStoreSnap ();
+    static std::string GetResumeSnap ();
+    static VOID StampSnap ();
+
+    static BOOL Store (DWORD Phase, std::vector<std::string> &Sections);
+    static BOOL Load (DWORD Phase, std::vector<std::string> &Sections);
+    static VOID Report (const CHAR *Op, DWORD Phase, std::string &Path, DWORD Time);
+
+    static VOID StoreModules (const std::vector<std::string> &ModulePathVec);
+    static BOOL LoadModules (std::vector<std::string> &ModulePathVec);
+
+    template<class Ty> static inline VOID PutArray (std::string &Section, const std::vector<Ty> &Vec)
+    {
+        Section.assign ((const CHAR *)Vec.data (), Vec.size () * sizeof (Ty));
+    }
+
+    /* the number of elements, Data points into the section */
+    template<class Ty> static inline DWORD GetArray (std::string &Section, const Ty *&Data)
+    {
+        Data = (const Ty *)Section.data ();
+        return (DWORD)(Section.size () / sizeof (Ty));
+    }
+};
+
+#endif
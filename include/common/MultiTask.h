@@ -8,7 +8,8 @@
 //===----------------------------------------------------------------------===//
 ///
 /// \file
-/// visit directory.
+/// a fixed number of threads share one task queue, a running task may submit
+/// new tasks, Wait returns when the queue is empty and no task is running.
 ///
 //===----------------------------------------------------------------------===//
 #ifndef _MULTITASK_H
@@ -16,80 +17,42 @@
 #include "common/BasicMacro.h"
 #include <pthread.h>
 
-enum TASK_STATUS {INIT = 0, RUNNING, READY_EXIT, EXITED};
-
 typedef VOID* TaskFunc(VOID* Arg);
 
-class Task
-{
-private:
-    std::queue<VOID*> m_DataQueue;
-    pthread_t m_Tid;
-    TaskFunc *Func;
-    TASK_STATUS m_Status;
-
-private:
-    inline VOID* PopData ()
-    {
-        if (m_DataQueue.empty())
-        {
-            return NULL;
-        }
-        
-        VOID *Data = m_DataQueue.front();
-        m_DataQueue.pop();
-
-        return Data;
-    }
-
-public:
-    Task (TaskFunc T);
-
-    ~Task ()
-    {
-    }
-
-    VOID SetStatus (TASK_STATUS Status)
-    {
-        m_Status = Status;
-    }
-
-    TASK_STATUS GetStatus ()
-    {
-        return m_Status;
-    }
-
-    VOID AddData (VOID *Data)
-    {
-        m_DataQueue.push (Data);
-    }
-
-    bool Finish ()
-    {
-        return !m_DataQueue.empty();
-    }
-
-    VOID Run ();
-};
-
-
 class MultiTask
 {
 private:
     DWORD m_TaskNum;
-    std::vector<Task*> m_TaskAry;
+    TaskFunc *m_Func;
+    std::vector<pthread_t> m_Threads;
+    std::queue<std::pair<TaskFunc*, VOID*>> m_TaskQueue;
+
+    pthread_mutex_t m_Mutex;
+    pthread_cond_t  m_TaskCond;
+    pthread_cond_t  m_DoneCond;
+
+    /* queued and running tasks */
+    DWORD m_Pending;
+    BOOL  m_Exit;
 
 private:
-    VOID Wait ();
+    static VOID* TaskProc (VOID *Arg);
+    VOID Loop ();
     
 public:
-    MultiTask (DWORD TaskNum, TaskFunc T);
+    MultiTask (DWORD TaskNum, TaskFunc T = NULL);
+    ~MultiTask ();
 
-    ~MultiTask ()
-    {
-    }
+    VOID Submit (TaskFunc *Func, VOID *Arg);
+    VOID Wait ();
 
+    /* every data by the function of the constructor */
     VOID Run (std::vector<VOID *> &DataSet);   
+
+    inline DWORD GetTaskNum ()
+    {
+        return m_TaskNum;
+    }
 };
 
 
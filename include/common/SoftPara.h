@@ -19,6 +19,27 @@
 #define PARA_CFG_DUMP       (std::string("cfg_dump"))
 #define PARA_CFG_WEIGHT     (std::string("cfg_weight"))
 #define PARA_DDG_DUMP       (std::string("ddg_dump"))
+#define PARA_DDG_SNAPSHOT   (std::string("ddg_snapshot"))
+#define PARA_DDG_INCREMENTAL (std::string("ddg_incremental"))
+#define PARA_LAZY_DDG       (std::string("lazy_ddg"))
+#define PARA_GLOBAL_HUB     (std::string("global_hub"))
+#define PARA_THREAD_NUM     (std::string("thread_num"))
+#define PARA_DDG_REACH      (std::string("ddg_reach"))
+#define PARA_PATH_ENGINE    (std::string("path_engine"))
+#define PARA_SRC_TIME       (std::string("src_time"))
+#define PARA_SRC_NODES      (std::string("src_nodes"))
+#define PARA_SRC_PATHS      (std::string("src_paths"))
+#define PARA_TOTAL_TIME     (std::string("total_time"))
+#define PARA_FWD_BATCH      (std::string("fwd_batch"))
+#define PARA_FREE_SUM       (std::string("free_sum"))
+#define PARA_CHECKERS       (std::string("checkers"))
+#define PARA_FUNC_CLASS     (std::string("func_class"))
+#define PARA_LOAD_THREAD    (std::string("load_thread"))
+#define PARA_LAZY_LOAD      (std::string("lazy_load"))
+#define PARA_PIPELINE       (std::string("pipeline"))
+#define PARA_SERVER         (std::string("server"))
+#define PARA_CHECKPOINT_DIR (std::string("checkpoint_dir"))
+#define PARA_RESUME_FROM    (std::string("resume_from"))
 
 
 
@@ -119,7 +119,36 @@ public:
         } 
     }
 
+    /* ms of wall time: CLOCK_IN_MS is the cpu time of all threads */
+    static DWORD GetWallTime ()
+    {
+        struct timespec Ts;
+        clock_gettime (CLOCK_MONOTONIC, &Ts);
+
+        return (DWORD)(Ts.tv_sec * 1000 + Ts.tv_nsec / 1000000);
+    }
+
+    /* us of wall time, for requests answered within a few ms */
+    static ULONG GetWallTimeUs ()
+    {
+        struct timespec Ts;
+        clock_gettime (CLOCK_MONOTONIC, &Ts);
+
+        return (ULONG)Ts.tv_sec * 1000000 + Ts.tv_nsec / 1000;
+    }
+
     static DWORD GetPhyMemUse ()
+    {
+        return GetProcStatus ("VmRSS");
+    }
+
+    /* the peak resident size so far */
+    static DWORD GetPeakMemUse ()
+    {
+        return GetProcStatus ("VmHWM");
+    }
+
+    static DWORD GetProcStatus (const char *Item)
     {
         pid_t pid = getpid();
 
@@ -131,7 +160,7 @@ public:
         while (!feof(F))
         {
             assert (fgets (Buf, sizeof(Buf), F) != NULL);
-            if (strstr(Buf, "VmRSS"))
+            if (strstr(Buf, Item))
             {
                 break;
             }
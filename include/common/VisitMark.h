@@ -0,0 +1,182 @@
+//===- VisitMark.h - epoch-stamped visited marks over dense ids ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// an id is marked when its stamp equals the current epoch, so a reset is a
+/// new epoch instead of a clear. the stamp arrays are pooled per thread and
+/// reused by the next VisitMark of the same thread.
+///
+//===----------------------------------------------------------------------===//
+#ifndef _VISITMARK_H_
+#define _VISITMARK_H_
+#include "common/BasicMacro.h"
+#include <vector>
+#include <queue>
+#include <algorithm>
+
+struct T_MarkBuf
+{
+    std::vector<DWORD> m_Stamp;
+    DWORD m_Epoch;
+};
+
+struct T_MarkPool
+{
+    std::vector<T_MarkBuf*> m_Free;
+
+    ~T_MarkPool ()
+    {
+        for (auto It = m_Free.begin (), End = m_Free.end (); It != End; It++)
+        {
+            delete *It;
+        }
+    }
+};
+
+class VisitMark
+{
+private:
+    T_MarkBuf *m_Buf;
+
+    static inline T_MarkPool& GetPool ()
+    {
+        static thread_local T_MarkPool Pool;
+        return Pool;
+    }
+
+    VisitMark (const VisitMark&);
+    VisitMark& operator= (const VisitMark&);
+
+public:
+    VisitMark (DWORD Size = 0)
+    {
+        T_MarkPool &Pool = GetPool ();
+        if (Pool.m_Free.empty ())
+        {
+            m_Buf = new T_MarkBuf;
+            m_Buf->m_Epoch = 0;
+        }
+        else
+        {
+            m_Buf = Pool.m_Free.back ();
+            Pool.m_Free.pop_back ();
+        }
+
+        Reset (Size);
+    }
+
+    ~VisitMark ()
+    {
+        GetPool ().m_Free.push_back (m_Buf);
+    }
+
+    /* unmark all, ids below Size are marked without growing */
+    inline VOID Reset (DWORD Size = 0)
+    {
+        std::vector<DWORD> &Stamp = m_Buf->m_Stamp;
+        if (Stamp.size () < Size)
+        {
+            Stamp.resize (Size, 0);
+        }
+
+        /* 0 is never an epoch: clear the stamps on wrap-around */
+        if (++m_Buf->m_Epoch == 0)
+        {
+            std::fill (Stamp.begin (), Stamp.end (), 0);
+            m_Buf->m_Epoch = 1;
+        }
+    }
+
+    inline bool IsMarked (DWORD Id) const
+    {
+        std::vector<DWORD> &Stamp = m_Buf->m_Stamp;
+        return (Id < Stamp.size () && Stamp[Id] == m_Buf->m_Epoch);
+    }
+
+    /* true if Id was not marked */
+    inline bool Mark (DWORD Id)
+    {
+        std::vector<DWORD> &Stamp = m_Buf->m_Stamp;
+        if (Id >= Stamp.size ())
+        {
+            Stamp.resize (Id + 1 + Id/2, 0);
+        }
+
+        if (Stamp[Id] == m_Buf->m_Epoch)
+        {
+            return false;
+        }
+
+        Stamp[Id] = m_Buf->m_Epoch;
+        return true;
+    }
+
+    inline VOID Unmark (DWORD Id)
+    {
+        std::vector<DWORD> &Stamp = m_Buf->m_Stamp;
+        if (Id < Stamp.size ())
+        {
+            Stamp[Id] = 0;
+        }
+    }
+};
+
+
+/* ComQueue over nodes with dense ids: an element is not queued twice while it is in the queue */
+template<class Data> class MarkQueue
+{
+private:
+    VisitMark m_Mark;
+    std::queue<Data> m_Queue;
+
+public:
+    MarkQueue(DWORD Size = 0): m_Mark (Size) {}
+
+    ~MarkQueue() {}
+
+    inline DWORD Size()
+    {
+        return m_Queue.size();
+    }
+
+    inline bool IsEmpty() const
+    {
+        return m_Queue.empty();
+    }
+
+    inline bool IsInQueue(Data data) const
+    {
+        return m_Mark.IsMarked (data->GetId ());
+    }
+
+    inline bool InQueue(Data data)
+    {
+        if (!m_Mark.Mark (data->GetId ()))
+        {
+            return false;
+        }
+
+        m_Queue.push(data);
+        return true;
+    }
+
+    inline Data OutQueue()
+    {
+        assert(!m_Queue.empty() && "Trying to dequeue an empty queue!");
+
+        Data data = m_Queue.front();
+        m_Queue.pop();
+
+        m_Mark.Unmark (data->GetId ());
+
+        return data;
+    }
+};
+
+#endif
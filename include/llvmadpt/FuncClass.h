@@ -0,0 +1,138 @@
+//===- FuncClass.h -- function classes interned once per module set --------//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _FUNCCLASS_H_
+#define _FUNCCLASS_H_
+#include <atomic>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/Function.h>
+#include "common/Stat.h"
+
+#ifndef PCA_DATA_DIR
+#define PCA_DATA_DIR        ("data")
+#endif
+#define FUNC_CLASS_FILE     ("FuncClass.txt")
+
+/* one bit per class, a function may be in several */
+typedef enum
+{
+    FF_NORMAL    = 1 << 0,     /* external, no effect on the points-to */
+    FF_MALLOC    = 1 << 1,
+    FF_REALLOC   = 1 << 2,
+    FF_MEMCPY    = 1 << 3,
+    FF_RETARG0   = 1 << 4,
+    FF_CAST      = 1 << 5,
+    FF_DEBUG     = 1 << 6,
+    FF_LEAK_SRC  = 1 << 7,
+    FF_LEAK_SINK = 1 << 8,
+}FUNC_FLAG;
+
+/*
+   the name lists are read from the data file and every function of the module
+   set is classified once, so a lookup is a pointer hash instead of a string
+   compare. a function created after the build falls back to its name.
+*/
+class FuncClass
+{
+private:
+    std::map<std::string, DWORD> m_NameFlags;
+    llvm::DenseMap<const llvm::Function*, DWORD> m_FuncFlags;
+
+    std::string m_DataFile;
+    DWORD m_BuildTime;
+    std::atomic<DWORD> m_MissNum;
+
+    VOID LoadNames (std::string Path);
+    std::string GetDataPath ();
+
+    inline DWORD GetNameFlags (llvm::StringRef Name) const
+    {
+        auto It = m_NameFlags.find (Name.str ());
+        if (It == m_NameFlags.end ())
+        {
+            return 0;
+        }
+
+        return It->second;
+    }
+
+public:
+    FuncClass ()
+    {
+        m_BuildTime = 0;
+        m_MissNum   = 0;
+    }
+
+    ~FuncClass ()
+    {
+    }
+
+    /* the name lists only, lookups before the build go by name */
+    inline VOID Init ()
+    {
+        if (m_NameFlags.empty ())
+        {
+            m_DataFile = GetDataPath ();
+            LoadNames (m_DataFile);
+        }
+    }
+
+    /* the data file the names were read from */
+    inline const std::string& GetDataFile ()
+    {
+        return m_DataFile;
+    }
+
+    template<class FuncIt> VOID Build (FuncIt Begin, FuncIt End)
+    {
+        DWORD Start = Stat::GetWallTime ();
+        Init ();
+
+        for (FuncIt It = Begin; It != End; It++)
+        {
+            const llvm::Function *Func = *It;
+            m_FuncFlags[Func] = GetNameFlags (Func->getName ());
+        }
+
+        m_BuildTime += Stat::GetWallTime () - Start;
+        PrintStat ();
+    }
+
+    inline DWORD GetFlags (const llvm::Function *Func)
+    {
+        auto It = m_FuncFlags.find (Func);
+        if (It != m_FuncFlags.end ())
+        {
+            return It->second;
+        }
+
+        m_MissNum++;
+        return GetNameFlags (Func->getName ());
+    }
+
+    inline bool Is (const llvm::Function *Func, DWORD Flag)
+    {
+        return (GetFlags (Func) & Flag) != 0;
+    }
+
+    VOID PrintStat ();
+};
+
+#endif
@@ -0,0 +1,107 @@
+//===- FuncModIndex.h -- mapped index from function names to modules -------//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _FUNCMODINDEX_H_
+#define _FUNCMODINDEX_H_
+#include <string>
+#include <vector>
+#include "common/BasicMacro.h"
+
+#define FM_INDEX_MAGIC      (0x494D4650)  /* "PFMI" */
+#define FM_INDEX_VERSION    (1)
+#define FM_INDEX_NONE       (0xFFFFFFFF)
+
+/*
+   index layout, all sections are 4-byte aligned:
+   FmHeader | FmModule[ModNum] | DWORD Bucket[BucketNum] | FmEntry[FuncNum] | CHAR StrTab[StrSize]
+
+   the entries of a module are FmEntry[FuncBegin ... FuncBegin+FuncNum), a bucket
+   heads a chain of entries linked by Next. a name defined in several modules
+   is found in the last of them first, as the text map kept the last line.
+*/
+struct FmHeader
+{
+    DWORD Magic;
+    DWORD Version;
+    DWORD ModNum;
+    DWORD FuncNum;
+    DWORD BucketNum;
+    DWORD StrSize;
+};
+
+struct FmModule
+{
+    DWORD PathOff;
+    DWORD FuncBegin;
+    DWORD FuncNum;
+    DWORD Reserved;
+    ULONG MTime;      /* the module is reused while its mtime and size hold */
+    ULONG Size;
+};
+
+struct FmEntry
+{
+    DWORD Hash;
+    DWORD NameOff;
+    DWORD ModId;
+    DWORD Next;
+};
+
+
+class FuncModIndex
+{
+private:
+    VOID *m_Base;
+    size_t m_Size;
+    const FmHeader *m_Hdr;
+    const FmModule *m_Modules;
+    const DWORD    *m_Buckets;
+    const FmEntry  *m_Entries;
+    const CHAR     *m_StrTab;
+
+    static DWORD HashName (const CHAR *Name);
+    static VOID* CollectTask (VOID *Arg);
+
+    BOOL CheckLayout ();
+
+public:
+    FuncModIndex ()
+    {
+        m_Base = NULL;
+        m_Size = 0;
+        m_Hdr  = NULL;
+    }
+
+    ~FuncModIndex ()
+    {
+        Close ();
+    }
+
+    BOOL Open (const CHAR *Path);
+    VOID Close ();
+
+    /* "" when the name is not defined in any module */
+    std::string GetModulePath (const std::string &FuncName) const;
+
+    /* index the modules to Path, the modules unchanged since the open index are not parsed */
+    VOID Build (const std::vector<std::string> &ModulePaths, DWORD ThreadNum, const CHAR *Path);
+};
+
+#endif
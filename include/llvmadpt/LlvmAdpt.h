@@ -35,6 +35,13 @@
 #include "llvmadpt/ModuleSet.h"
 #include "analysis/points-to/PointsTo.h"
 
+/* the offset of a field element: <kind, key> */
+#define OFF_NONE     (0)   /* the whole base */
+#define OFF_CONST    (1)   /* a constant index, key is its value */
+#define OFF_VALUE    (2)   /* any other index, key is its llvm::Value */
+typedef std::pair<DWORD, ULONG> T_ElemOffset;
+#define ELEM_WHOLE   (T_ElemOffset (OFF_NONE, 0))
+
 
 namespace llvmAdpt 
 {
@@ -176,12 +183,11 @@ inline VOID GetPtsTo (llvm::Value* Src, std::vector<llvm::Value*>& Dst)
     return PtsTo.GetPtsTo (Src, Dst);
 }
 
-inline bool IsDebugFunction (std::string FuncName)
+inline bool IsDebugFunction (const llvm::Function *Func)
 {
     ModuleManage ModMng;
-    PointsTo PtsTo (ModMng, T_ANDRESEN);
 
-    return PtsTo.IsDebugFunction(FuncName);
+    return ModMng.GetFuncClass ()->Is (Func, FF_DEBUG);
 }
 
 inline std::string GetSourceLoc(llvm::Instruction* inst) 
@@ -215,6 +221,19 @@ inline llvm::Value* GetElemBaseValue (llvm::Value *Val)
     return Inst->getOperand (0);
 }
 
+/* a constant index by its value: the modules parsed on other contexts have
+   other ConstantInt objects for the same index */
+inline T_ElemOffset GetElemOffset (llvm::Value *Offset)
+{
+    llvm::ConstantInt *Const = llvm::dyn_cast<llvm::ConstantInt>(Offset);
+    if (Const != NULL && Const->getBitWidth () <= 64)
+    {
+        return T_ElemOffset (OFF_CONST, (ULONG)Const->getSExtValue ());
+    }
+
+    return T_ElemOffset (OFF_VALUE, (ULONG)Offset);
+}
+
 
 llvm::Function* GetIndirectCallee(const llvm::Instruction *Inst);
 
@@ -413,7 +432,7 @@ class Element
 {
 public:
     llvm::Value *Base;
-    llvm::Value *Offset;
+    T_ElemOffset Offset;
 
     llvm::Value *DefVal;
     llvm::Instruction *DefInst;
@@ -436,6 +455,17 @@ public:
 
 typedef std::set<Element, typename Element::EqualElem> T_ElemSet;
 
+/* the set is ordered by base first: all elements of a base are one range,
+   starting from <Base, OFF_NONE> */
+inline T_ElemSet::iterator ElemBaseBegin (T_ElemSet *ElemSet, llvm::Value *Base)
+{
+    Element Em;
+    Em.Base   = Base;
+    Em.Offset = ELEM_WHOLE;
+
+    return ElemSet->lower_bound (Em);
+}
+
 class InstAnalyzer
 {
 public:
@@ -449,6 +479,7 @@ typedef llvm::DenseMap<llvm::Value*, llvm::Instruction*> T_Value2Inst;
 
 typedef llvm::DenseMap<llvm::Value*, Element*> T_Value2Elem;
 typedef llvm::DenseMap<Element, llvm::Instruction*> T_Elem2DefInst;
+typedef llvm::DenseMap<llvm::Value*, T_InstVector> T_Value2InstVector;
 
     
 private:
@@ -476,6 +507,10 @@ private:
     /* handle output para */
     T_InstVector *m_CallsiteSet;
     T_ElemSet m_PDefActSet;
+
+    /* actual para -> incoming callsites passing it, built on first query */
+    T_Value2InstVector m_ActToCallsite;
+    bool m_IsActIndexed;
     
 private:
 
@@ -484,7 +519,7 @@ private:
 
     VOID ProcInst (llvm::Instruction* Inst, DefUse* Du);
 
-    inline bool IsActualPara (llvm::Value *Val)
+    inline VOID IndexActualPara ()
     {
         for (auto It = m_CallsiteSet->begin(), end = m_CallsiteSet->end(); It != end; It++)
         {
@@ -493,15 +528,25 @@ private:
 
             for (; aItr != Cs.arg_end(); ++aItr) 
             {
-                llvm::Value *Act = *aItr;
-                if (Val == Act)
+                T_InstVector &CsVec = m_ActToCallsite[*aItr];
+                if (CsVec.empty () || CsVec.back () != *It)
                 {
-                    return true;
+                    CsVec.push_back (*It);
                 }
             }
         }
+
+        m_IsActIndexed = true;
+    }
+
+    inline bool IsActualPara (llvm::Value *Val)
+    {
+        if (!m_IsActIndexed)
+        {
+            IndexActualPara ();
+        }
         
-        return false;
+        return (m_ActToCallsite.find (Val) != m_ActToCallsite.end());
     }
 
     inline bool IsInValueSet (llvm::Value *Val)
@@ -595,7 +640,7 @@ private:
         if (it == m_ElemPtrMap.end())
         {
             Em.Base    = ActPara;
-            Em.Offset  = NULL;
+            Em.Offset  = ELEM_WHOLE;
             Em.DefVal  = Def;
             Em.DefInst = Inst;
 
@@ -790,8 +835,7 @@ private:
         llvm::Value *Op0 = Inst->getOperand(0);
         
         Em.Base = llvmAdpt::GetElemBaseValue(Op0);
-        Em.Offset = Inst->getOperand (Inst->getNumOperands ()-1);
-        assert (Em.Offset != NULL);
+        Em.Offset = llvmAdpt::GetElemOffset (Inst->getOperand (Inst->getNumOperands ()-1));
         
         /* try to find, if this value is defined */
         auto It = m_ElemSet.find (Em);
@@ -917,7 +961,8 @@ public:
         m_DelPtsNum = 0;
         m_AddPtsNum = 0;
 
-        m_CallsiteSet = CallsiteSet;
+        m_CallsiteSet  = CallsiteSet;
+        m_IsActIndexed = false;
 
         GetDefUseInfo();
     }
@@ -932,6 +977,9 @@ public:
         m_InstToDuMap.clear();
         m_ElemPtrMap.clear();    
         m_ElemSet.clear();
+
+        m_ActToCallsite.clear();
+        m_IsActIndexed = false;
     }
 
     inline VOID SetFormalPara (llvm::Instruction *Inst)
@@ -1009,6 +1057,7 @@ public:
 
 
     VOID  GetPDefUseInfo(std::set<llvm::Value*> *ValueSet);
+    VOID  CollectDefs(std::set<llvm::Value*> *ValueSet);
 };
 
 
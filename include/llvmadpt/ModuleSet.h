@@ -23,8 +23,11 @@
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include "common/SoftPara.h"
+#include "llvmadpt/FuncClass.h"
+#include "llvmadpt/FuncModIndex.h"
 
 #define MAX_MODULE_NUM (128)
+#define PIPELINE_MIN_CTX (2)
 
 typedef std::vector<llvm::Function*> T_FunVector;
 typedef std::set<llvm::Function*> T_FunSet;
@@ -39,6 +42,11 @@ typedef std::vector<llvm::GlobalVariable*>::iterator  global_iterator;
 
 typedef std::set<std::string> T_StringSet;
 
+/* called on the loading thread for each parsed module in id order */
+typedef VOID (*ModuleHook) (VOID *Ctx, llvm::Module *Mod);
+
+struct T_LoadTask;
+
 class GlobalSet
 {
 public:
@@ -123,14 +131,25 @@ class ModuleSet
 private:
     
     DWORD m_ModuleNum;
+    DWORD m_CtxNum;      /* owned contexts, 0 when the module is given */
     llvm::LLVMContext *m_LlvmCtx;
     std::unique_ptr<llvm::Module> *m_Modules;
+    std::vector<DWORD> m_LoadTime;
+
+    /* function bodies are read from the bitcode only when reachable from the entry */
+    BOOL  m_IsLazy;
+    DWORD m_BodyNum;
+    DWORD m_MaterialNum;
+
+    ModuleHook m_Hook;
+    VOID *m_HookCtx;
     std::map<DWORD, std::string> m_IdToName;
-    std::map<std::string, std::string> m_FuncToModule;
+    FuncModIndex m_FmIndex;
     std::vector<std::string> m_ModulePathVec;
 
     FunctionSet m_FuncSet;
     GlobalSet   m_GlobalSet;
+    FuncClass   m_FuncClass;
 
     llvm::Function *m_EntryFunc;
 
@@ -140,6 +159,11 @@ private:
 
     VOID loadModules(const std::vector<std::string> &modulePathVec);
     VOID loadOneModule(std::string &ModulePath, DWORD Id);
+    VOID ParseModule (const std::string &ModulePath, DWORD Id, llvm::LLVMContext &Ctx);
+    VOID loadParallel (DWORD CtxNum);
+    static VOID* LoadTask (VOID *Arg);
+    VOID ConsumeModules (std::vector<T_LoadTask> &Tasks);
+    VOID MaterializeReachable ();
 
     VOID InitFmMap();
 
@@ -199,7 +223,13 @@ public:
     ModuleSet() 
     {
         m_ModuleNum = 0;
+        m_CtxNum    = 0;
         m_LlvmCtx   = NULL;
+        m_IsLazy    = AF_FALSE;
+        m_BodyNum   = 0;
+        m_MaterialNum = 0;
+        m_Hook      = NULL;
+        m_HookCtx   = NULL;
         m_Modules   = NULL;
         m_EntryFunc = NULL;
     }
@@ -207,26 +237,36 @@ public:
     ~ModuleSet() 
     {
         m_ModuleNum = 0;
-        if (m_LlvmCtx != NULL)
-        {
-            delete m_LlvmCtx;
-            m_LlvmCtx = NULL;
-        }
 
+        /* the modules go before their contexts */
         if (m_Modules != NULL)
         {
-            delete m_Modules;
+            delete[] m_Modules;
             m_Modules = NULL;
-        }     
+        }
+
+        if (m_LlvmCtx != NULL && m_CtxNum != 0)
+        {
+            delete[] m_LlvmCtx;
+        }
+        m_LlvmCtx = NULL;
     }
 
     VOID PreProcess ();
 
+    /* pipelined load of an empty set: Hook runs on each module while later ones are parsed */
+    VOID LoadModules (const std::vector<std::string> &ModulePathVec, ModuleHook Hook, VOID *HookCtx);
+
     inline llvm::Function* GetEntryFunction ()
     {
         return m_EntryFunc;
     }
 
+    inline FuncClass* GetFuncClass ()
+    {
+        return &m_FuncClass;
+    }
+
 };
 
 class ModuleManage 
@@ -334,6 +374,18 @@ public:
         assert(m_ModuleSet != NULL);
         return m_ModuleSet->GetEntryFunction ();
     }
+
+    inline FuncClass* GetFuncClass ()
+    {
+        assert(m_ModuleSet != NULL);
+        return m_ModuleSet->GetFuncClass ();
+    }
+
+    inline VOID LoadModules (const std::vector<std::string> &ModulePathVec, ModuleHook Hook, VOID *HookCtx)
+    {
+        assert(m_ModuleSet != NULL);
+        m_ModuleSet->LoadModules (ModulePathVec, Hook, HookCtx);
+    }
 };
 
 
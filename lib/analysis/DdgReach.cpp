@@ -0,0 +1,161 @@
+//===- DdgReach.cpp -- sink reachability index over the data dependence ----//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+#include "analysis/DdgReach.h"
+#include "common/Stat.h"
+
+using namespace llvm;
+
+#define SCC_NONE  (0xFFFFFFFF)
+
+/* iterative tarjan: an SCC is closed after all SCCs it reaches, so the reachability
+   of its successors is final when it is closed */
+VOID DdgReach::Build ()
+{
+    DWORD StartTime = CLOCK_IN_MS ();
+    DWORD NodeNum = m_Dg->GetNodeNum ();
+
+    std::vector<DgNode*> Nodes (NodeNum + 1, NULL);
+    for (auto It = m_Dg->begin (), End = m_Dg->end (); It != End; It++)
+    {
+        if (It->first <= NodeNum)
+        {
+            Nodes[It->first] = It->second;
+        }
+    }
+
+    std::vector<bool> IsSink (NodeNum + 1, false);
+    for (auto It = m_Sinks->begin (), End = m_Sinks->end (); It != End; It++)
+    {
+        if ((*It)->GetId () <= NodeNum)
+        {
+            IsSink[(*It)->GetId ()] = true;
+        }
+    }
+
+    m_NodeToScc.assign (NodeNum + 1, SCC_NONE);
+    std::vector<DWORD> Index (NodeNum + 1, 0);
+    std::vector<DWORD> LowLink (NodeNum + 1, 0);
+    std::vector<DWORD> Stack;
+    std::vector<DWORD> Members;
+    std::vector<std::pair<DWORD, DWORD>> Dfs;
+    DWORD NextIndex = 1;
+
+    for (DWORD Root = 1; Root <= NodeNum; Root++)
+    {
+        if (Nodes[Root] == NULL || Index[Root] != 0)
+        {
+            continue;
+        }
+
+        Index[Root] = LowLink[Root] = NextIndex++;
+        Stack.push_back (Root);
+        Dfs.push_back (std::make_pair (Root, 0));
+
+        while (!Dfs.empty ())
+        {
+            DWORD Id = Dfs.back ().first;
+            DgNode::kind_range Edges = Nodes[Id]->OutEdges<EA_DD> ();
+            if (Dfs.back ().second < (DWORD)(Edges.end () - Edges.begin ()))
+            {
+                DgEdge *Edge = Edges.begin ()[Dfs.back ().second++];
+                DWORD DstId = Edge->GetDstNode ()->GetId ();
+                
+                if (Index[DstId] == 0)
+                {
+                    Index[DstId] = LowLink[DstId] = NextIndex++;
+                    Stack.push_back (DstId);
+                    Dfs.push_back (std::make_pair (DstId, 0));
+                }
+                else if (m_NodeToScc[DstId] == SCC_NONE)
+                {
+                    /* still on the stack */
+                    LowLink[Id] = std::min (LowLink[Id], Index[DstId]);
+                }
+                continue;
+            }
+
+            if (LowLink[Id] == Index[Id])
+            {
+                DWORD SccId = m_Scc.size ();
+                
+                T_ReachScc Scc;
+                Scc.m_Size      = 0;
+                Scc.m_HasSink   = false;
+                Scc.m_SuccReach = false;
+
+                Members.clear ();
+                DWORD Member;
+                do
+                {
+                    Member = Stack.back ();
+                    Stack.pop_back ();
+
+                    m_NodeToScc[Member] = SccId;
+                    Members.push_back (Member);
+                    Scc.m_Size++;
+                    Scc.m_HasSink |= IsSink[Member];
+                } while (Member != Id);
+
+                for (auto MIt = Members.begin (), MEnd = Members.end (); MIt != MEnd && !Scc.m_SuccReach; MIt++)
+                {
+                    for (DgEdge *Edge : Nodes[*MIt]->OutEdges<EA_DD> ())
+                    {
+                        DWORD DstScc = m_NodeToScc[Edge->GetDstNode ()->GetId ()];
+                        if (DstScc != SccId && IsReachScc (DstScc))
+                        {
+                            Scc.m_SuccReach = true;
+                            break;
+                        }
+                    }
+                }
+                
+                m_Scc.push_back (Scc);
+                if (IsReachScc (SccId))
+                {
+                    m_ReachNum += Scc.m_Size;
+                }
+            }
+
+            Dfs.pop_back ();
+            if (!Dfs.empty ())
+            {
+                DWORD ParentId = Dfs.back ().first;
+                LowLink[ParentId] = std::min (LowLink[ParentId], LowLink[Id]);
+            }
+        }
+    }
+
+    m_BuildTime = CLOCK_IN_MS () - StartTime;
+    return;
+}
+
+VOID DdgReach::PrintStat ()
+{
+    DWORD MaxSize = 0;
+    for (auto It = m_Scc.begin (), End = m_Scc.end (); It != End; It++)
+    {
+        MaxSize = std::max (MaxSize, It->m_Size);
+    }
+
+    DWORD Size = m_NodeToScc.size () * sizeof (DWORD) + m_Scc.size () * sizeof (T_ReachScc);
+    printf ("DdgReach: %u nodes, %u sccs (largest %u), %u nodes reach a sink, %u (KB), %u (ms)\r\n",
+            (DWORD)m_NodeToScc.size () - 1, (DWORD)m_Scc.size (), MaxSize, m_ReachNum, Size/1024, m_BuildTime);
+    return;
+}
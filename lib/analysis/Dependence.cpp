@@ -18,9 +18,14 @@
 //
 //===----------------------------------------------------------------------===//
 #include <llvm/IR/InstIterator.h>
+#include <llvm/ADT/SCCIterator.h>
 #include "analysis/Dependence.h"
+#include "analysis/DgSnapshot.h"
 #include "common/WorkList.h"
+#include "common/VisitMark.h"
 #include "common/Stat.h"
+#include "common/SoftPara.h"
+#include "callgraph/CgScheduler.h"
 
 
 using namespace llvm;
@@ -169,14 +174,8 @@ VOID FuncDg::ReachingDefs ()
             /* calculate inset */
             if (Fit != Head)
             {
-                for (auto Eit = CurNode->InEdgeBegin(), Eend = CurNode->InEdgeEnd (); Eit != Eend; Eit++)
+                for (DgEdge *Edge : CurNode->InEdges<EA_CFG> ())
                 {
-                    DgEdge *Edge = *Eit;
-                    if (!(Edge->GetAttr () & EA_CFG))
-                    {
-                        continue;
-                    }
-                    
                     PreNode = Edge->GetSrcNode ();
                     for (auto Oit = PreNode->OutBegin (), Oend = PreNode->OutEnd (); Oit != Oend; Oit++)
                     {
@@ -225,6 +224,16 @@ VOID FuncDg::UpdateGlobalDd ()
         }
 
         UseInstSet = &(Itu->second);
+        if (m_Dg->IsGlobHub ())
+        {
+            DgNode *HubNode = m_Dg->GetHubNode (ValUse, DefInstSet);
+            for (auto Iit = UseInstSet->begin(), Iend = UseInstSet->end(); Iit != Iend; Iit++)
+            {
+                m_Dg->AddDdgEdge (HubNode, m_Dg->GetDgNode (*Iit), ValUse);
+            }
+            continue;
+        }
+        
         for (auto Iit = UseInstSet->begin(), Iend = UseInstSet->end(); Iit != Iend; Iit++)
         {
             DgNode *UseNode = m_Dg->GetDgNode (*Iit);
@@ -292,6 +301,17 @@ VOID FuncDg::BuildDdg ()
     ClearMem ();
 }
 
+/* drop the dataflow state without computing the ddg, for functions whose ddg is imported */
+VOID FuncDg::ReleaseDdg ()
+{
+    for (auto it = m_FuncDgNode.begin(), End = m_FuncDgNode.end(); it != End; it++)
+    {
+        (*it)->ClearMem();
+    }
+
+    ClearMem ();
+}
+
 
 VOID DgGraph::BuildCfg ()
 {
@@ -405,6 +425,8 @@ VOID DgGraph::BuildInterCfg ()
 
 VOID DgGraph::BuildDdg ()
 {
+    DWORD StartTime = CLOCK_IN_MS();
+    
     /* 1. intra data depence */
     BuildIntraDdg ();
 
@@ -413,153 +435,248 @@ VOID DgGraph::BuildDdg ()
 
     /* 3. update global dd */
     UpdateGlobalDd();
+
+    m_DdgTime = CLOCK_IN_MS() - StartTime;
 }
 
 VOID DgGraph::BuildIntraDdg ()
 {
     FuncDg *Fdg;
-    Function *Func;
+    Function *Func = NULL;
     DWORD FuncId = 0;
     DWORD FuncNum = m_CallGraph->GetNodeNum ();
     CallGraphNode *CgNode;
 
-    for (auto GIt = m_CallGraph->begin (), End = m_CallGraph->end (); GIt != End; GIt++)
+    SetOrigin (EO_INTRA);
+
+    /* the intra ddg of a function reads the out sets of its inter-cfg neighbors,
+       the scheduler runs callees first and an SCC in one task */
+    std::string ThreadPara = llaf::GetParaValue (PARA_THREAD_NUM);
+    if (ThreadPara != "" && atoi (ThreadPara.c_str()) >= 1)
     {
-        CgNode = GIt->second;
-        Func = CgNode->GetFunction ();
-        ++FuncId;
+        CgScheduler Sch (m_CallGraph);
+        Sch.Run ("IntraDdg", IntraDdgTask, this, (DWORD)atoi (ThreadPara.c_str()));
         
-        if (!CgNode->IsReachable() || Func->getInstructionCount() == 0)
+        printf("IntraDdg: %u sccs in %u waves\r\n", Sch.GetSccNum (), Sch.GetWaveNum ());
+        FuncId = FuncNum;
+    }
+    else
+    {
+        for (auto GIt = m_CallGraph->begin (), End = m_CallGraph->end (); GIt != End; GIt++)
         {
-            continue;
-        } 
+            CgNode = GIt->second;
+            Func = CgNode->GetFunction ();
+            ++FuncId;
+        
+            if (!CgNode->IsReachable() || Func->getInstructionCount() == 0)
+            {
+                continue;
+            } 
         
 
-        Fdg = GetFuncDg (Func);
-        assert (Fdg != NULL);
+            Fdg = GetFuncDg (Func);
+            assert (Fdg != NULL);
     
-        Fdg->BuildDdg ();
+            Fdg->BuildDdg ();
 
-        printf("IntraDdg:[%-8d/%-8d] - (V,E):(%-8d, %-8d) => process function:%-32s\r", 
-                   FuncId, FuncNum, m_NodeNum, m_EdgeNum, Func->getName().data());
-    }  
+            printf("IntraDdg:[%-8d/%-8d] - (V,E):(%-8d, %-8d) => process function:%-32s\r", 
+                       FuncId, FuncNum, m_NodeNum, m_EdgeNum, Func->getName().data());
+        }  
+    }
 
     printf("IntraDdg:[%-8d/%-8d] - (V,E):(%-8d, %-8d) => process function:%-64s\r\n", 
-                   FuncId, FuncNum, m_NodeNum, m_EdgeNum, Func->getName().data());  
+                   FuncId, FuncNum, m_NodeNum, m_EdgeNum, (Func != NULL) ? Func->getName().data() : "");  
 
     return;
 }
 
-VOID DgGraph::RelateActPara(FuncDg* CalleeFdg, DgNode *CsNode)
+VOID DgGraph::IntraDdgTask (VOID *Ctx, Function *Func)
 {
-    T_ElemSet *PDefElemSet = CalleeFdg->GetActDefNode ();
-    if (PDefElemSet->size() == 0)
+    DgGraph *Dg = (DgGraph *)Ctx;
+
+    FuncDg *Fdg = Dg->GetFuncDg (Func);
+    assert (Fdg != NULL);
+    
+    Fdg->BuildDdg ();
+    return;
+}
+
+/* summary of a callee, the defs through pointer paras and the formal store nodes
+   are fixed once the intra ddg is built */
+T_CalleeSum* DgGraph::GetCalleeSum (FuncDg *Fdg)
+{
+    Function *Callee = Fdg->GetFunction ();
+    auto It = m_CalleeSum.find (Callee);
+    if (It != m_CalleeSum.end())
     {
-        return;
+        return &(It->second);
+    }
+
+    T_CalleeSum &Sum = m_CalleeSum[Callee];
+    InstAnalyzer *InstAlz = Fdg->GetInstAlz ();
+
+    Sum.m_HasPDef = (Fdg->GetActDefNode ()->size() != 0);
+    for (llvm::Function::arg_iterator fItr = Callee->arg_begin(); fItr != Callee->arg_end(); ++fItr) 
+    {
+        llvm::Instruction *Inst = InstAlz->GetFpInst (&*fItr);
+        Sum.m_FpNode.push_back ((Inst != NULL) ? GetDgNode (Inst) : NULL);
     }
 
-    /* BFS the graph node */
-    std::set<DgNode*> Visited;
-    ComQueue<DgNode *> Queue;
-    DgNode *CurNode  = CsNode;
-    for (auto it = CurNode->OutEdgeBegin (), end = CurNode->OutEdgeEnd ();
-            it != end; it++)
+    if (Fdg->GetRetInst() != NULL)
     {
-        DgEdge *Edge = *it;
-        if (!(Edge->GetAttr () & EA_CFG) || (Edge->GetAttr () & EA_CALL))
-        {
-            continue;
-        }
+        Sum.m_RetNode = GetDgNode (Fdg->GetRetInst());
+    }
 
-        if (Edge->GetAttr () & EA_RET)
-        {
-            return;
-        }
-            
-        Queue.InQueue (Edge->GetDstNode ());
+    return &Sum;
+}
+
+/* built on the first call site of a caller with a callee defining through pointer paras */
+T_CallerIndex* DgGraph::GetCallerIndex (Function *Caller)
+{
+    auto It = m_CallerIndex.find (Caller);
+    if (It != m_CallerIndex.end())
+    {
+        return &(It->second);
     }
 
-    Element Em;
-    while (!Queue.IsEmpty ())
+    T_CallerIndex &Index = m_CallerIndex[Caller];
+
+    DWORD BbNum = 0;
+    for (Function::iterator Bit = Caller->begin(), Bend = Caller->end(); Bit != Bend; ++Bit)
+    {
+        Index.m_BbIdx[&*Bit] = BbNum++;
+    }
+
+    /* sccs come after the sccs they reach */
+    for (scc_iterator<Function*> Sit = scc_begin (Caller); !Sit.isAtEnd (); ++Sit)
     {
-        CurNode = Queue.OutQueue ();
-        if (Visited.find (CurNode) != Visited.end())
+        const std::vector<BasicBlock*> &Scc = *Sit;
+        DWORD SccId = Index.m_SccReach.size ();
+        
+        Index.m_SccReach.push_back (BitVector (BbNum));
+        BitVector &Reach = Index.m_SccReach.back ();
+        for (auto Bit = Scc.begin (), Bend = Scc.end (); Bit != Bend; Bit++)
         {
-            continue;
+            Index.m_BbToScc[*Bit] = SccId;
         }
-        else
+
+        /* an edge inside the scc: every block of it reaches every other */
+        BOOL IsCycle = (Scc.size () > 1);
+        for (auto Bit = Scc.begin (), Bend = Scc.end (); Bit != Bend; Bit++)
+        {
+            for (BasicBlock* SucBb : successors(*Bit)) 
+            {
+                DWORD SucScc = Index.m_BbToScc[SucBb];
+                if (SucScc != SccId)
+                {
+                    Reach.set (Index.m_BbIdx[SucBb]);
+                    Reach |= Index.m_SccReach[SucScc];
+                }
+                else
+                {
+                    IsCycle = AF_TRUE;
+                }
+            }
+        }
+
+        for (auto Bit = Scc.begin (), Bend = Scc.end (); Bit != Bend && IsCycle; Bit++)
         {
-            Visited.insert (CurNode);
+            Reach.set (Index.m_BbIdx[*Bit]);
         }
+    }
 
-        /* if  GetElementPtr */
-        Instruction *Inst = CurNode->GetInst ();
-        if (llvmAdpt::IsGepInst (Inst))
+    for (Function::iterator Bit = Caller->begin(), Bend = Caller->end(); Bit != Bend; ++Bit)
+    {
+        DWORD Pos = 0;
+        for (BasicBlock::iterator Iit = Bit->begin(), Iend = Bit->end(); Iit != Iend; ++Iit)
         {
-            Em.Base   = llvmAdpt::GetElemBaseValue(Inst->getOperand (0));
-            Em.Offset = Inst->getOperand (Inst->getNumOperands ()-1);
-            auto It = PDefElemSet->find (Em);
-            if (It != PDefElemSet->end())
+            Instruction *Inst = &*Iit;
+            Index.m_InstPos[Inst] = Pos++;
+
+            auto NIt = m_InstToNode.find (Inst);
+            if (NIt == m_InstToNode.end () || NIt->second == NULL)
+            {
+                continue;
+            }
+            DgNode *Node = NIt->second;
+
+            if (llvmAdpt::IsGepInst (Inst))
+            {
+                Value *Base = llvmAdpt::GetElemBaseValue(Inst->getOperand (0));
+                T_ElemOffset Offset = llvmAdpt::GetElemOffset (Inst->getOperand (Inst->getNumOperands ()-1));
+                Index.m_GepUse[std::make_pair (Base, Offset)].push_back (Node);
+                continue;
+            }
+
+            DefUse *Du = Node->GetDefUse ();
+            if (Du == NULL)
+            {
+                continue;
+            }
+
+            for (auto Uit = Du->UseBegin (), Uend = Du->UseEnd (); Uit != Uend; Uit++)
             {
-                AddDdgEdge (GetDgNode(It->DefInst), CurNode, It->DefVal);
+                if (!Du->IsPUse (*Uit))
+                {
+                    Index.m_ValUse[*Uit].push_back (Node);
+                }
             }
         }
-        else
+    }
+
+    return &Index;
+}
+
+/* the defs of the callee through pointer paras reach the uses after the call site:
+   a gep of the element, or a use of the base, by its whole-base element if defined */
+VOID DgGraph::RelateActPara(FuncDg* CalleeFdg, DgNode *CsNode)
+{
+    T_ElemSet *PDefElemSet = CalleeFdg->GetActDefNode ();
+    Instruction *CsInst = CsNode->GetInst ();
+    T_CallerIndex *Index = GetCallerIndex (CsNode->GetFunction ());
+
+    Element Em;
+    for (auto Eit = PDefElemSet->begin(), Eend = PDefElemSet->end(); Eit != Eend; Eit++)
+    {
+        DgNode *DefNode = GetDgNode(Eit->DefInst);
+
+        auto GIt = Index->m_GepUse.find (std::make_pair (Eit->Base, Eit->Offset));
+        if (GIt != Index->m_GepUse.end ())
         {
-            DefUse *Du = CurNode->GetDefUse ();
-            if (Du != NULL)
+            for (auto Nit = GIt->second.begin(), Nend = GIt->second.end(); Nit != Nend; Nit++)
             {
-                for (auto it = Du->UseBegin (), end = Du->UseEnd (); it != end; it++)
+                if (Index->IsAfter (CsInst, (*Nit)->GetInst ()))
                 {
-                    llvm::Value *Val = *it;
-                    if (Du->IsPUse (Val))
-                    {
-                        continue;
-                    }
-
-                    Em.Base   = Val;
-                    Em.Offset = NULL;
-                    auto DfIt = PDefElemSet->find (Em);
-                    if (DfIt == PDefElemSet->end())
-                    {
-                        for (auto dit = PDefElemSet->begin(), dend = PDefElemSet->end(); 
-                             dit != dend; dit++)
-                        {
-                            if (dit->Base == Val)
-                            {
-                                AddDdgEdge (GetDgNode(dit->DefInst), CurNode, Val);
-                            }
-                        }
-                    }
-                    else
-                    {
-                        AddDdgEdge (GetDgNode(DfIt->DefInst), CurNode, Val);
-                    }
+                    AddDdgEdge (DefNode, *Nit, Eit->DefVal);
                 }
             }
         }
-        
 
-        /* iterate all children node */
-        for (auto it = CurNode->OutEdgeBegin (), end = CurNode->OutEdgeEnd ();
-            it != end; it++)
+        if (Eit->Offset.first != OFF_NONE)
         {
-            DgEdge *Edge = *it;
-            if (!(Edge->GetAttr () & EA_CFG) || (Edge->GetAttr () & EA_CALL))
+            Em.Base   = Eit->Base;
+            Em.Offset = ELEM_WHOLE;
+            if (PDefElemSet->find (Em) != PDefElemSet->end())
             {
                 continue;
             }
+        }
+
+        auto VIt = Index->m_ValUse.find (Eit->Base);
+        if (VIt == Index->m_ValUse.end ())
+        {
+            continue;
+        }
 
-            if (Edge->GetAttr () & EA_RET)
+        for (auto Nit = VIt->second.begin(), Nend = VIt->second.end(); Nit != Nend; Nit++)
+        {
+            if (Index->IsAfter (CsInst, (*Nit)->GetInst ()))
             {
-                return;
+                AddDdgEdge (DefNode, *Nit, Eit->Base);
             }
-            
-            Queue.InQueue (Edge->GetDstNode ());
         }
     }
 
-
     return;
 }
 
@@ -584,18 +701,12 @@ llvm::Value* DgGraph::GetFpByAp(llvm::ImmutableCallSite &Cs, llvm::Function* Fun
 
 VOID DgGraph::RelateFpRet(FuncDg* Fdg, DgNode *CsNode, Function *Callee)
 {
-    InstAnalyzer *InstAlz = Fdg->GetInstAlz ();
+    T_CalleeSum *Sum = GetCalleeSum (Fdg);
     llvm::ImmutableCallSite Cs(CsNode->GetInst ());
 
     DWORD DdEdgeNum = 0;
-    for (auto it = CsNode->InEdgeBegin (), end = CsNode->InEdgeEnd (); it != end; it++)
+    for (DgEdge *dgEdge : CsNode->InEdges<EA_DD> ())
     {
-        DgEdge *dgEdge = *it;
-        if (!(dgEdge->GetAttr () & EA_DD))
-        {
-            continue;
-        }
-
         llvm::Value *ActualPara = dgEdge->GetEdgeValue ();
         assert (ActualPara != NULL);
 
@@ -605,13 +716,12 @@ VOID DgGraph::RelateFpRet(FuncDg* Fdg, DgNode *CsNode, Function *Callee)
             continue;
         }
 
-        llvm::Instruction *Inst = InstAlz->GetFpInst (FormalPara);
-        if (Inst == NULL)
+        DgNode *UseNode = Sum->m_FpNode[llvm::cast<llvm::Argument>(FormalPara)->getArgNo ()];
+        if (UseNode == NULL)
         {
             continue;
         }
 
-        DgNode *UseNode = GetDgNode (Inst);
         DgNode *DefNode = dgEdge->GetSrcNode ();
         if (DefNode->GetFunction () == CsNode->GetFunction ())
         {
@@ -649,22 +759,41 @@ VOID DgGraph::RelateFpRet(FuncDg* Fdg, DgNode *CsNode, Function *Callee)
         return;
     }
 
-    DgNode *RetNode = GetDgNode (Fdg->GetRetInst());
+    /* the ret node may gain dd edges during this pass: checked per call site */
+    DgNode *RetNode = Sum->m_RetNode;
     if (RetNode == NULL)
     {
         return;
     }
 
-    for (auto it = RetNode->InEdgeBegin (), end = RetNode->InEdgeEnd (); it != end; it++)
+    if (RetNode->InEdgeNum<EA_DD> () != 0)
+    {
+        AddDdgRetEdge (RetNode, CsNode, CsNode->GetDDef());
+    }
+
+    return;
+}
+
+
+VOID DgGraph::RelateCallSite (DgNode *CallSiteNode, CallGraphEdgeSet *CgEdgeSet)
+{
+    for (auto EgIt = CgEdgeSet->begin(), EgEnd = CgEdgeSet->end(); EgIt != EgEnd; EgIt++)
     {
-        DgEdge *dgEdge = *it;
-        if (!(dgEdge->GetAttr () & EA_DD))
+        CallGraphEdge *CgEdge = *EgIt;
+        
+        Function *Callee = CgEdge->GetDstNode()->GetFunction ();
+        FuncDg *CalleeFdg = GetFuncDg (Callee);
+        if (CalleeFdg == NULL)
         {
             continue;
         }
 
-        AddDdgRetEdge (RetNode, CsNode, CsNode->GetDDef());
-        break;
+        if (GetCalleeSum (CalleeFdg)->m_HasPDef)
+        {
+            RelateActPara (CalleeFdg, CallSiteNode);
+        }
+
+        RelateFpRet(CalleeFdg, CallSiteNode, Callee);
     }
 
     return;
@@ -676,7 +805,9 @@ VOID DgGraph::BuildInterDdg ()
     DWORD Index = 0;
     DWORD CsNum = m_CallGraph->GetCallsiteNum();
     T_CallSitePair CsPair;
+    DWORD StartTime = CLOCK_IN_MS();
 
+    Stat::StartTime ("InterDdg");
     for (auto It = m_CallGraph->CItoIdBegin (), End = m_CallGraph->CItoIdEnd (); It != End; It++)
     {
         ++Index;
@@ -696,25 +827,15 @@ VOID DgGraph::BuildInterDdg ()
             continue;
         }
 
-        
-        for (auto EgIt = CgEdgeSet->begin(), EgEnd = CgEdgeSet->end(); EgIt != EgEnd; EgIt++)
-        {
-            CallGraphEdge *CgEdge = *EgIt;
-            
-            Function *Callee = CgEdge->GetDstNode()->GetFunction ();
-            FuncDg *CalleeFdg = GetFuncDg (Callee);
-            if (CalleeFdg == NULL)
-            {
-                continue;
-            }
-
-            RelateActPara (CalleeFdg, CallSiteNode);
-
-            RelateFpRet(CalleeFdg, CallSiteNode, Callee);
-        }
+        SetOrigin (EO_INTER, CallSiteNode);
+        RelateCallSite (CallSiteNode, CgEdgeSet);
     }
+    SetOrigin (EO_INTER);
+    Stat::EndTime ("InterDdg");
 
-    printf ("InterDdg[ %-8d/%-8d ]\r\n", Index, CsNum);
+    printf ("InterDdg[ %-8d/%-8d ] - %u callee summaries, %u caller indexes, time %u (ms)\r\n", 
+            Index, CsNum, (DWORD)m_CalleeSum.size (), (DWORD)m_CallerIndex.size (), (DWORD)(CLOCK_IN_MS() - StartTime));
+    m_CallerIndex.clear ();
     return;
 }
 
@@ -731,9 +852,18 @@ VOID DgGraph::BuildDgGraph()
     UpdatePtsByFs();
 
     /* 4. buid ddg */
-    BuildDdg ();
+    std::string IncrMode = m_IsRef ? "" : llaf::GetParaValue (PARA_DDG_INCREMENTAL);
+    if (IncrMode != "1" || !BuildIncrDdg ())
+    {
+        BuildDdg ();
+
+        if (IncrMode == "verify")
+        {
+            VerifyIncrDdg ();
+        }
+    }
 
-    if (llaf::GetParaValue (PARA_DDG_DUMP) == "1")
+    if (!m_IsRef && llaf::GetParaValue (PARA_DDG_DUMP) == "1")
     {
         DfgViz dfgViz(string("DDG"), this);
         dfgViz.WiteGraph ();
@@ -742,100 +872,502 @@ VOID DgGraph::BuildDgGraph()
     return;
 }
 
-VOID DgGraph::UpdatePtsByFs()
+BOOL DgGraph::LoadDgGraph ()
 {
-    FuncDg *Fdg;
-    Function *Func;
-    DWORD FuncId = 0;
-    DWORD FuncNum = m_CallGraph->GetNodeNum ();
-    CallGraphNode *CgNode;
+    std::string SnapPath = llaf::GetParaValue (PARA_DDG_SNAPSHOT);
+    if (SnapPath != "")
+    {
+        DgSnapshot Snapshot (this, SnapPath);
+        return Snapshot.Load ();
+    }
 
-    for (auto GIt = m_CallGraph->begin (), End = m_CallGraph->end (); GIt != End; GIt++)
+    /* the ddg phase of a resumed run, the snapshot checks the input itself */
+    SnapPath = Checkpoint::GetResumeSnap ();
+    if (SnapPath == "")
     {
-        CgNode = GIt->second;
-        Func = CgNode->GetFunction ();
-        ++FuncId;
-        
-        if (!CgNode->IsReachable() || Func->getInstructionCount() == 0)
-        {
-            continue;
-        }  
+        return AF_FALSE;
+    }
 
-        if (m_UpdatePtsFunc.find (Func) != m_UpdatePtsFunc.end())
-        {
-            continue;
-        }
-        
-        printf("2-UpdatePts:[%-8d/%-8d] %-64s\r", FuncId, FuncNum, Func->getName ().data()); 
+    DWORD StartTime = Stat::GetWallTime ();
+    DgSnapshot Snapshot (this, SnapPath);
+    if (!Snapshot.Load ())
+    {
+        return AF_FALSE;
+    }
+    Checkpoint::Report ("read", CK_DDG, SnapPath, Stat::GetWallTime () - StartTime);
 
-        Fdg = GetFuncDg (Func);
-        assert (Fdg != NULL);
-    
-        InstAnalyzer *InstAnly = Fdg->GetInstAlz();
-        InstAnly->GetPDefUseInfo (NULL);
+    return AF_TRUE;
+}
 
-    }  
+VOID DgGraph::StoreDgGraph ()
+{
+    std::string SnapPath = llaf::GetParaValue (PARA_DDG_SNAPSHOT);
+    if (SnapPath != "")
+    {
+        DgSnapshot Snapshot (this, SnapPath);
+        Snapshot.Store ();
+    }
 
-    printf("2-UpdatePts:[%-8d/%-8d]\r\n", FuncId, FuncNum);   
+    SnapPath = Checkpoint::GetStoreSnap ();
+    if (SnapPath != "")
+    {
+        DWORD StartTime = Stat::GetWallTime ();
+        DgSnapshot Snapshot (this, SnapPath);
+        Snapshot.Store ();
+        Checkpoint::Report ("write", CK_DDG, SnapPath, Stat::GetWallTime () - StartTime);
+        Checkpoint::StampSnap ();
+    }
 
     return;
 }
 
-
-VOID DgGraph::UpdatePtsByFs(std::vector<Function*> &NodeStack)
+/* changed bodies or pts, and the callees whose flow-sensitive pts may see them on the call path */
+VOID DgGraph::GetDirtyFunc (DgSnapshot &Snapshot, std::set<Function*> &Dirty)
 {
-    for (auto it = NodeStack.begin(), end = NodeStack.end(); it != end; it++)
+    std::vector<Function*> CurFuncs;
+
+    for (auto GIt = m_CallGraph->begin (), End = m_CallGraph->end (); GIt != End; GIt++)
     {
-        Function *CurFunc = *it;
+        Function *Func = GIt->second->GetFunction ();
+        if (GetFuncDg (Func) == NULL || Snapshot.IsFuncSame (Func))
+        {
+            continue;
+        }
 
-        FuncDg *Fdg = GetFuncDg (CurFunc);
-        assert (Fdg != NULL);
+        Dirty.insert (Func);
+        CurFuncs.push_back (Func);
+    }
 
-        InstAnalyzer *InstAnly = Fdg->GetInstAlz();
-        
-        InstAnly->GetPDefUseInfo (&m_ValueSet);
+    DWORD Depth = m_CallGraph->GetPathDepth ();
+    while (Depth-- && !CurFuncs.empty ())
+    {
+        std::vector<Function*> NxtFuncs;
+        for (auto It = CurFuncs.begin (), End = CurFuncs.end (); It != End; It++)
+        {
+            CallGraphNode *CgNode = m_CallGraph->GetCgNode (*It);
+            for (auto EIt = CgNode->OutEdgeBegin (), EEnd = CgNode->OutEdgeEnd (); EIt != EEnd; EIt++)
+            {
+                Function *Callee = (*EIt)->GetDstNode ()->GetFunction ();
+                if (GetFuncDg (Callee) != NULL && Dirty.insert (Callee).second)
+                {
+                    NxtFuncs.push_back (Callee);
+                }
+            }
+        }
 
-        m_UpdatePtsFunc.insert(CurFunc);
+        CurFuncs.swap (NxtFuncs);
     }
 
-    m_ValueSet.clear();
-    
     return;
 }
 
+/* a return node without intra dd edge may get its first one from a call site, which
+   RelateFpRet of the callers reads: those callers must be recomputed as well */
+BOOL DgGraph::IsRetUnstable (Function *Func)
+{
+    FuncDg *Fdg = GetFuncDg (Func);
+    if (Fdg == NULL || Fdg->GetRetInst () == NULL)
+    {
+        return AF_FALSE;
+    }
 
-VOID DgGraph::UpdateGlobalDd()
+    DgNode *RetNode = GetDgNode (Fdg->GetRetInst ());
+    if (RetNode == NULL)
+    {
+        return AF_FALSE;
+    }
+
+    for (DgEdge *Edge : RetNode->InEdges<EA_DD> ())
+    {
+        if (Edge->GetOrigin () == EO_INTRA)
+        {
+            return AF_FALSE;
+        }
+    }
+
+    return AF_TRUE;
+}
+
+/* functions whose call sites are recomputed: dirty or changed cfg, callers of a dirty function,
+   and transitively the callers of such a function whose return node is unstable */
+VOID DgGraph::GetDirtyCaller (DgSnapshot &Snapshot, std::set<Function*> &Dirty, 
+                              std::set<Function*> &DirtyCaller)
 {
-    FuncDg *Fdg;
-    Function *Func;
-    DWORD FuncId = 0;
-    DWORD FuncNum = m_CallGraph->GetNodeNum ();
-    CallGraphNode *CgNode;
+    std::vector<Function*> WorkList;
 
     for (auto GIt = m_CallGraph->begin (), End = m_CallGraph->end (); GIt != End; GIt++)
     {
-        CgNode = GIt->second;
-        Func = CgNode->GetFunction ();
-        ++FuncId;
-        
-        if (!CgNode->IsReachable() || Func->getInstructionCount() == 0)
+        Function *Func = GIt->second->GetFunction ();
+        if (GetFuncDg (Func) == NULL)
         {
             continue;
-        }  
+        }
 
-        if (!(FuncId%100))
+        if (Dirty.find (Func) != Dirty.end() || !Snapshot.IsCfgSame (Func))
         {
-            printf("3-UpdateGlobalDd:[%-8d/%-8d] %-64s\r", FuncId, FuncNum, Func->getName ().data());
+            DirtyCaller.insert (Func);
+            WorkList.push_back (Func);
         }
+    }
 
-        Fdg = GetFuncDg (Func);
-        assert (Fdg != NULL);
+    while (!WorkList.empty ())
+    {
+        Function *Func = WorkList.back ();
+        WorkList.pop_back ();
+
+        if (Dirty.find (Func) == Dirty.end() && !IsRetUnstable (Func))
+        {
+            continue;
+        }
+
+        T_CallciteSet *InCallSite = m_CallGraph->GetCgNode (Func)->GetInCallSite ();
+        for (auto It = InCallSite->begin (), End = InCallSite->end (); It != End; It++)
+        {
+            Function *Caller = (*It)->getParent ()->getParent ();
+            if (DirtyCaller.insert (Caller).second)
+            {
+                WorkList.push_back (Caller);
+            }
+        }
+    }
+
+    return;
+}
+
+/* the ddg of an older input is reused where its inputs did not change:
+   cfg and pts are always computed in full, the ddg is rebuilt for the dirty functions
+   and the call sites depending on them, and imported from the snapshot elsewhere */
+BOOL DgGraph::BuildIncrDdg ()
+{
+    std::string SnapPath = llaf::GetParaValue (PARA_DDG_SNAPSHOT);
+    if (SnapPath == "")
+    {
+        printf ("%s -ddg-incremental needs -ddg-snapshot, full build.\r\n", WarnMsg("DdgIncremental:").c_str());
+        return AF_FALSE;
+    }
+
+    DgSnapshot Snapshot (this, SnapPath);
+    if (!Snapshot.Open ())
+    {
+        return AF_FALSE;
+    }
+
+    Stat::StartTime ("IncrementalDdg");
+    DWORD StartTime = CLOCK_IN_MS();
+
+    std::set<Function*> Dirty;
+    GetDirtyFunc (Snapshot, Dirty);
+
+    /* 1. intra data depence: rebuild or import */
+    DWORD FuncNum = 0;
+    SetOrigin (EO_INTRA);
+    for (auto GIt = m_CallGraph->begin (), End = m_CallGraph->end (); GIt != End; GIt++)
+    {
+        Function *Func = GIt->second->GetFunction ();
+        FuncDg *Fdg = GetFuncDg (Func);
+        if (Fdg == NULL)
+        {
+            continue;
+        }
+        FuncNum++;
+
+        if (Dirty.find (Func) != Dirty.end())
+        {
+            Fdg->BuildDdg ();
+        }
+        else
+        {
+            Snapshot.ImportIntraDdg (Func);
+            Fdg->ReleaseDdg ();
+        }
+    }
+
+    /* 2. inter data depence: call sites in the order of a full build, RelateFpRet reads
+          the dd edges the earlier ones added */
+    std::set<Function*> DirtyCaller;
+    GetDirtyCaller (Snapshot, Dirty, DirtyCaller);
+
+    DWORD CsNum = 0;
+    DWORD RelateNum = 0;
+    for (auto It = m_CallGraph->CItoIdBegin (), End = m_CallGraph->CItoIdEnd (); It != End; It++)
+    {
+        llvm::Instruction *Inst = It->first.first.getInstruction ();
+        CallGraphEdgeSet *CgEdgeSet = m_CallGraph->GetCgEdgeSet (Inst);
+        assert (CgEdgeSet != NULL);
+
+        DgNode *CallSiteNode = GetDgNode (Inst);
+        if (CallSiteNode == NULL)
+        {
+            continue;
+        }
+        CsNum++;
+
+        SetOrigin (EO_INTER, CallSiteNode);
+        if (DirtyCaller.find (CallSiteNode->GetFunction ()) != DirtyCaller.end())
+        {
+            RelateCallSite (CallSiteNode, CgEdgeSet);
+            RelateNum++;
+        }
+        else
+        {
+            Snapshot.ImportInterDdg (CallSiteNode);
+        }
+    }
+    SetOrigin (EO_INTER);
+    m_CallerIndex.clear ();
+
+    /* 3. global dd only depends on loads and stores, cheap to redo */
+    UpdateGlobalDd();
+
+    DWORD IncrTime = CLOCK_IN_MS() - StartTime;
+    m_DdgTime = Snapshot.GetDdgTime ();
+
+    printf ("DdgIncremental: rebuild %u/%u functions, relate %u/%u call sites, import %u edges\r\n", 
+            (DWORD)Dirty.size (), FuncNum, RelateNum, CsNum, Snapshot.GetImportNum ());
+    printf ("DdgIncremental: ddg time %u (ms), full build %u (ms), saved %d (ms)\r\n", 
+            IncrTime, m_DdgTime, (int)m_DdgTime - (int)IncrTime);
+    if (Snapshot.GetLostNum () != 0)
+    {
+        printf ("%s %u imported edges lost an end node, check with -ddg-incremental=verify.\r\n", 
+                WarnMsg("DdgIncremental:").c_str(), Snapshot.GetLostNum ());
+    }
+    Stat::EndTime ("IncrementalDdg");
+
+    return AF_TRUE;
+}
+
+/* after a full build: what an incremental build would import must equal what was just built */
+VOID DgGraph::VerifyIncrDdg ()
+{
+    std::string SnapPath = llaf::GetParaValue (PARA_DDG_SNAPSHOT);
+    if (SnapPath == "")
+    {
+        return;
+    }
+
+    DgSnapshot Snapshot (this, SnapPath);
+    if (!Snapshot.Open ())
+    {
+        return;
+    }
+
+    std::set<Function*> Dirty;
+    GetDirtyFunc (Snapshot, Dirty);
+
+    std::set<Function*> DirtyCaller;
+    GetDirtyCaller (Snapshot, Dirty, DirtyCaller);
+
+    DWORD FuncNum = 0;
+    DWORD CheckNum = 0;
+    DWORD DiffNum = 0;
+    for (auto GIt = m_CallGraph->begin (), End = m_CallGraph->end (); GIt != End; GIt++)
+    {
+        Function *Func = GIt->second->GetFunction ();
+        if (GetFuncDg (Func) == NULL)
+        {
+            continue;
+        }
+        FuncNum++;
+
+        if (Dirty.find (Func) != Dirty.end())
+        {
+            continue;
+        }
+        CheckNum++;
+
+        if (!Snapshot.VerifyIntraDdg (Func))
+        {
+            printf ("%s intra ddg of %s differs from the snapshot\r\n", ErrMsg("DdgIncremental:").c_str(), Func->getName ().data());
+            DiffNum++;
+        }
+    }
+
+    llvm::DenseMap<DgNode*, std::vector<T_InterEdge*>> CsToFresh;
+    for (auto It = m_InterLog.begin (), End = m_InterLog.end (); It != End; It++)
+    {
+        CsToFresh[It->m_CsNode].push_back (&(*It));
+    }
+
+    std::set<DgNode*> CheckCs;
+    for (auto It = m_CallGraph->CItoIdBegin (), End = m_CallGraph->CItoIdEnd (); It != End; It++)
+    {
+        DgNode *CallSiteNode = GetDgNode (It->first.first.getInstruction ());
+        if (CallSiteNode == NULL || DirtyCaller.find (CallSiteNode->GetFunction ()) != DirtyCaller.end())
+        {
+            continue;
+        }
+
+        if (!CheckCs.insert (CallSiteNode).second)
+        {
+            continue;
+        }
+
+        if (!Snapshot.VerifyInterDdg (CallSiteNode, CsToFresh[CallSiteNode]))
+        {
+            printf ("%s inter ddg of call site N%u in %s differs from the snapshot\r\n", ErrMsg("DdgIncremental:").c_str(), 
+                    CallSiteNode->GetId (), CallSiteNode->GetFunction ()->getName ().data());
+            DiffNum++;
+        }
+    }
+
+    printf ("DdgIncremental: verify %u/%u functions, %u call sites, %u differences\r\n", 
+            CheckNum, FuncNum, (DWORD)CheckCs.size (), DiffNum);
+
+    return;
+}
+
+VOID DgGraph::UpdatePtsByFs()
+{
+    FuncDg *Fdg;
+    Function *Func;
+    DWORD FuncId = 0;
+    DWORD FuncNum = m_CallGraph->GetNodeNum ();
+    CallGraphNode *CgNode;
+
+    for (auto GIt = m_CallGraph->begin (), End = m_CallGraph->end (); GIt != End; GIt++)
+    {
+        CgNode = GIt->second;
+        Func = CgNode->GetFunction ();
+        ++FuncId;
+        
+        if (!CgNode->IsReachable() || Func->getInstructionCount() == 0)
+        {
+            continue;
+        }  
+
+        if (m_UpdatePtsFunc.find (Func) != m_UpdatePtsFunc.end())
+        {
+            continue;
+        }
+        
+        printf("2-UpdatePts:[%-8d/%-8d] %-64s\r", FuncId, FuncNum, Func->getName ().data()); 
+
+        Fdg = GetFuncDg (Func);
+        assert (Fdg != NULL);
+    
+        InstAnalyzer *InstAnly = Fdg->GetInstAlz();
+        InstAnly->GetPDefUseInfo (NULL);
+
+    }  
+
+    printf("2-UpdatePts:[%-8d/%-8d] - call paths: %u function visits, %u replayed\r\n", 
+           FuncId, FuncNum, m_PtsVisitNum, m_PtsReplayNum);
+    m_UpdatePtsCtx.clear ();
+
+    return;
+}
+
+
+/* a function seen before under the same context only adds its defs to the value set */
+VOID DgGraph::UpdatePtsByFs(std::vector<Function*> &NodeStack, std::vector<ULONG> &CtxStack)
+{
+    for (DWORD Index = 0; Index < NodeStack.size(); Index++)
+    {
+        Function *CurFunc = NodeStack[Index];
+
+        FuncDg *Fdg = GetFuncDg (CurFunc);
+        assert (Fdg != NULL);
+
+        InstAnalyzer *InstAnly = Fdg->GetInstAlz();
+        
+        if (m_UpdatePtsCtx.insert (std::make_pair (CurFunc, CtxStack[Index])).second)
+        {
+            InstAnly->GetPDefUseInfo (&m_ValueSet);
+            m_PtsVisitNum++;
+        }
+        else
+        {
+            InstAnly->CollectDefs (&m_ValueSet);
+            m_PtsReplayNum++;
+        }
+
+        m_UpdatePtsFunc.insert(CurFunc);
+    }
+
+    m_ValueSet.clear();
+    
+    return;
+}
+
+
+VOID DgGraph::UpdateGlobalDd()
+{
+    FuncDg *Fdg;
+    Function *Func;
+    DWORD FuncId = 0;
+    DWORD FuncNum = m_CallGraph->GetNodeNum ();
+    CallGraphNode *CgNode;
+
+    Stat::StartTime ("GlobalDd");
+    SetOrigin (EO_GLOBAL);
+    for (auto GIt = m_CallGraph->begin (), End = m_CallGraph->end (); GIt != End; GIt++)
+    {
+        CgNode = GIt->second;
+        Func = CgNode->GetFunction ();
+        ++FuncId;
+        
+        if (!CgNode->IsReachable() || Func->getInstructionCount() == 0)
+        {
+            continue;
+        }  
+
+        if (!(FuncId%100))
+        {
+            printf("3-UpdateGlobalDd:[%-8d/%-8d] %-64s\r", FuncId, FuncNum, Func->getName ().data());
+        }
+
+        Fdg = GetFuncDg (Func);
+        assert (Fdg != NULL);
     
         Fdg->UpdateGlobalDd ();
     }  
 
     printf("3-UpdateGlobalDd:[%-8d/%-8d]\r\n", FuncId, FuncNum);   
+    Stat::EndTime ("GlobalDd");
+
+    if (m_IsGlobHub)
+    {
+        PrintHubStat ();
+    }
+
+    return;
+}
 
+/* the hub of a global, with the edges from all its defs on first use */
+DgNode* DgGraph::GetHubNode (Value *Global, std::set<Instruction*> *DefInstSet)
+{
+    auto It = m_GlobToHub.find (Global);
+    if (It != m_GlobToHub.end())
+    {
+        return It->second;
+    }
+
+    DgNode *HubNode = AddHubNode (Global);
+    for (auto Dit = DefInstSet->begin(), Dend = DefInstSet->end(); Dit != Dend; Dit++)
+    {
+        AddDdgEdge (GetDgNode (*Dit), HubNode, Global);
+    }
+
+    return HubNode;
+}
+
+/* a hub with D defs and U uses stands for D*U direct edges */
+VOID DgGraph::PrintHubStat ()
+{
+    ULONG HubEdge = 0;
+    ULONG DirectEdge = 0;
+    for (auto It = m_GlobToHub.begin(), End = m_GlobToHub.end(); It != End; It++)
+    {
+        DgNode *HubNode = It->second;
+        ULONG DefNum = HubNode->InEdgeNum<EA_DD> ();
+        ULONG UseNum = HubNode->OutEdgeNum<EA_DD> ();
+
+        HubEdge    += DefNum + UseNum;
+        DirectEdge += DefNum * UseNum;
+    }
+
+    printf ("GlobalHub: %u hubs, %lu edges for %lu def-use pairs, %ld edges saved\r\n", 
+            (DWORD)m_GlobToHub.size (), HubEdge, DirectEdge, (long)(DirectEdge - HubEdge));
     return;
 }
 
@@ -921,3 +1453,472 @@ VOID DgGraph::DumpCfgWeight()
 }
 
 
+
+
+/* lazy mode: no graph is built up front, a function is materialized when a traversal
+   first enters it or one of its neighbors. the cfg/ddg of a function is linked against
+   the functions materialized before it, so every edge is added once, by the later one */
+VOID DgGraph::InitLazy ()
+{
+    for (auto GIt = m_CallGraph->begin (), End = m_CallGraph->end (); GIt != End; GIt++)
+    {
+        CallGraphNode *CgNode = GIt->second;
+        if (!CgNode->IsReachable() || CgNode->GetFunction ()->getInstructionCount() == 0)
+        {
+            continue;
+        }
+
+        m_LazyTotal++;
+    }
+
+    printf ("LazyDdg: %u reachable functions, build on demand\r\n", m_LazyTotal);
+    return;
+}
+
+/* call site/callee pairs between Fdg and the functions materialized already */
+VOID DgGraph::GetLinkPair (FuncDg *Fdg, std::vector<std::pair<DgNode*, FuncDg*>> &LinkPair)
+{
+    Function *Func = Fdg->GetFunction ();
+    CallGraphNode *CgNode = m_CallGraph->GetCgNode (Func);
+
+    /* Func as the caller, recursive calls included */
+    T_CallciteSet *OutCs = CgNode->GetOutCallSite ();
+    for (auto It = OutCs->begin (), End = OutCs->end (); It != End; It++)
+    {
+        CallGraphEdgeSet *CgEdgeSet = m_CallGraph->GetCgEdgeSet (*It);
+        DgNode *CsNode = GetDgNode (*It);
+        if (CgEdgeSet == NULL || CsNode == NULL)
+        {
+            continue;
+        }
+
+        for (auto EgIt = CgEdgeSet->begin(), EgEnd = CgEdgeSet->end(); EgIt != EgEnd; EgIt++)
+        {
+            FuncDg *CalleeFdg = GetFuncDg ((*EgIt)->GetDstNode()->GetFunction ());
+            if (CalleeFdg == NULL)
+            {
+                continue;
+            }
+
+            LinkPair.push_back (std::make_pair (CsNode, CalleeFdg));
+        }
+    }
+
+    /* Func as the callee */
+    std::set<Instruction*> Visited;
+    T_CallciteSet *InCs = CgNode->GetInCallSite ();
+    for (auto It = InCs->begin (), End = InCs->end (); It != End; It++)
+    {
+        Instruction *Inst = *It;
+        Function *Caller = Inst->getParent ()->getParent ();
+        if (Caller == Func || GetFuncDg (Caller) == NULL)
+        {
+            continue;
+        }
+
+        if (!Visited.insert (Inst).second)
+        {
+            continue;
+        }
+
+        DgNode *CsNode = GetDgNode (Inst);
+        if (CsNode == NULL)
+        {
+            continue;
+        }
+
+        LinkPair.push_back (std::make_pair (CsNode, Fdg));
+    }
+
+    return;
+}
+
+/* same as BuildInterCfg for one call site and one callee */
+VOID DgGraph::LinkCallSite (DgNode *CsNode, FuncDg *CalleeFdg)
+{
+    DgEdge *dgEdge = NULL;
+    for (DgEdge *Edge : CsNode->OutEdges<EA_CFG> ())
+    {
+        if (!(Edge->GetAttr () & (EA_CALL|EA_RET)))
+        {
+            dgEdge = Edge;
+            break;
+        }
+    }
+
+    if (dgEdge == NULL)
+    {
+        return;
+    }
+
+    DgNode *dgDstNode = dgEdge->GetDstNode ();
+    AddCfgCallEdge (CsNode, CalleeFdg->GetHead ());
+    AddCfgRetEdge (CalleeFdg->GetTail (), dgDstNode);
+
+    if (dgDstNode->InEdgeNum<EA_CFG> () > 1)
+    {
+        dgEdge->SetAttr (EA_CFG|EA_CFG_DMY);  
+    }
+
+    return;
+}
+
+/* global def-use between Fdg and the functions materialized already, and Fdg itself */
+VOID DgGraph::LinkGlobalDd (FuncDg *Fdg)
+{
+    SetOrigin (EO_GLOBAL);
+
+    /* uses of Fdg: the static def map holds the stores of materialized functions only */
+    Fdg->UpdateGlobalDd ();
+
+    /* defs of Fdg to the uses of the earlier functions */
+    for (inst_iterator It = inst_begin(Fdg->GetFunction ()), End = inst_end(Fdg->GetFunction ()); It != End; ++It)
+    {
+        StoreInst *Store = dyn_cast<StoreInst> (&*It);
+        if (Store == NULL)
+        {
+            continue;
+        }
+
+        Value *Glob = Store->getOperand (1);
+        auto Git = m_GlobUseInst.find (Glob);
+        if (Git == m_GlobUseInst.end ())
+        {
+            continue;
+        }
+
+        DgNode *DefNode = GetDgNode (Store);
+        for (auto Uit = Git->second.begin (), Uend = Git->second.end (); Uit != Uend; Uit++)
+        {
+            AddDdgEdge (DefNode, GetDgNode (*Uit), Glob);
+        }
+    }
+
+    InstAnalyzer::T_Value2InstSet* Value2Inst = Fdg->GetInstAlz ()->GetGlobUse ();
+    for (auto Itu = Value2Inst->begin(), Endu = Value2Inst->end(); Itu != Endu; Itu++)
+    {
+        std::vector<Instruction*> &UseInst = m_GlobUseInst[Itu->first];
+        UseInst.insert (UseInst.end (), Itu->second.begin (), Itu->second.end ());
+    }
+
+    return;
+}
+
+FuncDg* DgGraph::Materialize (Function *Func)
+{
+    FuncDg *Fdg = GetFuncDg (Func);
+    if (Fdg != NULL)
+    {
+        return Fdg;
+    }
+
+    CallGraphNode *CgNode = m_CallGraph->LookupCgNode (Func);
+    if (CgNode == NULL || !CgNode->IsReachable() || Func->getInstructionCount() == 0)
+    {
+        return NULL;
+    }
+
+    /* 1. intra cfg, and the call/ret edges to the materialized neighbors */
+    Fdg = new FuncDg (this, Func, CgNode->GetInCallSite ());
+    assert (Fdg != NULL);
+    m_FuncToFdg[Func] = Fdg;
+
+    SetOrigin (EO_CFG);
+    Fdg->BuildCfg ();
+
+    std::vector<std::pair<DgNode*, FuncDg*>> LinkPair;
+    GetLinkPair (Fdg, LinkPair);
+    for (auto It = LinkPair.begin (), End = LinkPair.end (); It != End; It++)
+    {
+        LinkCallSite (It->first, It->second);
+    }
+
+    /* 2. intra ddg, the pts is filtered context-insensitively */
+    Fdg->GetInstAlz()->GetPDefUseInfo (NULL);
+    
+    SetOrigin (EO_INTRA);
+    Fdg->BuildDdg ();
+
+    /* 3. inter ddg */
+    SetOrigin (EO_INTER);
+    for (auto It = LinkPair.begin (), End = LinkPair.end (); It != End; It++)
+    {
+        FuncDg *CalleeFdg = It->second;
+        if (GetCalleeSum (CalleeFdg)->m_HasPDef)
+        {
+            RelateActPara (CalleeFdg, It->first);
+        }
+        RelateFpRet (CalleeFdg, It->first, CalleeFdg->GetFunction ());
+    }
+
+    /* 4. global dd */
+    LinkGlobalDd (Fdg);
+
+    m_LazyFuncNum++;
+    return Fdg;
+}
+
+/* the global under pointer casts and constant field addresses: bitcast (@g), gep (@g, 0, 1) */
+static inline Value* GetGlobalBase (Value *Ptr)
+{
+    while (1)
+    {
+        Ptr = Ptr->stripPointerCasts ();
+
+        ConstantExpr *CstExpr = dyn_cast<ConstantExpr> (Ptr);
+        if (CstExpr == NULL || CstExpr->getOpcode () != Instruction::GetElementPtr)
+        {
+            return Ptr;
+        }
+
+        Ptr = CstExpr->getOperand (0);
+    }
+}
+
+/* the functions that may add an edge to a node of Func: callees, callers, the other
+   callees of the callers (RelateFpRet forwards their defs to the formals of Func),
+   and the functions sharing a global with Func */
+VOID DgGraph::GetNeighbor (Function *Func, std::vector<Function*> &Neighbor)
+{
+    std::set<Function*> Visited;
+    std::set<Value*> VisitedGlob;
+    std::vector<Function*> Callers;
+
+    Visited.insert (Func);
+    Callers.push_back (Func);
+
+    T_CallciteSet *InCs = m_CallGraph->GetCgNode (Func)->GetInCallSite ();
+    for (auto It = InCs->begin (), End = InCs->end (); It != End; It++)
+    {
+        Function *Caller = (*It)->getParent ()->getParent ();
+        if (Visited.insert (Caller).second)
+        {
+            Neighbor.push_back (Caller);
+            Callers.push_back (Caller);
+        }
+    }
+
+    for (auto Cit = Callers.begin (), Cend = Callers.end (); Cit != Cend; Cit++)
+    {
+        CallGraphNode *CgNode = m_CallGraph->LookupCgNode (*Cit);
+        if (CgNode == NULL)
+        {
+            continue;
+        }
+
+        T_CallciteSet *OutCs = CgNode->GetOutCallSite ();
+        for (auto It = OutCs->begin (), End = OutCs->end (); It != End; It++)
+        {
+            CallGraphEdgeSet *CgEdgeSet = m_CallGraph->GetCgEdgeSet (*It);
+            if (CgEdgeSet == NULL)
+            {
+                continue;
+            }
+
+            for (auto EgIt = CgEdgeSet->begin(), EgEnd = CgEdgeSet->end(); EgIt != EgEnd; EgIt++)
+            {
+                Function *Callee = (*EgIt)->GetDstNode()->GetFunction ();
+                if (Visited.insert (Callee).second)
+                {
+                    Neighbor.push_back (Callee);
+                }
+            }
+        }
+    }
+
+    for (inst_iterator It = inst_begin(Func), End = inst_end(Func); It != End; ++It)
+    {
+        Value *Glob = NULL;
+        if (isa<LoadInst> (&*It))
+        {
+            Glob = It->getOperand (0);
+        }
+        else if (isa<StoreInst> (&*It))
+        {
+            Glob = It->getOperand (1);
+        }
+
+        Glob = (Glob != NULL) ? GetGlobalBase (Glob) : NULL;
+        if (Glob == NULL || !isa<GlobalValue> (Glob) || !VisitedGlob.insert (Glob).second)
+        {
+            continue;
+        }
+
+        /* the uses through casts and field addresses of the global are users of its constant expressions */
+        std::vector<User*> UserStack (Glob->user_begin (), Glob->user_end ());
+        std::set<User*> VisitedUser;
+        while (!UserStack.empty ())
+        {
+            User *U = UserStack.back ();
+            UserStack.pop_back ();
+            if (!VisitedUser.insert (U).second)
+            {
+                continue;
+            }
+
+            if (isa<ConstantExpr> (U))
+            {
+                UserStack.insert (UserStack.end (), U->user_begin (), U->user_end ());
+                continue;
+            }
+
+            Instruction *UseInst = dyn_cast<Instruction> (U);
+            if (UseInst == NULL)
+            {
+                continue;
+            }
+
+            Function *Partner = UseInst->getParent ()->getParent ();
+            if (Visited.insert (Partner).second)
+            {
+                Neighbor.push_back (Partner);
+            }
+        }
+    }
+
+    return;
+}
+
+/* after Expand the edge lists of the nodes in Func are final: a function materialized
+   later is not a neighbor of Func, so a traversal may iterate them safely */
+VOID DgGraph::Expand (Function *Func)
+{
+    if (!m_ExpandFunc.insert (Func).second)
+    {
+        return;
+    }
+
+    DWORD StartTime = CLOCK_IN_MS();
+    if (Materialize (Func) != NULL)
+    {
+        std::vector<Function*> Neighbor;
+        GetNeighbor (Func, Neighbor);
+
+        for (auto It = Neighbor.begin (), End = Neighbor.end (); It != End; It++)
+        {
+            Materialize (*It);
+        }
+    }
+    m_LazyTime += CLOCK_IN_MS() - StartTime;
+
+    return;
+}
+
+DgNode* DgGraph::RequireDgNode (Instruction *Inst)
+{
+    if (m_IsLazy)
+    {
+        DWORD StartTime = CLOCK_IN_MS();
+        Materialize (Inst->getParent ()->getParent ());
+        m_LazyTime += CLOCK_IN_MS() - StartTime;
+    }
+
+    auto It = m_InstToNode.find (Inst);
+    if (It == m_InstToNode.end ())
+    {
+        return NULL;
+    }
+
+    return It->second;
+}
+
+/* put the node of Inst into NodeSet, now or when its function is materialized */
+VOID DgGraph::WatchDgNode (Instruction *Inst, std::set<DgNode*> *NodeSet)
+{
+    auto It = m_InstToNode.find (Inst);
+    if (It != m_InstToNode.end () && It->second != NULL)
+    {
+        NodeSet->insert (It->second);
+        return;
+    }
+
+    if (m_IsLazy)
+    {
+        m_WatchInst[Inst] = NodeSet;
+    }
+
+    return;
+}
+
+VOID DgGraph::PrintLazyStat ()
+{
+    printf ("LazyDdg: materialized %u/%u functions, (V,E):(%u, %u), time %u (ms)\r\n", 
+            m_LazyFuncNum, m_LazyTotal, m_NodeNum, m_EdgeNum, m_LazyTime);
+    return;
+}
+
+/* the out edges of the expanded functions are final: they must be those of an eager
+   build, apart from the pts of a call path, which the lazy build does not see */
+VOID DgGraph::VerifyLazyDdg (ModuleManage &ModMng)
+{
+    typedef std::tuple<Instruction*, Instruction*, DWORD> T_LazyKey;
+
+    DgGraph RefDg (ModMng, AF_TRUE);
+
+    DWORD FuncNum = 0;
+    DWORD DiffFunc = 0;
+    DWORD LostNum = 0;
+    DWORD ExtraNum = 0;
+    DWORD EdgeNum = 0;
+    for (auto FIt = m_ExpandFunc.begin (), FEnd = m_ExpandFunc.end (); FIt != FEnd; FIt++)
+    {
+        Function *Func = *FIt;
+        if (GetFuncDg (Func) == NULL)
+        {
+            continue;
+        }
+        FuncNum++;
+
+        std::set<T_LazyKey> Lazy;
+        std::set<T_LazyKey> Eager;
+        for (inst_iterator It = inst_begin(Func), End = inst_end(Func); It != End; ++It)
+        {
+            DgNode *Node = GetDgNode (&*It);
+            DgNode *RefNode = RefDg.GetDgNode (&*It);
+            if (Node != NULL)
+            {
+                for (DgEdge *Edge : Node->OutEdges<EA_DD> ())
+                {
+                    Lazy.insert (std::make_tuple (&*It, Edge->GetDstNode ()->GetInst (), (DWORD)Edge->GetAttr ()));
+                }
+                for (DgEdge *Edge : Node->OutEdges<EA_CFG> ())
+                {
+                    Lazy.insert (std::make_tuple (&*It, Edge->GetDstNode ()->GetInst (), (DWORD)Edge->GetAttr ()));
+                }
+            }
+
+            if (RefNode != NULL)
+            {
+                for (DgEdge *Edge : RefNode->OutEdges<EA_DD> ())
+                {
+                    Eager.insert (std::make_tuple (&*It, Edge->GetDstNode ()->GetInst (), (DWORD)Edge->GetAttr ()));
+                }
+                for (DgEdge *Edge : RefNode->OutEdges<EA_CFG> ())
+                {
+                    Eager.insert (std::make_tuple (&*It, Edge->GetDstNode ()->GetInst (), (DWORD)Edge->GetAttr ()));
+                }
+            }
+        }
+
+        DWORD Lost = 0;
+        for (auto It = Eager.begin (), End = Eager.end (); It != End; It++)
+        {
+            Lost += (Lazy.find (*It) == Lazy.end ());
+        }
+        DWORD Extra = Lazy.size () + Lost - Eager.size ();
+
+        EdgeNum  += Eager.size ();
+        LostNum  += Lost;
+        ExtraNum += Extra;
+        if (Lost != 0 || Extra != 0)
+        {
+            printf ("%s %s: %u edges of the eager build missing, %u extra\r\n", 
+                    ErrMsg("LazyDdg:").c_str(), Func->getName ().data(), Lost, Extra);
+            DiffFunc++;
+        }
+    }
+
+    printf ("LazyDdg: verify %u expanded functions against %u eager edges, %u differ, %u edges missing, %u extra\r\n", 
+            FuncNum, EdgeNum, DiffFunc, LostNum, ExtraNum);
+    return;
+}
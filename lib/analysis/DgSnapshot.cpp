@@ -0,0 +1,1107 @@
+//===- DgSnapshot.cpp -- binary snapshot of the dependence graph ------------//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <tuple>
+#include <llvm/IR/InstIterator.h>
+#include "analysis/DgSnapshot.h"
+#include "common/Stat.h"
+
+using namespace llvm;
+using namespace std;
+
+static inline ULONG HashBytes (ULONG Hash, const VOID *Data, DWORD Size)
+{
+    const BYTE *Byte = (const BYTE *)Data;
+    for (DWORD Index = 0; Index < Size; Index++)
+    {
+        Hash ^= Byte[Index];
+        Hash *= 1099511628211UL;
+    }
+
+    return Hash;
+}
+
+static inline ULONG HashWord (ULONG Hash, ULONG Word)
+{
+    return HashBytes (Hash, &Word, sizeof(Word));
+}
+
+/* operands are hashed by what they are, never by address: locals by position, globals by name */
+static ULONG HashOperand (ULONG Hash, Value *Val, DenseMap<Value*, DWORD> &LocalId, DWORD Depth)
+{
+    Hash = HashWord (Hash, Val->getValueID ());
+
+    auto It = LocalId.find (Val);
+    if (It != LocalId.end())
+    {
+        return HashWord (Hash, It->second);
+    }
+
+    if (GlobalValue *Global = dyn_cast<GlobalValue>(Val))
+    {
+        StringRef Name = Global->getName ();
+        return HashBytes (Hash, Name.data(), Name.size());
+    }
+
+    if (ConstantInt *CInt = dyn_cast<ConstantInt>(Val))
+    {
+        return HashWord (Hash, CInt->getValue ().getLimitedValue ());
+    }
+
+    if (ConstantFP *CFp = dyn_cast<ConstantFP>(Val))
+    {
+        return HashWord (Hash, CFp->getValueAPF ().bitcastToAPInt ().getLimitedValue ());
+    }
+
+    if (ConstantDataSequential *CData = dyn_cast<ConstantDataSequential>(Val))
+    {
+        StringRef Raw = CData->getRawDataValues ();
+        return HashBytes (Hash, Raw.data(), Raw.size());
+    }
+
+    Constant *Const = dyn_cast<Constant>(Val);
+    if (Const != NULL && Depth < 4)
+    {
+        for (DWORD OpNo = 0; OpNo < Const->getNumOperands (); OpNo++)
+        {
+            Hash = HashOperand (Hash, Const->getOperand (OpNo), LocalId, Depth+1);
+        }
+    }
+
+    return Hash;
+}
+
+/* structural hash of a function body, stable across unrelated edits of the module */
+ULONG DgSnapshot::BodyHash (Function *Func)
+{
+    auto It = m_FuncToHash.find (Func);
+    if (It != m_FuncToHash.end())
+    {
+        return It->second;
+    }
+
+    DWORD Id = 0;
+    DenseMap<Value*, DWORD> LocalId;
+    for (Argument &Arg : Func->args ())
+    {
+        LocalId[&Arg] = Id++;
+    }
+
+    for (BasicBlock &Block : *Func)
+    {
+        LocalId[&Block] = Id++;
+        for (Instruction &Inst : Block)
+        {
+            LocalId[&Inst] = Id++;
+        }
+    }
+
+    ULONG Hash = 14695981039346656037UL;
+    Hash = HashWord (Hash, Func->arg_size ());
+    Hash = HashWord (Hash, Func->getReturnType ()->getTypeID ());
+
+    for (inst_iterator Iit = inst_begin(*Func), Iend = inst_end(*Func); Iit != Iend; ++Iit)
+    {
+        Instruction *Inst = &*Iit;
+
+        Hash = HashWord (Hash, Inst->getOpcode ());
+        Hash = HashWord (Hash, Inst->getType ()->getTypeID ());
+        if (CmpInst *Cmp = dyn_cast<CmpInst>(Inst))
+        {
+            Hash = HashWord (Hash, Cmp->getPredicate ());
+        }
+
+        for (DWORD OpNo = 0; OpNo < Inst->getNumOperands (); OpNo++)
+        {
+            Hash = HashOperand (Hash, Inst->getOperand (OpNo), LocalId, 0);
+        }
+    }
+
+    m_FuncToHash[Func] = Hash;
+    return Hash;
+}
+
+/* a pointee by what it is: a global by name, a local by its function and position */
+ULONG DgSnapshot::TargetHash (Value *Val)
+{
+    ULONG Hash = 14695981039346656037UL;
+    Hash = HashWord (Hash, Val->getValueID ());
+
+    Function *Func = NULL;
+    if (Instruction *Inst = dyn_cast<Instruction>(Val))
+    {
+        Func = Inst->getFunction ();
+    }
+    else if (Argument *Arg = dyn_cast<Argument>(Val))
+    {
+        Func = Arg->getParent ();
+    }
+    else if (GlobalValue *Global = dyn_cast<GlobalValue>(Val))
+    {
+        StringRef Name = Global->getName ();
+        return HashBytes (Hash, Name.data(), Name.size());
+    }
+    else
+    {
+        return Hash;
+    }
+
+    if (m_PosFuncs.insert (Func).second)
+    {
+        DWORD Pos = 0;
+        for (Argument &Arg : Func->args ())
+        {
+            m_LocalPos[&Arg] = Pos++;
+        }
+
+        for (inst_iterator Iit = inst_begin(*Func), Iend = inst_end(*Func); Iit != Iend; ++Iit)
+        {
+            m_LocalPos[&*Iit] = Pos++;
+        }
+    }
+
+    StringRef FName = Func->getName ();
+    Hash = HashBytes (Hash, FName.data(), FName.size());
+    return HashWord (Hash, m_LocalPos[Val]);
+}
+
+/* the ddg of a function reads the pts of its pointer operands: an unchanged body
+   whose pts changed through another function still needs a rebuild */
+ULONG DgSnapshot::PtsHash (Function *Func)
+{
+    auto It = m_FuncToPts.find (Func);
+    if (It != m_FuncToPts.end())
+    {
+        return It->second;
+    }
+
+    ULONG Hash = 14695981039346656037UL;
+
+    DWORD InstOrd = 0;
+    for (inst_iterator Iit = inst_begin(*Func), Iend = inst_end(*Func); Iit != Iend; ++Iit, InstOrd++)
+    {
+        Instruction *Inst = &*Iit;
+
+        std::vector<Value*> Pointers;
+        if (LoadInst *Load = dyn_cast<LoadInst>(Inst))
+        {
+            Pointers.push_back (Load->getPointerOperand ());
+        }
+        else if (StoreInst *Store = dyn_cast<StoreInst>(Inst))
+        {
+            Pointers.push_back (Store->getPointerOperand ());
+        }
+        else if (llvmAdpt::IsCallSite (Inst))
+        {
+            CallSite Cs = llvmAdpt::GetLLVMCallSite (Inst);
+            for (auto AIt = Cs.arg_begin (), AEnd = Cs.arg_end (); AIt != AEnd; AIt++)
+            {
+                Value *Arg = *AIt;
+                if (Arg->getType ()->isPointerTy ())
+                {
+                    Pointers.push_back (Arg);
+                }
+            }
+        }
+
+        for (DWORD OpNo = 0; OpNo < Pointers.size (); OpNo++)
+        {
+            std::vector<Value*> PtsTo;
+            llvmAdpt::GetPtsTo (Pointers[OpNo], PtsTo);
+
+            /* the order of a pts set is not stable, its sum is */
+            ULONG SetHash = 0;
+            for (auto PIt = PtsTo.begin (), PEnd = PtsTo.end (); PIt != PEnd; PIt++)
+            {
+                if (*PIt != NULL)
+                {
+                    SetHash += TargetHash (*PIt);
+                }
+            }
+
+            Hash = HashWord (Hash, InstOrd);
+            Hash = HashWord (Hash, OpNo);
+            Hash = HashWord (Hash, SetHash);
+        }
+    }
+
+    m_FuncToPts[Func] = Hash;
+    return Hash;
+}
+
+/* module names plus name and body hash of every function: a changed input invalidates the snapshot */
+ULONG DgSnapshot::FingerPrint ()
+{
+    ULONG Hash = 14695981039346656037UL;
+
+    /* hub and direct graphs differ in shape */
+    Hash = HashWord (Hash, m_Dg->IsGlobHub ());
+
+    for (DWORD Id = 0; Id < m_ModMng.GetModuleNum (); Id++)
+    {
+        Module *M = m_ModMng.GetModule (Id);
+
+        const std::string &MName = M->getModuleIdentifier ();
+        Hash = HashBytes (Hash, MName.data(), MName.size());
+
+        for (Function &Func : *M)
+        {
+            StringRef FName = Func.getName ();
+
+            Hash = HashBytes (Hash, FName.data(), FName.size());
+            Hash = HashWord (Hash, BodyHash (&Func));
+        }
+    }
+
+    return Hash;
+}
+
+DWORD DgSnapshot::AddString (StringRef Str)
+{
+    DWORD Off = m_StrTab.size ();
+
+    m_StrTab.append (Str.data(), Str.size());
+    m_StrTab.push_back ('\0');
+
+    return Off;
+}
+
+DWORD DgSnapshot::GetFuncIdx (Function *Func)
+{
+    auto It = m_FuncToIdx.find (Func);
+    if (It != m_FuncToIdx.end())
+    {
+        return It->second;
+    }
+
+    auto MIt = m_ModuleToId.find (Func->getParent ());
+    assert (MIt != m_ModuleToId.end());
+
+    SnapFunc Sf;
+    Sf.ModuleId = MIt->second;
+    Sf.NameOff  = AddString (Func->getName ());
+    Sf.InstNum  = 0;
+    Sf.Reserved = 0;
+    Sf.BodyHash = BodyHash (Func);
+    Sf.PtsHash  = PtsHash (Func);
+    for (inst_iterator Iit = inst_begin(*Func), Iend = inst_end(*Func); Iit != Iend; ++Iit)
+    {
+        m_InstToOrd[&*Iit] = Sf.InstNum++;
+    }
+
+    DWORD Idx = m_Funcs.size ();
+    m_Funcs.push_back (Sf);
+    m_FuncToIdx[Func] = Idx;
+
+    return Idx;
+}
+
+DWORD DgSnapshot::GetValueIdx (Value *Val)
+{
+    if (Val == NULL)
+    {
+        return 0;
+    }
+
+    auto It = m_ValueToIdx.find (Val);
+    if (It != m_ValueToIdx.end())
+    {
+        return It->second;
+    }
+
+    SnapValue Sv = {VK_NULL, 0, 0, 0};
+    if (Instruction *Inst = dyn_cast<Instruction>(Val))
+    {
+        Sv.Kind  = VK_INST;
+        Sv.Scope = GetFuncIdx (Inst->getParent ()->getParent ());
+        Sv.Index = m_InstToOrd[Inst];
+    }
+    else if (Argument *Arg = dyn_cast<Argument>(Val))
+    {
+        Sv.Kind  = VK_ARG;
+        Sv.Scope = GetFuncIdx (Arg->getParent ());
+        Sv.Index = Arg->getArgNo ();
+    }
+    else if (GlobalValue *Global = dyn_cast<GlobalValue>(Val))
+    {
+        auto MIt = m_ModuleToId.find (Global->getParent ());
+        assert (MIt != m_ModuleToId.end());
+
+        Sv.Kind  = VK_GLOBAL;
+        Sv.Scope = MIt->second;
+        Sv.Index = AddString (Global->getName ());
+    }
+    else
+    {
+        /* constant expressions: keyed by the operand that holds them, of an instruction,
+           or of a keyed constant or global when nested in another constant or an initializer */
+        for (User *U : Val->users ())
+        {
+            if (Instruction *UInst = dyn_cast<Instruction>(U))
+            {
+                if (m_ModuleToId.find (UInst->getModule ()) == m_ModuleToId.end())
+                {
+                    continue;
+                }
+
+                Sv.Kind  = VK_OPERAND;
+                Sv.Scope = GetFuncIdx (UInst->getFunction ());
+                Sv.Index = m_InstToOrd[UInst];
+            }
+            else if (isa<Constant>(U))
+            {
+                /* the user is keyed first, so it always has the lower index */
+                DWORD UserIdx = GetValueIdx (U);
+                if (UserIdx == 0)
+                {
+                    continue;
+                }
+
+                Sv.Kind  = VK_USEROP;
+                Sv.Scope = UserIdx;
+            }
+            else
+            {
+                continue;
+            }
+
+            while (U->getOperand (Sv.OpNo) != Val)
+            {
+                Sv.OpNo++;
+            }
+            break;
+        }
+
+        if (Sv.Kind == VK_NULL)
+        {
+            m_ValueToIdx[Val] = 0;
+            return 0;
+        }
+    }
+
+    DWORD Idx = m_Values.size ();
+    m_Values.push_back (Sv);
+    m_ValueToIdx[Val] = Idx;
+
+    return Idx;
+}
+
+
+VOID DgSnapshot::Store ()
+{
+    Stat::StartTime ("StoreDdgSnapshot");
+
+    DWORD NodeNum = m_Dg->GetNodeNum ();
+    std::vector<SnapNode> Nodes (NodeNum);
+    std::vector<DWORD> OutOffset (NodeNum+1);
+    std::vector<SnapEdge> Edges;
+    std::vector<SnapInter> Inters;
+    Edges.reserve (m_Dg->GetEdgeNum ());
+
+    AddString ("");
+    SnapValue NullVal = {VK_NULL, 0, 0, 0};
+    m_Values.push_back (NullVal);
+
+    for (DWORD Id = 1; Id <= NodeNum; Id++)
+    {
+        DgNode *Node = m_Dg->GetDgNode (Id);
+        assert (Node != NULL);
+
+        if (Node->IsHub ())
+        {
+            Nodes[Id-1].FuncIdx = SNAP_HUB_FUNC;
+            Nodes[Id-1].InstOrd = GetValueIdx (Node->GetGlobal ());
+        }
+        else
+        {
+            Instruction *Inst = Node->GetInst ();
+            Nodes[Id-1].FuncIdx = GetFuncIdx (Inst->getParent ()->getParent ());
+            Nodes[Id-1].InstOrd = m_InstToOrd[Inst];
+        }
+
+        OutOffset[Id-1] = Edges.size ();
+        for (auto It = Node->OutEdgeBegin (), End = Node->OutEdgeEnd (); It != End; It++)
+        {
+            DgEdge *Edge = *It;
+
+            SnapEdge Se;
+            Se.DstId  = Edge->GetDstID ();
+            Se.Attr   = Edge->GetAttr ();
+            Se.ValIdx = GetValueIdx (Edge->GetEdgeValue ());
+            Se.Origin = Edge->GetOrigin ();
+            Edges.push_back (Se);
+        }
+    }
+    OutOffset[NodeNum] = Edges.size ();
+
+    std::vector<T_InterEdge> &InterLog = m_Dg->GetInterLog ();
+    Inters.reserve (InterLog.size ());
+    for (auto It = InterLog.begin (), End = InterLog.end (); It != End; It++)
+    {
+        SnapInter Si;
+        Si.CsId   = It->m_CsNode->GetId ();
+        Si.SrcId  = It->m_Src->GetId ();
+        Si.DstId  = It->m_Dst->GetId ();
+        Si.Attr   = It->m_Attr;
+        Si.ValIdx = GetValueIdx (It->m_Value);
+        Inters.push_back (Si);
+    }
+
+    while (m_StrTab.size () % sizeof(DWORD))
+    {
+        m_StrTab.push_back ('\0');
+    }
+
+    SnapHeader Hdr;
+    memset (&Hdr, 0, sizeof(Hdr));
+    Hdr.Magic       = DG_SNAPSHOT_MAGIC;
+    Hdr.Version     = DG_SNAPSHOT_VERSION;
+    Hdr.FingerPrint = FingerPrint ();
+    Hdr.FuncNum     = m_Funcs.size ();
+    Hdr.NodeNum     = NodeNum;
+    Hdr.EdgeNum     = Edges.size ();
+    Hdr.InterNum    = Inters.size ();
+    Hdr.ValueNum    = m_Values.size ();
+    Hdr.StrSize     = m_StrTab.size ();
+    Hdr.DdgTime     = m_Dg->GetDdgTime ();
+
+    FILE *F = fopen (m_Path.c_str(), "wb");
+    if (F == NULL)
+    {
+        printf ("%s fail to open %s\r\n", WarnMsg("DdgSnapshot:").c_str(), m_Path.c_str());
+        return;
+    }
+
+    fwrite (&Hdr, sizeof(Hdr), 1, F);
+    fwrite (m_Funcs.data(), sizeof(SnapFunc), m_Funcs.size(), F);
+    fwrite (Nodes.data(), sizeof(SnapNode), Nodes.size(), F);
+    fwrite (OutOffset.data(), sizeof(DWORD), OutOffset.size(), F);
+    fwrite (Edges.data(), sizeof(SnapEdge), Edges.size(), F);
+    fwrite (Inters.data(), sizeof(SnapInter), Inters.size(), F);
+    fwrite (m_Values.data(), sizeof(SnapValue), m_Values.size(), F);
+    fwrite (m_StrTab.data(), 1, m_StrTab.size(), F);
+    fclose (F);
+
+    printf ("DdgSnapshot: store %s - (F,V,E):(%-8u, %-8u, %-8u)\r\n",
+            m_Path.c_str(), Hdr.FuncNum, Hdr.NodeNum, Hdr.EdgeNum);
+    Stat::EndTime ("StoreDdgSnapshot");
+
+    return;
+}
+
+
+BOOL DgSnapshot::Map ()
+{
+    int Fd = open (m_Path.c_str(), O_RDONLY);
+    if (Fd < 0)
+    {
+        return AF_FALSE;
+    }
+
+    struct stat St;
+    if (fstat (Fd, &St) != 0 || (size_t)St.st_size < sizeof(SnapHeader))
+    {
+        close (Fd);
+        return AF_FALSE;
+    }
+
+    VOID *Base = mmap (NULL, St.st_size, PROT_READ, MAP_PRIVATE, Fd, 0);
+    close (Fd);
+    if (Base == MAP_FAILED)
+    {
+        return AF_FALSE;
+    }
+
+    m_Base = Base;
+    m_Size = St.st_size;
+    m_Hdr  = (const SnapHeader *)Base;
+
+    return AF_TRUE;
+}
+
+VOID DgSnapshot::Unmap ()
+{
+    if (m_Base != NULL)
+    {
+        munmap (m_Base, m_Size);
+        m_Base = NULL;
+        m_Hdr  = NULL;
+    }
+
+    return;
+}
+
+/* sections and every index inside them, before any key is resolved */
+BOOL DgSnapshot::CheckLayout ()
+{
+    const SnapHeader *Hdr = m_Hdr;
+    size_t Expect = sizeof(SnapHeader) +
+                    (size_t)Hdr->FuncNum * sizeof(SnapFunc) +
+                    (size_t)Hdr->NodeNum * sizeof(SnapNode) +
+                    ((size_t)Hdr->NodeNum + 1) * sizeof(DWORD) +
+                    (size_t)Hdr->EdgeNum * sizeof(SnapEdge) +
+                    (size_t)Hdr->InterNum * sizeof(SnapInter) +
+                    (size_t)Hdr->ValueNum * sizeof(SnapValue) + Hdr->StrSize;
+    if (Hdr->Magic != DG_SNAPSHOT_MAGIC || Hdr->Version != DG_SNAPSHOT_VERSION || 
+        Expect != m_Size || Hdr->ValueNum == 0 || Hdr->StrSize == 0)
+    {
+        return AF_FALSE;
+    }
+
+    m_SFuncs  = (const SnapFunc *)(Hdr + 1);
+    m_SNodes  = (const SnapNode *)(m_SFuncs + Hdr->FuncNum);
+    m_SOutOff = (const DWORD *)(m_SNodes + Hdr->NodeNum);
+    m_SEdges  = (const SnapEdge *)(m_SOutOff + Hdr->NodeNum + 1);
+    m_SInters = (const SnapInter *)(m_SEdges + Hdr->EdgeNum);
+    m_SValues = (const SnapValue *)(m_SInters + Hdr->InterNum);
+    m_SStrTab = (const CHAR *)(m_SValues + Hdr->ValueNum);
+
+    if (m_SStrTab[Hdr->StrSize-1] != '\0' || m_SOutOff[0] != 0 || m_SOutOff[Hdr->NodeNum] != Hdr->EdgeNum)
+    {
+        return AF_FALSE;
+    }
+
+    for (DWORD Idx = 0; Idx < Hdr->FuncNum; Idx++)
+    {
+        if (m_SFuncs[Idx].NameOff >= Hdr->StrSize)
+        {
+            return AF_FALSE;
+        }
+    }
+
+    for (DWORD Idx = 0; Idx < Hdr->NodeNum; Idx++)
+    {
+        if (m_SNodes[Idx].FuncIdx == SNAP_HUB_FUNC)
+        {
+            if (m_SNodes[Idx].InstOrd == 0 || m_SNodes[Idx].InstOrd >= Hdr->ValueNum ||
+                m_SOutOff[Idx] > m_SOutOff[Idx+1])
+            {
+                return AF_FALSE;
+            }
+            continue;
+        }
+        
+        if (m_SNodes[Idx].FuncIdx >= Hdr->FuncNum || 
+            m_SNodes[Idx].InstOrd >= m_SFuncs[m_SNodes[Idx].FuncIdx].InstNum ||
+            m_SOutOff[Idx] > m_SOutOff[Idx+1])
+        {
+            return AF_FALSE;
+        }
+    }
+
+    for (DWORD Idx = 0; Idx < Hdr->EdgeNum; Idx++)
+    {
+        const SnapEdge *Se = m_SEdges + Idx;
+        if (Se->DstId < 1 || Se->DstId > Hdr->NodeNum || Se->ValIdx >= Hdr->ValueNum)
+        {
+            return AF_FALSE;
+        }
+    }
+
+    for (DWORD Idx = 0; Idx < Hdr->InterNum; Idx++)
+    {
+        const SnapInter *Si = m_SInters + Idx;
+        if (Si->CsId < 1 || Si->CsId > Hdr->NodeNum || Si->SrcId < 1 || Si->SrcId > Hdr->NodeNum ||
+            Si->DstId < 1 || Si->DstId > Hdr->NodeNum || Si->ValIdx >= Hdr->ValueNum)
+        {
+            return AF_FALSE;
+        }
+    }
+
+    for (DWORD Idx = 0; Idx < Hdr->ValueNum; Idx++)
+    {
+        if (m_SValues[Idx].Kind == VK_GLOBAL && m_SValues[Idx].Index >= Hdr->StrSize)
+        {
+            return AF_FALSE;
+        }
+
+        /* values resolve in index order, a user must come before its operand */
+        if (m_SValues[Idx].Kind == VK_USEROP && (m_SValues[Idx].Scope == 0 || m_SValues[Idx].Scope >= Idx))
+        {
+            return AF_FALSE;
+        }
+    }
+
+    return AF_TRUE;
+}
+
+
+/* a function resolves only when its body is unchanged, otherwise its keys mean nothing */
+Function* DgSnapshot::ResolveFunc (DWORD Idx)
+{
+    const SnapFunc *Sf = m_SFuncs + Idx;
+    if (Sf->ModuleId >= m_ModMng.GetModuleNum ())
+    {
+        return NULL;
+    }
+
+    Module *M = m_ModMng.GetModule (Sf->ModuleId);
+    Function *Func = M->getFunction (m_SStrTab + Sf->NameOff);
+    if (Func == NULL || Func->getInstructionCount () != Sf->InstNum || BodyHash (Func) != Sf->BodyHash)
+    {
+        return NULL;
+    }
+
+    std::vector<Instruction*> &OrdToInst = m_OrdToInst[Idx];
+    for (inst_iterator Iit = inst_begin(*Func), Iend = inst_end(*Func); Iit != Iend; ++Iit)
+    {
+        OrdToInst.push_back (&*Iit);
+    }
+
+    m_FuncToIdx[Func] = Idx;
+    return Func;
+}
+
+Value* DgSnapshot::ResolveValue (const SnapValue *Sv)
+{
+    switch (Sv->Kind)
+    {
+        case VK_INST:
+        {
+            if (Sv->Scope >= m_OrdToInst.size () || Sv->Index >= m_OrdToInst[Sv->Scope].size ())
+            {
+                return NULL;
+            }
+
+            return m_OrdToInst[Sv->Scope][Sv->Index];
+        }
+        case VK_ARG:
+        {
+            if (Sv->Scope >= m_IdxToFunc.size () || m_IdxToFunc[Sv->Scope] == NULL ||
+                Sv->Index >= m_IdxToFunc[Sv->Scope]->arg_size ())
+            {
+                return NULL;
+            }
+
+            return m_IdxToFunc[Sv->Scope]->arg_begin () + Sv->Index;
+        }
+        case VK_GLOBAL:
+        {
+            if (Sv->Scope >= m_ModMng.GetModuleNum ())
+            {
+                return NULL;
+            }
+
+            return m_ModMng.GetModule (Sv->Scope)->getNamedValue (m_SStrTab + Sv->Index);
+        }
+        case VK_OPERAND:
+        {
+            if (Sv->Scope >= m_OrdToInst.size () || Sv->Index >= m_OrdToInst[Sv->Scope].size ())
+            {
+                return NULL;
+            }
+
+            Instruction *Inst = m_OrdToInst[Sv->Scope][Sv->Index];
+            if (Sv->OpNo >= Inst->getNumOperands ())
+            {
+                return NULL;
+            }
+
+            return Inst->getOperand (Sv->OpNo);
+        }
+        case VK_USEROP:
+        {
+            User *U = dyn_cast_or_null<User> (m_IdxToValue[Sv->Scope]);
+            if (U == NULL || Sv->OpNo >= U->getNumOperands ())
+            {
+                return NULL;
+            }
+
+            return U->getOperand (Sv->OpNo);
+        }
+        default:
+        {
+            return NULL;
+        }
+    }
+}
+
+BOOL DgSnapshot::Load ()
+{
+    if (!Map ())
+    {
+        return AF_FALSE;
+    }
+
+    Stat::StartTime ("LoadDdgSnapshot");
+
+    /* 1. check the header against the current input */
+    if (!CheckLayout () || m_Hdr->FingerPrint != FingerPrint () || m_Dg->GetNodeNum () != 0)
+    {
+        printf ("%s %s does not match the input, rebuild.\r\n", WarnMsg("DdgSnapshot:").c_str(), m_Path.c_str());
+        Stat::EndTime ("LoadDdgSnapshot");
+        return AF_FALSE;
+    }
+
+    /* 2. resolve every key before touching the graph */
+    BOOL IsValid = AF_TRUE;
+    m_OrdToInst.resize (m_Hdr->FuncNum);
+    for (DWORD Idx = 0; Idx < m_Hdr->FuncNum && IsValid; Idx++)
+    {
+        Function *Func = ResolveFunc (Idx);
+        IsValid = (Func != NULL);
+
+        m_IdxToFunc.push_back (Func);
+    }
+
+    if (!IsValid)
+    {
+        printf ("%s %s is corrupted, rebuild.\r\n", WarnMsg("DdgSnapshot:").c_str(), m_Path.c_str());
+        Stat::EndTime ("LoadDdgSnapshot");
+        return AF_FALSE;
+    }
+
+    m_IdxToValue.resize (m_Hdr->ValueNum, (Value*)NULL);
+    for (DWORD Idx = 1; Idx < m_Hdr->ValueNum; Idx++)
+    {
+        m_IdxToValue[Idx] = ResolveValue (m_SValues + Idx);
+    }
+
+    /* 3. nodes keep their ids, then edges from the CSR arrays: every node and edge
+          is allocated again, the load saves the build, not a pass over the graph */
+    for (DWORD Idx = 0; Idx < m_Hdr->NodeNum; Idx++)
+    {
+        DgNode *Node;
+        if (m_SNodes[Idx].FuncIdx == SNAP_HUB_FUNC)
+        {
+            Value *Global = m_IdxToValue[m_SNodes[Idx].InstOrd];
+            assert (Global != NULL);
+            
+            Node = m_Dg->AddHubNode (Global);
+        }
+        else
+        {
+            Node = m_Dg->AddDgNode (m_OrdToInst[m_SNodes[Idx].FuncIdx][m_SNodes[Idx].InstOrd]);
+        }
+        assert (Node->GetId () == Idx+1);
+    }
+
+    for (DWORD Idx = 0; Idx < m_Hdr->NodeNum; Idx++)
+    {
+        DgNode *SrcNode = m_Dg->GetDgNode (Idx+1);
+
+        for (DWORD Eid = m_SOutOff[Idx]; Eid < m_SOutOff[Idx+1]; Eid++)
+        {
+            const SnapEdge *Se = m_SEdges + Eid;
+
+            DgEdge *Edge = new DgEdge (SrcNode, m_Dg->GetDgNode (Se->DstId), Se->Attr);
+            Edge->SetOrigin (Se->Origin);
+            if (!m_Dg->AddEdge (Edge, m_IdxToValue[Se->ValIdx]))
+            {
+                delete Edge;
+            }
+        }
+    }
+
+    /* 4. the inter-procedure log, so the graph can be stored again */
+    std::vector<T_InterEdge> &InterLog = m_Dg->GetInterLog ();
+    for (DWORD Idx = 0; Idx < m_Hdr->InterNum; Idx++)
+    {
+        const SnapInter *Si = m_SInters + Idx;
+        InterLog.push_back (T_InterEdge (m_Dg->GetDgNode (Si->CsId), m_Dg->GetDgNode (Si->SrcId), 
+                                         m_Dg->GetDgNode (Si->DstId), Si->Attr, m_IdxToValue[Si->ValIdx]));
+    }
+    m_Dg->SetDdgTime (m_Hdr->DdgTime);
+
+    printf ("DdgSnapshot: load %s - (F,V,E):(%-8u, %-8u, %-8u)\r\n",
+            m_Path.c_str(), m_Hdr->FuncNum, m_Hdr->NodeNum, m_Hdr->EdgeNum);
+
+    Stat::EndTime ("LoadDdgSnapshot");
+
+    return AF_TRUE;
+}
+
+
+/* snapshot node -> node of the graph under construction, for the unchanged functions */
+VOID DgSnapshot::ResolveNodes ()
+{
+    m_SnapToNode.assign (m_Hdr->NodeNum, (DgNode*)NULL);
+    m_FuncNodes.resize (m_Hdr->FuncNum);
+
+    for (DWORD Idx = 0; Idx < m_Hdr->NodeNum; Idx++)
+    {
+        const SnapNode *Sn = m_SNodes + Idx;
+
+        /* hubs only carry global edges, the global pass is always recomputed */
+        if (Sn->FuncIdx == SNAP_HUB_FUNC)
+        {
+            continue;
+        }
+
+        m_FuncNodes[Sn->FuncIdx].push_back (Idx);
+        if (m_IdxToFunc[Sn->FuncIdx] == NULL)
+        {
+            continue;
+        }
+
+        m_SnapToNode[Idx] = m_Dg->GetDgNode (m_OrdToInst[Sn->FuncIdx][Sn->InstOrd]);
+    }
+
+    for (DWORD Idx = 0; Idx < m_Hdr->InterNum; Idx++)
+    {
+        DgNode *CsNode = GetNode (m_SInters[Idx].CsId);
+        if (CsNode != NULL)
+        {
+            m_CsToInter[CsNode].push_back (Idx);
+        }
+    }
+
+    return;
+}
+
+BOOL DgSnapshot::Open ()
+{
+    if (!Map ())
+    {
+        return AF_FALSE;
+    }
+
+    if (!CheckLayout ())
+    {
+        printf ("%s %s can not be used for an incremental build.\r\n", WarnMsg("DdgSnapshot:").c_str(), m_Path.c_str());
+        Unmap ();
+        return AF_FALSE;
+    }
+
+    m_OrdToInst.resize (m_Hdr->FuncNum);
+    for (DWORD Idx = 0; Idx < m_Hdr->FuncNum; Idx++)
+    {
+        m_IdxToFunc.push_back (ResolveFunc (Idx));
+    }
+
+    m_IdxToValue.resize (m_Hdr->ValueNum, (Value*)NULL);
+    for (DWORD Idx = 1; Idx < m_Hdr->ValueNum; Idx++)
+    {
+        m_IdxToValue[Idx] = ResolveValue (m_SValues + Idx);
+    }
+
+    ResolveNodes ();
+
+    return AF_TRUE;
+}
+
+BOOL DgSnapshot::IsFuncSame (Function *Func)
+{
+    auto It = m_FuncToIdx.find (Func);
+    if (It == m_FuncToIdx.end())
+    {
+        return AF_FALSE;
+    }
+
+    if (PtsHash (Func) != m_SFuncs[It->second].PtsHash)
+    {
+        return AF_FALSE;
+    }
+
+    std::vector<DWORD> &Nodes = m_FuncNodes[It->second];
+    if (Nodes.size () == 0)
+    {
+        return AF_FALSE;
+    }
+
+    for (auto NIt = Nodes.begin (), End = Nodes.end (); NIt != End; NIt++)
+    {
+        if (m_SnapToNode[*NIt] == NULL)
+        {
+            return AF_FALSE;
+        }
+    }
+
+    return AF_TRUE;
+}
+
+/* same cfg edges out of every node, call and return edges included */
+BOOL DgSnapshot::IsCfgSame (Function *Func)
+{
+    if (!IsFuncSame (Func))
+    {
+        return AF_FALSE;
+    }
+
+    std::vector<DWORD> &Nodes = m_FuncNodes[m_FuncToIdx[Func]];
+    for (auto NIt = Nodes.begin (), End = Nodes.end (); NIt != End; NIt++)
+    {
+        DgNode *Node = m_SnapToNode[*NIt];
+
+        DWORD CfgNum = 0;
+        for (DWORD Eid = m_SOutOff[*NIt]; Eid < m_SOutOff[*NIt+1]; Eid++)
+        {
+            const SnapEdge *Se = m_SEdges + Eid;
+            if (!(Se->Attr & EA_CFG))
+            {
+                continue;
+            }
+            CfgNum++;
+
+            DgNode *DstNode = GetNode (Se->DstId);
+            if (DstNode == NULL)
+            {
+                return AF_FALSE;
+            }
+
+            BOOL IsFound = AF_FALSE;
+            for (DgEdge *Edge : Node->OutEdges<EA_CFG> ())
+            {
+                if (Edge->GetDstNode () == DstNode && Edge->GetAttr () == Se->Attr)
+                {
+                    IsFound = AF_TRUE;
+                    break;
+                }
+            }
+
+            if (!IsFound)
+            {
+                return AF_FALSE;
+            }
+        }
+
+        if (CfgNum != Node->OutEdgeNum<EA_CFG> ())
+        {
+            return AF_FALSE;
+        }
+    }
+
+    return AF_TRUE;
+}
+
+VOID DgSnapshot::ImportIntraDdg (Function *Func)
+{
+    auto It = m_FuncToIdx.find (Func);
+    assert (It != m_FuncToIdx.end());
+
+    std::vector<DWORD> &Nodes = m_FuncNodes[It->second];
+    for (auto NIt = Nodes.begin (), End = Nodes.end (); NIt != End; NIt++)
+    {
+        DgNode *SrcNode = m_SnapToNode[*NIt];
+
+        for (DWORD Eid = m_SOutOff[*NIt]; Eid < m_SOutOff[*NIt+1]; Eid++)
+        {
+            const SnapEdge *Se = m_SEdges + Eid;
+            if (Se->Origin != EO_INTRA)
+            {
+                continue;
+            }
+
+            DgNode *DstNode = GetNode (Se->DstId);
+            if (SrcNode == NULL || DstNode == NULL)
+            {
+                m_LostNum++;
+                continue;
+            }
+
+            m_Dg->AddDgEdge (SrcNode, DstNode, Se->Attr, m_IdxToValue[Se->ValIdx]);
+            m_ImportNum++;
+        }
+    }
+
+    return;
+}
+
+/* replay the logged attempts of a call site: once, even if the call site is visited per callee */
+VOID DgSnapshot::ImportInterDdg (DgNode *CsNode)
+{
+    if (!m_ImportedCs.insert (CsNode).second)
+    {
+        return;
+    }
+
+    auto It = m_CsToInter.find (CsNode);
+    if (It == m_CsToInter.end())
+    {
+        return;
+    }
+
+    std::vector<DWORD> &Inters = It->second;
+    for (auto IIt = Inters.begin (), End = Inters.end (); IIt != End; IIt++)
+    {
+        const SnapInter *Si = m_SInters + *IIt;
+
+        DgNode *SrcNode = GetNode (Si->SrcId);
+        DgNode *DstNode = GetNode (Si->DstId);
+        if (SrcNode == NULL || DstNode == NULL)
+        {
+            m_LostNum++;
+            continue;
+        }
+
+        m_Dg->AddDgEdge (SrcNode, DstNode, Si->Attr, m_IdxToValue[Si->ValIdx]);
+        m_ImportNum++;
+    }
+
+    return;
+}
+
+typedef std::tuple<DgNode*, DgNode*, DWORD, Value*> T_EdgeKey;
+
+BOOL DgSnapshot::VerifyIntraDdg (Function *Func)
+{
+    std::set<T_EdgeKey> Old;
+    std::set<T_EdgeKey> New;
+
+    std::vector<DWORD> &Nodes = m_FuncNodes[m_FuncToIdx[Func]];
+    for (auto NIt = Nodes.begin (), End = Nodes.end (); NIt != End; NIt++)
+    {
+        DgNode *Node = m_SnapToNode[*NIt];
+
+        for (DWORD Eid = m_SOutOff[*NIt]; Eid < m_SOutOff[*NIt+1]; Eid++)
+        {
+            const SnapEdge *Se = m_SEdges + Eid;
+            if (Se->Origin == EO_INTRA)
+            {
+                Old.insert (std::make_tuple (Node, GetNode (Se->DstId), Se->Attr, m_IdxToValue[Se->ValIdx]));
+            }
+        }
+
+        for (DgEdge *Edge : Node->OutEdges<EA_DD> ())
+        {
+            if (Edge->GetOrigin () == EO_INTRA)
+            {
+                New.insert (std::make_tuple (Node, Edge->GetDstNode (), (DWORD)Edge->GetAttr (), Edge->GetEdgeValue ()));
+            }
+        }
+    }
+
+    return (Old == New);
+}
+
+BOOL DgSnapshot::VerifyInterDdg (DgNode *CsNode, std::vector<T_InterEdge*> &Fresh)
+{
+    std::set<T_EdgeKey> Old;
+    std::set<T_EdgeKey> New;
+
+    auto It = m_CsToInter.find (CsNode);
+    if (It != m_CsToInter.end())
+    {
+        for (auto IIt = It->second.begin (), End = It->second.end (); IIt != End; IIt++)
+        {
+            const SnapInter *Si = m_SInters + *IIt;
+            Old.insert (std::make_tuple (GetNode (Si->SrcId), GetNode (Si->DstId), Si->Attr, m_IdxToValue[Si->ValIdx]));
+        }
+    }
+
+    for (auto FIt = Fresh.begin (), End = Fresh.end (); FIt != End; FIt++)
+    {
+        T_InterEdge *Ie = *FIt;
+        New.insert (std::make_tuple (Ie->m_Src, Ie->m_Dst, Ie->m_Attr, Ie->m_Value));
+    }
+
+    return (Old == New);
+}
@@ -0,0 +1,391 @@
+//===- FreeSum.cpp -- bottom-up free summaries of the formal parameters -----//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+#include "analysis/FreeSum.h"
+#include "callgraph/CgScheduler.h"
+#include "common/VisitMark.h"
+#include "common/Stat.h"
+
+using namespace llvm;
+
+static inline bool IsExitCall (Instruction *Inst)
+{
+    if (!llvmAdpt::IsCallSite (Inst))
+    {
+        return false;
+    }
+
+    Function *Func = llvmAdpt::GetCallee (Inst);
+    return (Func != NULL && strcmp (Func->getName ().data(), "exit") == 0);
+}
+
+/* the entries are created before the run, a task only fills its own entry */
+VOID FreeSum::Build (DWORD ThreadNum)
+{
+    DWORD StartTime = Stat::GetWallTime ();
+
+    for (auto It = m_Dg->begin (), End = m_Dg->end (); It != End; It++)
+    {
+        DgNode *Node = It->second;
+        if (Node->IsHub ())
+        {
+            continue;
+        }
+
+        m_FuncNodes[Node->GetFunction ()].push_back (Node);
+    }
+
+    for (auto It = m_FuncNodes.begin (), End = m_FuncNodes.end (); It != End; It++)
+    {
+        m_FuncSum[It->first];
+    }
+
+    CgScheduler Sch (m_Dg->GetCallGraph ());
+    Sch.Run ("FreeSum", SumTask, this, ThreadNum);
+
+    m_BuildTime = Stat::GetWallTime () - StartTime;
+    return;
+}
+
+VOID FreeSum::SumTask (VOID *Ctx, Function *Func)
+{
+    FreeSum *Fs = (FreeSum *)Ctx;
+    
+    Fs->Summarize (Func);
+    return;
+}
+
+VOID FreeSum::GetCallees (DgNode *CsNode, std::vector<Function*> &Callees)
+{
+    for (DgEdge *Edge : CsNode->OutEdges<EA_CFG> ())
+    {
+        if (Edge->GetAttr () & EA_CALL)
+        {
+            Callees.push_back (Edge->GetDstNode ()->GetFunction ());
+        }
+    }
+
+    return;
+}
+
+VOID FreeSum::Summarize (Function *Func)
+{
+    auto It = m_FuncSum.find (Func);
+    if (It == m_FuncSum.end ())
+    {
+        return;
+    }
+    T_FuncSum &Sum = It->second;
+
+    Sum.m_Formal.resize (Func->arg_size ());
+    for (Function::arg_iterator Fit = Func->arg_begin(); Fit != Func->arg_end(); ++Fit) 
+    {
+        Argument *Formal = &*Fit;
+        SummarizeFormal (Func, Formal, Sum.m_Formal[Formal->getArgNo ()]);
+    }
+
+    /* closed: the slicer gains nothing by entering the function */
+    Sum.m_IsClosed = true;
+    std::vector<DgNode*> &Nodes = m_FuncNodes[Func];
+    for (auto Nit = Nodes.begin (), End = Nodes.end (); Nit != End && Sum.m_IsClosed; Nit++)
+    {
+        DgNode *Node = *Nit;
+        if (m_Sinks->find (Node) != m_Sinks->end () || IsExitCall (Node->GetInst ()) ||
+            Node->GetOutgoingEdgeNum () == 0)
+        {
+            Sum.m_IsClosed = false;
+            break;
+        }
+
+        std::vector<Function*> Callees;
+        GetCallees (Node, Callees);
+        for (auto Cit = Callees.begin (), Cend = Callees.end (); Cit != Cend; Cit++)
+        {
+            if (!IsClosed (*Cit))
+            {
+                Sum.m_IsClosed = false;
+                break;
+            }
+        }
+    }
+
+    Sum.m_IsDone = true;
+    return;
+}
+
+/* Val is a copy of the formal used by Node as a call argument: a sink, or a call
+   whose callees all free the formal Val is passed to */
+bool FreeSum::IsFreePoint (DgNode *Node, Value *Val)
+{
+    if (m_Sinks->find (Node) != m_Sinks->end ())
+    {
+        return true;
+    }
+
+    return IsFreedByCall (Node, Val);
+}
+
+bool FreeSum::IsFreedByCall (DgNode *CsNode, Value *Actual)
+{
+    if (!llvmAdpt::IsCallSite (CsNode->GetInst ()))
+    {
+        return false;
+    }
+    ImmutableCallSite Cs (CsNode->GetInst ());
+
+    std::vector<Function*> Callees;
+    GetCallees (CsNode, Callees);
+    if (Callees.size () == 0)
+    {
+        return false;
+    }
+
+    for (auto It = Callees.begin (), End = Callees.end (); It != End; It++)
+    {
+        T_FuncSum *Sum = GetSum (*It);
+        if (Sum == NULL)
+        {
+            return false;
+        }
+
+        bool IsFreed = false;
+        DWORD ArgNo = 0;
+        for (auto Ait = Cs.arg_begin (); Ait != Cs.arg_end () && ArgNo < Sum->m_Formal.size (); ++Ait, ++ArgNo)
+        {
+            if (*Ait == Actual && Sum->m_Formal[ArgNo].m_Free == FS_ALL)
+            {
+                IsFreed = true;
+                break;
+            }
+        }
+
+        if (!IsFreed)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+   the copies of the formal: a use of a copy is a store to a slot, a cast, a call or
+   a return, and a load of a slot holding a copy is a copy again. the other uses
+   (field addresses, compares) do not pass the pointer on.
+*/
+VOID FreeSum::SummarizeFormal (Function *Func, Argument *Formal, T_FormalSum &FSum)
+{
+    std::vector<DgNode*> &Nodes = m_FuncNodes[Func];
+    VisitMark Visited (m_Dg->GetNodeNum () + 1);
+    std::vector<std::pair<DgNode*, Value*>> Uses;
+    DgNodeSet FreePoints;
+
+    for (auto It = Nodes.begin (), End = Nodes.end (); It != End; It++)
+    {
+        Instruction *Inst = (*It)->GetInst ();
+        for (DWORD OpNo = 0; OpNo < Inst->getNumOperands (); OpNo++)
+        {
+            if (Inst->getOperand (OpNo) == Formal)
+            {
+                Uses.push_back (std::make_pair (*It, (Value *)Formal));
+                break;
+            }
+        }
+    }
+
+    while (!Uses.empty ())
+    {
+        DgNode *Node = Uses.back ().first;
+        Value *Val   = Uses.back ().second;
+        Uses.pop_back ();
+
+        Instruction *Inst = Node->GetInst ();
+        if (StoreInst *Store = dyn_cast<StoreInst> (Inst))
+        {
+            if (Store->getValueOperand () != Val || !Visited.Mark (Node->GetId ()))
+            {
+                continue;
+            }
+
+            /* memory out of the frame may be written by anyone */
+            Value *Slot = Store->getPointerOperand ();
+            if (!isa<AllocaInst> (Slot->stripPointerCasts ()))
+            {
+                continue;
+            }
+
+            for (DgEdge *Edge : Node->OutEdges<EA_DD> ())
+            {
+                DgNode *DstNode = Edge->GetDstNode ();
+                LoadInst *Load = DstNode->IsHub () ? NULL : dyn_cast<LoadInst> (DstNode->GetInst ());
+                if (Load != NULL && Load->getPointerOperand () == Slot && DstNode->GetFunction () == Func &&
+                    IsOnlyStore (DstNode, Node) && Visited.Mark (DstNode->GetId ()))
+                {
+                    Uses.push_back (std::make_pair (DstNode, (Value *)NULL));
+                }
+            }
+            continue;
+        }
+        
+        if (llvmAdpt::IsCallSite (Inst))
+        {
+            if (IsFreePoint (Node, Val))
+            {
+                FreePoints.insert (Node);
+            }
+            continue;
+        }
+
+        /* a returned copy is the caller's to free */
+        if (isa<ReturnInst> (Inst))
+        {
+            continue;
+        }
+
+        /* a loaded copy enters with a NULL value, a cast is a copy of its operand */
+        if (Val != NULL && !isa<CastInst> (Inst) && !isa<PHINode> (Inst) && !isa<SelectInst> (Inst))
+        {
+            continue;
+        }
+
+        if (Val != NULL && !Visited.Mark (Node->GetId ()))
+        {
+            continue;
+        }
+
+        for (DgEdge *Edge : Node->OutEdges<EA_DD> ())
+        {
+            DgNode *DstNode = Edge->GetDstNode ();
+            if (DstNode->IsHub () || DstNode->GetFunction () != Func)
+            {
+                continue;
+            }
+
+            Instruction *DstInst = DstNode->GetInst ();
+            for (DWORD OpNo = 0; OpNo < DstInst->getNumOperands (); OpNo++)
+            {
+                if (DstInst->getOperand (OpNo) == Inst)
+                {
+                    Uses.push_back (std::make_pair (DstNode, (Value *)Inst));
+                    break;
+                }
+            }
+        }
+    }
+
+    if (FreePoints.size () != 0 && IsFreeOnAllPaths (Func, FreePoints))
+    {
+        FSum.m_Free = FS_ALL;
+    }
+
+    return;
+}
+
+/* the load sees the stored copy only: no other store, call or hub defines what it reads */
+bool FreeSum::IsOnlyStore (DgNode *LoadNode, DgNode *StoreNode)
+{
+    Value *Ptr = cast<LoadInst> (LoadNode->GetInst ())->getPointerOperand ();
+    for (DgEdge *Edge : LoadNode->InEdges<EA_DD> ())
+    {
+        DgNode *SrcNode = Edge->GetSrcNode ();
+        if (SrcNode == StoreNode)
+        {
+            continue;
+        }
+
+        if (!SrcNode->IsHub () && SrcNode->GetInst () == Ptr)
+        {
+            continue;
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+/* no cfg path from the entry gets to the return or a dead end around the free points */
+bool FreeSum::IsFreeOnAllPaths (Function *Func, DgNodeSet &FreePoints)
+{
+    std::vector<DgNode*> &Nodes = m_FuncNodes[Func];
+    FuncDg *Fdg = m_Dg->GetFuncDg (Nodes.front ());
+    if (Fdg == NULL || Fdg->GetHead () == NULL)
+    {
+        return false;
+    }
+
+    DgNode *Tail = Fdg->GetTail ();
+    VisitMark Visited (m_Dg->GetNodeNum () + 1);
+    std::vector<DgNode*> Stack;
+
+    Visited.Mark (Fdg->GetHead ()->GetId ());
+    Stack.push_back (Fdg->GetHead ());
+    while (!Stack.empty ())
+    {
+        DgNode *Node = Stack.back ();
+        Stack.pop_back ();
+
+        if (FreePoints.find (Node) != FreePoints.end () || IsExitCall (Node->GetInst ()))
+        {
+            continue;
+        }
+
+        if (Node == Tail || Node->GetOutgoingEdgeNum () == 0)
+        {
+            return false;
+        }
+
+        for (DgEdge *Edge : Node->OutEdges<EA_CFG> ())
+        {
+            if (Edge->GetAttr () & (EA_CALL|EA_RET))
+            {
+                continue;
+            }
+
+            DgNode *DstNode = Edge->GetDstNode ();
+            if (Visited.Mark (DstNode->GetId ()))
+            {
+                Stack.push_back (DstNode);
+            }
+        }
+    }
+
+    return true;
+}
+
+VOID FreeSum::PrintStat ()
+{
+    DWORD FreeNum[2] = {0, 0};
+    DWORD ClosedNum = 0;
+    
+    for (auto It = m_FuncSum.begin (), End = m_FuncSum.end (); It != End; It++)
+    {
+        T_FuncSum &Sum = It->second;
+        ClosedNum += Sum.m_IsClosed;
+        
+        for (auto Fit = Sum.m_Formal.begin (), Fend = Sum.m_Formal.end (); Fit != Fend; Fit++)
+        {
+            FreeNum[Fit->m_Free]++;
+        }
+    }
+
+    printf ("FreeSum: %u functions (%u closed), formals freed on all paths %u/%u, %u (ms)\r\n",
+            (DWORD)m_FuncSum.size (), ClosedNum, FreeNum[FS_ALL], FreeNum[FS_ALL] + FreeNum[FS_NEVER], m_BuildTime);
+    return;
+}
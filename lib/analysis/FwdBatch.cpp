@@ -0,0 +1,168 @@
+//===- FwdBatch.cpp -- bit-parallel forward reachability of many sources ----//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+#include "analysis/FwdBatch.h"
+#include "common/VisitMark.h"
+#include "common/Stat.h"
+#include <deque>
+
+using namespace llvm;
+
+VOID FwdBatch::Run (DgNodeSet &Sources)
+{
+    DWORD StartTime = Stat::GetWallTime ();
+    DWORD NodeNum = m_Dg->GetNodeNum ();
+
+    m_Nodes.assign (NodeNum + 1, NULL);
+    for (auto It = m_Dg->begin (), End = m_Dg->end (); It != End; It++)
+    {
+        assert (It->first <= NodeNum);
+        m_Nodes[It->first] = It->second;
+    }
+
+    m_IsSink.assign (NodeNum + 1, false);
+    for (auto It = m_Sinks->begin (), End = m_Sinks->end (); It != End; It++)
+    {
+        m_IsSink[(*It)->GetId ()] = true;
+    }
+
+    m_Mask.assign ((NodeNum + 1) * FB_WORDS, 0);
+    m_SinkMask.assign ((NodeNum + 1) * FB_WORDS, 0);
+
+    std::vector<DgNode*> SrcVec (Sources.begin (), Sources.end ());
+    m_ReachSinks.assign (SrcVec.size (), DgNodeSet ());
+    for (DWORD No = 0; No < SrcVec.size (); No++)
+    {
+        m_SrcNo[SrcVec[No]] = No;
+    }
+
+    for (DWORD Start = 0; Start < SrcVec.size (); Start += FB_WIDTH)
+    {
+        Sweep (SrcVec, Start, std::min ((DWORD)FB_WIDTH, (DWORD)SrcVec.size () - Start));
+        m_SweepNum++;
+    }
+
+    /* the masks are only needed by the sweeps */
+    std::vector<ULONG> ().swap (m_Mask);
+    std::vector<ULONG> ().swap (m_SinkMask);
+
+    m_Time = Stat::GetWallTime () - StartTime;
+    return;
+}
+
+/* propagate the source bits until no mask changes, the masks are zero again on return */
+VOID FwdBatch::Sweep (std::vector<DgNode*> &Sources, DWORD Start, DWORD Num)
+{
+    std::vector<DWORD> Touched;
+    std::vector<DWORD> SinkIds;
+    std::deque<DWORD> Queue;
+    VisitMark InQueue (m_Nodes.size ());
+
+    for (DWORD No = 0; No < Num; No++)
+    {
+        DWORD Id = Sources[Start + No]->GetId ();
+        ULONG *Mask = &m_Mask[Id * FB_WORDS];
+        if (IsZero (Mask))
+        {
+            Touched.push_back (Id);
+        }
+        Mask[No >> 6] |= (1UL << (No & 63));
+
+        if (InQueue.Mark (Id))
+        {
+            Queue.push_back (Id);
+        }
+    }
+
+    while (!Queue.empty ())
+    {
+        DWORD Id = Queue.front ();
+        Queue.pop_front ();
+        InQueue.Unmark (Id);
+
+        const ULONG *Mask = &m_Mask[Id * FB_WORDS];
+        for (DgEdge *Edge : m_Nodes[Id]->OutEdges<EA_DD> ())
+        {
+            DWORD DstId = Edge->GetDstNode ()->GetId ();
+            m_EdgeNum++;
+
+            /* a sink ends the path */
+            bool IsSink = m_IsSink[DstId];
+            ULONG *DstMask = IsSink ? &m_SinkMask[DstId * FB_WORDS] : &m_Mask[DstId * FB_WORDS];
+            bool IsNew = IsZero (DstMask);
+            if (!Merge (DstMask, Mask))
+            {
+                continue;
+            }
+
+            if (IsSink)
+            {
+                if (IsNew)
+                {
+                    SinkIds.push_back (DstId);
+                }
+                continue;
+            }
+
+            if (IsNew)
+            {
+                Touched.push_back (DstId);
+            }
+            
+            if (InQueue.Mark (DstId))
+            {
+                Queue.push_back (DstId);
+            }
+        }
+    }
+
+    for (auto It = SinkIds.begin (), End = SinkIds.end (); It != End; It++)
+    {
+        ULONG *Mask = &m_SinkMask[*It * FB_WORDS];
+        for (DWORD No = 0; No < Num; No++)
+        {
+            if (Mask[No >> 6] & (1UL << (No & 63)))
+            {
+                m_ReachSinks[Start + No].insert (m_Nodes[*It]);
+            }
+        }
+        
+        std::fill (Mask, Mask + FB_WORDS, 0);
+    }
+
+    for (auto It = Touched.begin (), End = Touched.end (); It != End; It++)
+    {
+        std::fill (&m_Mask[*It * FB_WORDS], &m_Mask[*It * FB_WORDS] + FB_WORDS, 0);
+    }
+
+    return;
+}
+
+VOID FwdBatch::PrintStat ()
+{
+    DWORD NoSinkNum = 0;
+    for (auto It = m_ReachSinks.begin (), End = m_ReachSinks.end (); It != End; It++)
+    {
+        NoSinkNum += It->empty ();
+    }
+
+    printf ("FwdBatch: %u sources in %u sweeps of %u, %lu edges visited, %u sources reach no sink, %u (ms)\r\n",
+            (DWORD)m_ReachSinks.size (), m_SweepNum, FB_WIDTH, m_EdgeNum, NoSinkNum, m_Time);
+    return;
+}
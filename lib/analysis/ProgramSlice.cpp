@@ -23,6 +23,11 @@ using namespace llvm;
 
 bool ProgramSlice::IsForward (DgNode *Node)
 {
+    if (Node->IsHub ())
+    {
+        return true;
+    }
+    
     DWORD NodeId = Node->GetId ();
     llvm::Function *Func = Node->GetFunction ();
     
@@ -39,21 +44,31 @@ bool ProgramSlice::IsForward (DgNode *Node)
 }
 
 
-VOID ProgramSlice::ForwardDfs (DgNode *Node, DgNodeSet *Visited, DgNodeSet &Sinks)
+/* depth-first over the dd out edges, on an explicit stack */
+VOID ProgramSlice::ForwardDfs (DgNode *Node, VisitMark *Visited, DgNodeSet &Sinks)
 {
-    Visited->insert(Node);
+    std::vector<T_SliceFrame> Stack;
 
+    Visited->Mark (Node->GetId ());
+    m_Dg->ExpandNode (Node);
     DEBUG ("%d ", Node->GetId ());
-    for (auto Egit = Node->OutEdgeBegin (), End = Node->OutEdgeEnd (); Egit != End; Egit++)
+    Stack.push_back (T_SliceFrame (Node));
+    
+    while (!Stack.empty () && m_OverBudget == BG_NONE)
     {
-        DgEdge *Edge = *Egit;
-        if (!(Edge->GetAttr () & EA_DD))
+        m_MaxDepth = (Stack.size () > m_MaxDepth) ? Stack.size () : m_MaxDepth;
+        
+        T_SliceFrame &Top = Stack.back ();
+        DgNode::kind_range Edges = Top.m_Node->OutEdges<EA_DD> ();
+        if (Top.m_Next >= (DWORD)(Edges.end () - Edges.begin ()))
         {
+            Stack.pop_back ();
             continue;
         }
 
+        DgEdge *Edge = Edges.begin ()[Top.m_Next++];
         DgNode *DstNode = Edge->GetDstNode ();
-        if (Visited->find(DstNode) != Visited->end())
+        if (Visited->IsMarked (DstNode->GetId ()))
         {
             continue;
         }
@@ -64,28 +79,37 @@ VOID ProgramSlice::ForwardDfs (DgNode *Node, DgNodeSet *Visited, DgNodeSet &Sink
             continue;
         }
 
-        m_ForwardSlice.insert (DstNode);     
-        m_FdFuncSet.insert (DstNode->GetFunction ());
+        m_ForwardSlice.Mark (DstNode->GetId ());     
+        if (!DstNode->IsHub ())
+        {
+            m_FdFuncSet.insert (DstNode->GetFunction ());
+        }
         
         if(Sinks.find (DstNode) != Sinks.end()) 
         {
             m_Sinks.insert (DstNode);
             m_ReachType = REACH_PARITAL;
             DEBUG ("<%d> ", DstNode->GetId ());
-            break;
+            
+            /* the rest edges of the node are skipped */
+            Stack.pop_back ();
+            continue;
         }
-                
-        ForwardDfs (DstNode, Visited, Sinks);
+
+        Visited->Mark (DstNode->GetId ());
+        m_Dg->ExpandNode (DstNode);
+        DEBUG ("%d ", DstNode->GetId ());
+        Stack.push_back (T_SliceFrame (DstNode));
+        Charge ();
     }
-    
 
-    //Visited->erase(Node);
+    return;
 }
 
 /* forward slicing based on ddg */
 VOID ProgramSlice::ForwardBfs(DgNodeSet &Sinks) 
 {
-    DgNodeSet Visited;
+    VisitMark Visited (m_Dg->GetNodeNum () + 1);
     DgNode *CurNode;
 
     DEBUG("ForwardTraverse: %d ---> ", m_Root->GetId ());
@@ -96,17 +120,13 @@ VOID ProgramSlice::ForwardBfs(DgNodeSet &Sinks)
         CurNode = m_Queue.OutQueue ();
         DEBUG("%d ", CurNode->GetId ());
 
-        if (Visited.find (CurNode) != Visited.end())
+        if (!Visited.Mark (CurNode->GetId ()))
         {
             continue;
         }
-        else
-        {
-            Visited.insert (CurNode);
-        }
 
         /* forward */
-        m_ForwardSlice.insert (CurNode);
+        m_ForwardSlice.Mark (CurNode->GetId ());
         if(Sinks.find (CurNode) != Sinks.end()) 
         {
             m_Sinks.insert (CurNode);
@@ -115,15 +135,8 @@ VOID ProgramSlice::ForwardBfs(DgNodeSet &Sinks)
         }
 
         /* iterate all children node */
-        for (auto it = CurNode->OutEdgeBegin (), end = CurNode->OutEdgeEnd ();
-            it != end; it++)
+        for (DgEdge *Edge : CurNode->OutEdges<EA_DD> ())
         {
-            DgEdge *Edge = *it;
-            if (!(Edge->GetAttr () & EA_DD))
-            {
-                continue;
-            }
-            
             m_Queue.InQueue (Edge->GetDstNode ());
         }
       
@@ -137,7 +150,7 @@ VOID ProgramSlice::ForwardBfs(DgNodeSet &Sinks)
 /* forward slicing based on ddg */
 VOID ProgramSlice::ForwardTraverse(DgNodeSet &Sinks) 
 {
-    DgNodeSet Visited;
+    VisitMark Visited (m_Dg->GetNodeNum () + 1);
 
     DEBUG ("ForwardTraverse: %d ---> ", m_Root->GetId ());
     
@@ -149,67 +162,92 @@ VOID ProgramSlice::ForwardTraverse(DgNodeSet &Sinks)
 }
 
 
-VOID ProgramSlice::BackwardDfs (DgNode *Node, DgNodeSet *Path)
+/* the path reaches the root or the known backward slice: the path only grows
+   and the slice is never shrunk, so only the nodes added since the last update
+   are new to the slice */
+VOID ProgramSlice::UpdateBackwardSlice (DgNode *SrcNode)
 {
-    Path->insert(Node);
-    
-    for (auto Egit = Node->InEdgeBegin (), End = Node->InEdgeEnd (); Egit != End; Egit++)
+    /* update function */
+    for (auto It = m_PathFuncSet.begin (), End = m_PathFuncSet.end(); It != End; It++)
+    {
+        m_BdFuncSet.insert (*It);
+    }
+
+    /* update backward slice */
+    for (DWORD Index = m_BdFlushed; Index < m_BdPath.size (); Index++)
+    {
+        DgNode *N = m_BdPath[Index];
+        
+        DEBUG("%d ", N->GetId ());
+        m_BackwardSlice.Mark (N->GetId ());
+    }
+    m_BdFlushed = m_BdPath.size ();
+    m_BackwardSlice.Mark (SrcNode->GetId ());
+    DEBUG("<%d> \r\n", SrcNode->GetId ());
+
+    return;
+}
+
+/* depth-first over the dd in edges of the forward slice, on an explicit stack */
+VOID ProgramSlice::BackwardDfs (DgNode *Node, VisitMark *Path)
+{
+    std::vector<T_SliceFrame> Stack;
+
+    Path->Mark (Node->GetId ());
+    m_BdPath.push_back (Node);
+    m_Dg->ExpandNode (Node);
+    Stack.push_back (T_SliceFrame (Node));
+
+    while (!Stack.empty () && m_OverBudget == BG_NONE)
     {
-        DgEdge *Edge = *Egit;
-        if (!(Edge->GetAttr () & EA_DD))
+        m_MaxDepth = (Stack.size () > m_MaxDepth) ? Stack.size () : m_MaxDepth;
+        
+        T_SliceFrame &Top = Stack.back ();
+        DgNode *CurNode = Top.m_Node;
+        DgNode::kind_range Edges = CurNode->InEdges<EA_DD> ();
+        if (Top.m_Next >= (DWORD)(Edges.end () - Edges.begin ()))
         {
+            Stack.pop_back ();
             continue;
         }
 
+        DgEdge *Edge = Edges.begin ()[Top.m_Next++];
         DgNode *SrcNode = Edge->GetSrcNode ();
-        if (Node->GetFunction () != SrcNode->GetFunction ())
+        if (!SrcNode->IsHub () && CurNode->GetFunction () != SrcNode->GetFunction ())
         {
             m_PathFuncSet.insert (SrcNode->GetFunction ());
         }
         
-        if (SrcNode == m_Root || m_BackwardSlice.find (SrcNode) != m_BackwardSlice.end())
+        if (SrcNode == m_Root || m_BackwardSlice.IsMarked (SrcNode->GetId ()))
         {
-            /* update function */
-            for (auto It = m_PathFuncSet.begin (), End = m_PathFuncSet.end(); It != End; It++)
-            {
-                m_BdFuncSet.insert (*It);
-            }
-
-            /* update backward slice */
-            for (auto It = Path->begin (), End = Path->end(); It != End; It++)
-            {
-                DgNode *N = *It;
-                
-                DEBUG("%d ", N->GetId ());
-                m_BackwardSlice.insert (N);
-            }
-            m_BackwardSlice.insert (SrcNode);
-            DEBUG("<%d> \r\n", SrcNode->GetId ());
-
-            break;
+            UpdateBackwardSlice (SrcNode);
+            
+            Stack.pop_back ();
+            continue;
         }
 
-        if (Path->find(SrcNode) != Path->end())
+        if (Path->IsMarked (SrcNode->GetId ()))
         {
             continue;
         }
 
-        if (m_ForwardSlice.find (SrcNode) == m_ForwardSlice.end())
+        if (!m_ForwardSlice.IsMarked (SrcNode->GetId ()))
         {
             continue;
         }
 
-
-        if (m_FdFuncSet.find (SrcNode->GetFunction ()) == m_FdFuncSet.end())
+        /* a hub belongs to no function, its defs are checked on the next hop */
+        if (!SrcNode->IsHub () && m_FdFuncSet.find (SrcNode->GetFunction ()) == m_FdFuncSet.end())
         {
             continue;        
         }   
-                
-        BackwardDfs (SrcNode, Path);
-    }
 
-    //Path->erase(Node);
-    //m_PathFuncSet.erase (Node->GetFunction ());
+        Path->Mark (SrcNode->GetId ());
+        m_BdPath.push_back (SrcNode);
+        m_Dg->ExpandNode (SrcNode);
+        Stack.push_back (T_SliceFrame (SrcNode));
+        Charge ();
+    }
 
     return;
 }
@@ -217,7 +255,9 @@ VOID ProgramSlice::BackwardDfs (DgNode *Node, DgNodeSet *Path)
 
 VOID ProgramSlice::BackwardTraverse(DgNode *Node) 
 {
-    DgNodeSet Path;
+    VisitMark Path (m_Dg->GetNodeNum () + 1);
+    m_BdPath.clear ();
+    m_BdFlushed = 0;
 
     DEBUG("Backforward slicing: "); 
 
@@ -236,19 +276,15 @@ DWORD ProgramSlice::VisitEdgeType (DgNode *Node, DgNodeSet *Path)
     }
 
     DWORD EdgeType = 0;
-    for (auto Egit = Node->OutEdgeBegin (), End = Node->OutEdgeEnd (); Egit != End; Egit++)
+    for (DgEdge *Edge : Node->OutEdges<EA_CFG> ())
     {
-        DgEdge *Edge = *Egit;
-        if (!(Edge->GetAttr () & EA_CFG))
-        {
-            continue;
-        }
-
         EdgeType |= Edge->GetAttr ();      
         DgNode *DstNode = Edge->GetDstNode ();
-        if ((Edge->GetAttr () & EA_CALL) &&  m_BdFuncSet.find (DstNode->GetFunction ()) != m_BdFuncSet.end())
+        if ((Edge->GetAttr () & EA_CALL) &&  m_BdFuncSet.find (DstNode->GetFunction ()) != m_BdFuncSet.end() &&
+            !IsCalleeClosed (DstNode))
         {
-            if (Path->find(DstNode) == Path->end())
+            /* no path: the dataflow decides it for all paths */
+            if (Path == NULL || Path->find(DstNode) == Path->end())
             {
                 return (EA_CALL);
         }   }
@@ -283,14 +319,8 @@ bool ProgramSlice::IsExit (DgNode *DstNode)
 
 DgNode* ProgramSlice::GetPredom (DgNode *Node)
 {
-    for (auto Egit = Node->InEdgeBegin (), End = Node->InEdgeEnd (); Egit != End; Egit++)
+    for (DgEdge *Edge : Node->InEdges<EA_DD> ())
     {
-        DgEdge *Edge = *Egit;
-        if (!(Edge->GetAttr () & EA_DD))
-        {
-            continue;
-        }
-
         return Edge->GetSrcNode ();
     }
 
@@ -313,13 +343,13 @@ bool ProgramSlice::IsDeBranch (DgNodeSet *Path)
         BranchNum++;
         DEBUG ("Branch: %d\r\n", Node->GetId ());
 
-        if (m_ForwardSlice.find (Node) == m_ForwardSlice.end())
+        if (!m_ForwardSlice.IsMarked (Node->GetId ()))
         {
             return false;
         }
 
         PreNode = GetPredom (Node);
-        if (PreNode != NULL && llvmAdpt::IsCmpInst (PreNode->GetInst ()))
+        if (PreNode != NULL && !PreNode->IsHub () && llvmAdpt::IsCmpInst (PreNode->GetInst ()))
         {
             llvm::Instruction *Inst = PreNode->GetInst ();
             Constant *Const0 = dyn_cast<Constant>(Inst->getOperand(0));
@@ -347,33 +377,32 @@ bool ProgramSlice::IsDeBranch (DgNodeSet *Path)
 bool ProgramSlice::IsPathValid (DgNode *SinkNode, DgNodeSet *Path)
 {
     DgNode *CurNode;
-    ComQueue<DgNode *> Queue;
+    MarkQueue<DgNode *> Queue (m_Dg->GetNodeNum () + 1);
 
     DEBUG ("\r\n\tChecking Valid->backward slicing:");
     Queue.InQueue (SinkNode);
     do
     {
         CurNode = Queue.OutQueue ();
+        m_Dg->ExpandNode (CurNode);
         DEBUG ("%d ", CurNode->GetId ());
+        if (Charge ())
+        {
+            return false;
+        }
 
         /* iterate all children node */
-        for (auto it = CurNode->InEdgeBegin (), end = CurNode->InEdgeEnd ();
-            it != end; it++)
+        for (DgEdge *Edge : CurNode->InEdges<EA_DD> ())
         {
-            DgEdge *Edge = *it;
-            if (!(Edge->GetAttr () & EA_DD))
-            {
-                continue;
-            }
-
             DgNode *SrcNode = Edge->GetSrcNode ();
-            if (Path->find (SrcNode) == Path->end() &&
+            /* hubs are off the cfg path: pass through them like a call site */
+            if (Path->find (SrcNode) == Path->end() && !SrcNode->IsHub () &&
                 !llvmAdpt::IsCallSite (SrcNode->GetInst ()))
             {
                 continue;
             }
 
-            if (m_BackwardSlice.find (SrcNode) == m_BackwardSlice.end())
+            if (!m_BackwardSlice.IsMarked (SrcNode->GetId ()))
             {
                 continue;
             }
@@ -394,14 +423,123 @@ bool ProgramSlice::IsPathValid (DgNode *SinkNode, DgNodeSet *Path)
     return IsDeBranch (Path);
 }
 
+/* a value of the backward slice passed to callees that free it on all paths, 
+   checked on the path as the def of a sink */
+bool ProgramSlice::IsCallFreed (DgNode *CsNode, DgNodeSet *Path)
+{
+    if (m_FreeSum == NULL || !llvmAdpt::IsCallSite (CsNode->GetInst ()))
+    {
+        return false;
+    }
+
+    m_SumLookup++;
+    for (DgEdge *Edge : CsNode->InEdges<EA_DD> ())
+    {
+        DgNode *DefNode = Edge->GetSrcNode ();
+        if (!m_BackwardSlice.IsMarked (DefNode->GetId ()) || 
+            !m_FreeSum->IsFreedByCall (CsNode, Edge->GetEdgeValue ()))
+        {
+            continue;
+        }
+
+        if (DefNode == m_Root || IsPathValid (DefNode, Path))
+        {
+            DEBUG ("\tFreed by callees <%d>\r\n", CsNode->GetId ());
+            m_SumHit++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* a closed callee reaches no sink and returns on all paths: the call is stepped over,
+   unless entering it could reach out by a return to another caller */
+bool ProgramSlice::IsCalleeClosed (DgNode *Entry)
+{
+    if (m_FreeSum == NULL)
+    {
+        return false;
+    }
+
+    llvm::Function *Callee = Entry->GetFunction ();
+    auto It = m_StepOver.find (Callee);
+    if (It != m_StepOver.end ())
+    {
+        return It->second;
+    }
+
+    m_SumLookup++;
+    bool IsStepOver = m_FreeSum->IsClosed (Callee) && !IsReturnOut (Entry);
+    if (IsStepOver)
+    {
+        m_SumHit++;
+    }
+
+    m_StepOver[Callee] = IsStepOver;
+    return IsStepOver;
+}
+
+/* CfgPathDfs in the callee, or in a callee it enters, takes the return edges of the tail:
+   one to a function out of the forward slice sets m_ReachOut */
+bool ProgramSlice::IsReturnOut (DgNode *Entry)
+{
+    FunctionSet Visited;
+    std::vector<DgNode*> Entries;
+
+    Visited.insert (Entry->GetFunction ());
+    Entries.push_back (Entry);
+    while (!Entries.empty ())
+    {
+        FuncDg *Fdg = m_Dg->GetFuncDg (Entries.back ());
+        Entries.pop_back ();
+        if (Fdg == NULL || Fdg->GetTail () == NULL)
+        {
+            return true;
+        }
+
+        DgNode *Tail = Fdg->GetTail ();
+        m_Dg->ExpandNode (Tail);
+        for (DgEdge *Edge : Tail->OutEdges<EA_CFG> ())
+        {
+            if ((Edge->GetAttr () & EA_RET) && 
+                m_FdFuncSet.find (Edge->GetDstNode ()->GetFunction ()) == m_FdFuncSet.end())
+            {
+                return true;
+            }
+        }
+
+        for (auto Nit = Fdg->FdnBegin (), End = Fdg->FdnEnd (); Nit != End; Nit++)
+        {
+            DgNode *Node = *Nit;
+            if (!llvmAdpt::IsCallSite (Node->GetInst ()))
+            {
+                continue;
+            }
+
+            m_Dg->ExpandNode (Node);
+            for (DgEdge *Edge : Node->OutEdges<EA_CFG> ())
+            {
+                DgNode *DstNode = Edge->GetDstNode ();
+                llvm::Function *Func = DstNode->GetFunction ();
+                if ((Edge->GetAttr () & EA_CALL) && m_BdFuncSet.find (Func) != m_BdFuncSet.end() &&
+                    Visited.insert (Func).second)
+                {
+                    Entries.push_back (DstNode);
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
 bool ProgramSlice::IsRetContext (DgNodeSet *Path, DgNode *DstNode)
 {
 
-    for (auto it = DstNode->InEdgeBegin (), end = DstNode->InEdgeEnd (); it != end; it++)
+    for (DgEdge *InEdge : DstNode->InEdges<EA_CFG> ())
     {
-        DgEdge *InEdge = *it;
-        if (!(InEdge->GetAttr () & EA_CFG) ||
-            (InEdge->GetAttr () & EA_RET))
+        if (InEdge->GetAttr () & EA_RET)
         {
             continue;
         }
@@ -416,81 +554,374 @@ bool ProgramSlice::IsRetContext (DgNodeSet *Path, DgNode *DstNode)
 }
 
 
+/* cfg paths from the root on an explicit stack: a node leaves the path when its edges are
+   done or it breaks, and a frame returning with m_ReachOut set breaks every caller.
+   m_PathNum counts the paths completed: at a sink, a freeing call, an exit or out of the slice */
 VOID ProgramSlice::CfgPathDfs (DgNode *Node, DgNodeSet *Path)
 {
+    std::vector<T_SliceFrame> Stack;
+
     if (IsExit (Node))
     {
         return;
     }
     
     Path->insert (Node);
-
-    DWORD EdgeType = VisitEdgeType (Node, Path);
+    m_Dg->ExpandNode (Node);
+    Stack.push_back (T_SliceFrame (Node, VisitEdgeType (Node, Path)));
     DEBUG ("%d ", Node->GetId ());
-    
-    for (auto Egit = Node->OutEdgeBegin (), End = Node->OutEdgeEnd (); Egit != End; Egit++)
+
+    while (!Stack.empty () && m_OverBudget == BG_NONE)
     {
-        DgEdge *Edge = *Egit;
-        if (!(Edge->GetAttr () & EA_CFG))
+        m_MaxDepth = (Stack.size () > m_MaxDepth) ? Stack.size () : m_MaxDepth;
+        
+        T_SliceFrame &Top = Stack.back ();
+        DgNode *CurNode = Top.m_Node;
+        DgNode::kind_range Edges = CurNode->OutEdges<EA_CFG> ();
+
+        bool IsLeave = (Top.m_Next >= (DWORD)(Edges.end () - Edges.begin ()));
+        if (!IsLeave)
         {
-            continue;
+            DgEdge *Edge = Edges.begin ()[Top.m_Next++];
+            DgNode *DstNode = Edge->GetDstNode ();
+            if (Path->find(DstNode) != Path->end())
+            {
+                continue;
+            }
+
+            if (!(Edge->GetAttr () & Top.m_EdgeType))
+            {
+                continue;
+            } 
+            
+            /* has no outgoing edge */
+            m_Dg->ExpandNode (DstNode);
+            if (DstNode->GetOutgoingEdgeNum () == 0)
+            {
+                m_ReachOut = true;
+                m_PathNum++;
+                DEBUG (" <%d->ReachOut>-[%s]", DstNode->GetId (), DstNode->GetFunction ()->getName().data()); 
+                IsLeave = true;
+            }
+            else
+            {
+                if (Edge->GetAttr () & EA_RET)
+                {
+                    /* reach out */
+                    if (m_FdFuncSet.find (DstNode->GetFunction ()) == m_FdFuncSet.end())
+                    {
+                        m_ReachOut = true;
+                        m_PathNum++;
+                        DEBUG (" <%d->ret-ReachOut>-[%s]", DstNode->GetId (), DstNode->GetFunction ()->getName().data());
+
+                        continue;
+                    }
+
+                    if (!IsRetContext (Path, DstNode))
+                    {
+                        DEBUG (" [%d]->[%d]context invalid. ", CurNode->GetId(), DstNode->GetId ());
+                        continue;
+                    }
+
+                    m_CrossFuncNum++;
+                }
+
+                /* reach the sink, check valid */
+                if (m_Sinks.find (DstNode) != m_Sinks.end())
+                {
+                    m_PathNum++;
+                    m_ReachOut = !IsPathValid (DstNode, Path);
+                    DEBUG ("\tReach sink <%d> -> IsPathValid==%d>\r\n", DstNode->GetId (), !m_ReachOut);
+                    continue;
+                }
+
+                /* the callees free the value on all their paths: the path ends as at a sink */
+                if (IsCallFreed (DstNode, Path))
+                {
+                    m_PathNum++;
+                    continue;
+                }
+
+                /* an exit call returns at once: the caller only checks m_ReachOut */
+                if (!IsExit (DstNode))
+                {
+                    Path->insert (DstNode);
+                    m_Dg->ExpandNode (DstNode);
+
+                    DWORD EdgeType = VisitEdgeType (DstNode, Path);
+                    DEBUG ("%d ", DstNode->GetId ());
+                    Stack.push_back (T_SliceFrame (DstNode, EdgeType));
+                    Charge ();
+                    continue;
+                }
+
+                m_PathNum++;
+                IsLeave = m_ReachOut;
+            }
         }
 
-        DgNode *DstNode = Edge->GetDstNode ();
-        if (Path->find(DstNode) != Path->end())
+        if (!IsLeave)
         {
             continue;
         }
 
-         if (!(Edge->GetAttr () & EdgeType))
-         {
-            continue;
-         } 
-        
-        /* has no outgoing edge */
-        if (DstNode->GetOutgoingEdgeNum () == 0)
+        Path->erase (CurNode);
+        Stack.pop_back ();
+
+        /* returning with m_ReachOut breaks the caller, and so on up to the root */
+        if (m_ReachOut)
         {
-            m_ReachOut = true;//IsDeBranch (Path);
-            DEBUG (" <%d->ReachOut>-[%s]", DstNode->GetId (), DstNode->GetFunction ()->getName().data()); 
-            break;
+            while (!Stack.empty ())
+            {
+                Path->erase (Stack.back ().m_Node);
+                Stack.pop_back ();
+            }
+        }
+    }
+
+    return;
+}
+
+
+DWORD ProgramSlice::AddFlowState (DgNode *Node, DWORD Ctx)
+{
+    DWORD StateId = m_Flow.size ();
+    
+    m_Flow.push_back (T_FlowState ());
+    T_FlowState &State = m_Flow.back ();
+    State.m_Node    = Node;
+    State.m_Ctx     = Ctx;
+    State.m_Value   = MF_MUST;
+    State.m_IsFixed = (Node == NULL);
+
+    if (Node != NULL)
+    {
+        m_FlowIdx[Ctx][Node] = StateId;
+    }
+
+    return StateId;
+}
+
+/* the state entered by a cfg edge into Node, checked in the order of CfgPathDfs */
+DWORD ProgramSlice::GetFlowState (DgNode *Node, DWORD Ctx)
+{
+    m_Dg->ExpandNode (Node);
+    if (Node->GetOutgoingEdgeNum () == 0)
+    {
+        return MF_ESCAPE;
+    }
+
+    if (m_Sinks.find (Node) != m_Sinks.end ())
+    {
+        Ctx = FC_SINK;
+    }
+    else if (IsExit (Node))
+    {
+        return MF_MUST;
+    }
+
+    auto It = m_FlowIdx[Ctx].find (Node);
+    if (It != m_FlowIdx[Ctx].end ())
+    {
+        return It->second;
+    }
+
+    return AddFlowState (Node, Ctx);
+}
+
+/* the callee tails return to the local successor of the call site */
+DgNode* ProgramSlice::GetRetSite (DgNode *CsNode)
+{
+    for (DgEdge *Edge : CsNode->OutEdges<EA_CFG> ())
+    {
+        if (!(Edge->GetAttr () & (EA_CALL|EA_RET)))
+        {
+            return Edge->GetDstNode ();
         }
+    }
+
+    return NULL;
+}
 
-        if (Edge->GetAttr () & EA_RET)
+VOID ProgramSlice::BuildFlowDeps (DWORD StateId)
+{
+    DgNode *Node = m_Flow[StateId].m_Node;
+    DWORD Ctx    = m_Flow[StateId].m_Ctx;
+    std::vector<T_FlowDep> Deps;
+
+    DWORD EdgeType = VisitEdgeType (Node, NULL);
+    for (DgEdge *Edge : Node->OutEdges<EA_CFG> ())
+    {
+        DWORD Attr = Edge->GetAttr ();
+        DgNode *DstNode = Edge->GetDstNode ();
+
+        T_FlowDep Dep;
+        Dep.m_RetState = MF_NO_RET;
+        
+        if (Attr & EA_RET)
         {
-            /* reach out */
-            if (m_FdFuncSet.find (DstNode->GetFunction ()) == m_FdFuncSet.end())
+            /* a called function returns to the call site */
+            if (Ctx == FC_CALLEE)
             {
-                m_ReachOut = true;
-                DEBUG (" <%d->ret-ReachOut>-[%s]", DstNode->GetId (), DstNode->GetFunction ()->getName().data());
+                Deps.clear ();
+                Dep.m_State = MF_RET;
+                Deps.push_back (Dep);
+                break;
+            }
 
+            if (!(Attr & EdgeType))
+            {
                 continue;
             }
 
-            if (!IsRetContext (Path, DstNode))
+            /* the slice level returns to any caller in the forward slice */
+            if (m_FdFuncSet.find (DstNode->GetFunction ()) == m_FdFuncSet.end())
             {
-                DEBUG (" [%d]->[%d]context invalid. ", Node->GetId(), DstNode->GetId ());
-                continue;
+                Dep.m_State = MF_ESCAPE;
             }
+            else
+            {
+                Dep.m_State = GetFlowState (DstNode, FC_TOP);
+            }
+        }
+        else if (!(Attr & EdgeType))
+        {
+            continue;
+        }
+        else if (Attr & EA_CALL)
+        {
+            DgNode *RetSite = GetRetSite (Node);
+            
+            Dep.m_State    = GetFlowState (DstNode, FC_CALLEE);
+            Dep.m_RetState = (RetSite != NULL) ? GetFlowState (RetSite, Ctx) : (DWORD)MF_ESCAPE;
+        }
+        else
+        {
+            Dep.m_State = GetFlowState (DstNode, Ctx);
+        }
 
-            m_CrossFuncNum++;
+        Deps.push_back (Dep);
+    }
+
+    m_Flow[StateId].m_Deps.swap (Deps);
+    return;
+}
+
+inline DWORD ProgramSlice::GetDepValue (T_FlowDep &Dep)
+{
+    DWORD Value = m_Flow[Dep.m_State].m_Value;
+    if (Value == MF_RET && Dep.m_RetState != MF_NO_RET)
+    {
+        Value = m_Flow[Dep.m_RetState].m_Value;
+    }
+
+    return Value;
+}
+
+/* 
+   every path from the root ends in a valid sink, an exit call or a cycle:
+   a monotone dataflow over (cfg node, context) states, values only rise from
+   MF_MUST, so each state changes twice at most. calls are matched through the
+   FC_CALLEE states of the callee, a sink is checked once against all the
+   nodes explored instead of one path.
+*/
+bool ProgramSlice::ComputeMustFree ()
+{
+    m_Flow.clear ();
+    m_FlowIdx[FC_TOP].clear ();
+    m_FlowIdx[FC_CALLEE].clear ();
+    m_FlowIdx[FC_SINK].clear ();
+
+    /* the constant states, their ids are their values */
+    AddFlowState (NULL, FC_TOP);
+    AddFlowState (NULL, FC_TOP);
+    AddFlowState (NULL, FC_TOP);
+    m_Flow[MF_RET].m_Value    = MF_RET;
+    m_Flow[MF_ESCAPE].m_Value = MF_ESCAPE;
+
+    /* 1. explore the states from the root */
+    m_Dg->ExpandNode (m_Root);
+    DWORD RootId = AddFlowState (m_Root, FC_TOP);
+    for (DWORD StateId = RootId; StateId < m_Flow.size (); StateId++)
+    {
+        if (Charge ())
+        {
+            return false;
+        }
+        
+        if (m_Flow[StateId].m_Ctx != FC_SINK)
+        {
+            BuildFlowDeps (StateId);
         }
+    }
 
-        /* reach the sink, check valid */
-        if (m_Sinks.find (DstNode) != m_Sinks.end())
+    /* 2. the sinks against the explored region */
+    DgNodeSet Region;
+    for (DWORD StateId = RootId; StateId < m_Flow.size (); StateId++)
+    {
+        Region.insert (m_Flow[StateId].m_Node);
+    }
+    
+    for (auto It = m_FlowIdx[FC_SINK].begin (), End = m_FlowIdx[FC_SINK].end (); It != End; It++)
+    {
+        T_FlowState &State = m_Flow[It->second];
+        State.m_IsFixed = true;
+        State.m_Value   = IsPathValid (State.m_Node, &Region) ? MF_MUST : MF_ESCAPE;
+    }
+
+    /* 3. fixpoint */
+    std::vector<DWORD> WorkList;
+    std::vector<bool> InList (m_Flow.size (), false);
+    for (DWORD StateId = RootId; StateId < m_Flow.size (); StateId++)
+    {
+        T_FlowState &State = m_Flow[StateId];
+        for (auto It = State.m_Deps.begin (), End = State.m_Deps.end (); It != End; It++)
+        {
+            m_Flow[It->m_State].m_Users.push_back (StateId);
+            if (It->m_RetState != MF_NO_RET)
+            {
+                m_Flow[It->m_RetState].m_Users.push_back (StateId);
+            }
+        }
+
+        if (!State.m_IsFixed)
+        {
+            WorkList.push_back (StateId);
+            InList[StateId] = true;
+        }
+    }
+
+    while (!WorkList.empty ())
+    {
+        DWORD StateId = WorkList.back ();
+        WorkList.pop_back ();
+        InList[StateId] = false;
+
+        T_FlowState &State = m_Flow[StateId];
+        DWORD Value = MF_MUST;
+        for (auto It = State.m_Deps.begin (), End = State.m_Deps.end (); It != End; It++)
+        {
+            Value = std::max (Value, GetDepValue (*It));
+        }
+
+        if (Value <= State.m_Value)
         {
-            m_ReachOut = !IsPathValid (DstNode, Path);
-            DEBUG ("\tReach sink <%d> -> IsPathValid==%d>\r\n", DstNode->GetId (), !m_ReachOut);
             continue;
         }
-                
-        CfgPathDfs (DstNode, Path);
-        if (m_ReachOut)
+        State.m_Value = Value;
+
+        for (auto It = State.m_Users.begin (), End = State.m_Users.end (); It != End; It++)
         {
-            break;
+            if (!InList[*It] && !m_Flow[*It].m_IsFixed)
+            {
+                WorkList.push_back (*It);
+                InList[*It] = true;
+            }
         }
     }
-    
-    Path->erase(Node);
+
+    DEBUG ("MustFree: %u states, root %u\r\n", (DWORD)m_Flow.size (), m_Flow[RootId].m_Value);
+    return (m_Flow[RootId].m_Value == MF_MUST);
 }
 
 
@@ -509,10 +940,24 @@ VOID ProgramSlice::ComputePathReachable()
 
     m_ReachOut = false;
     m_CrossFuncNum = 0;
-    
-    DEBUG ("Path: <%d> -> ", m_Root->GetId ());
-    CfgPathDfs (m_Root, &Path);
-    DEBUG("\r\n");
+
+    if (m_PathEngine == PE_DATAFLOW)
+    {
+        m_ReachOut = !ComputeMustFree ();
+    }
+    else
+    {
+        DEBUG ("Path: <%d> -> ", m_Root->GetId ());
+        CfgPathDfs (m_Root, &Path);
+        DEBUG("\r\n");
+
+        if (m_PathEngine == PE_COMPARE && ComputeMustFree () == m_ReachOut && m_OverBudget == BG_NONE)
+        {
+            printf ("PathEngine: source %u at %s, dfs: %s, dataflow: %s\r\n", m_Root->GetId (),
+                    llvmAdpt::GetSourceLoc (m_Root->GetInst ()).c_str(),
+                    m_ReachOut ? "partial" : "all", m_ReachOut ? "all" : "partial");
+        }
+    }
 
     if (m_ReachOut == false)
     {
@@ -526,12 +971,15 @@ VOID ProgramSlice::ComputePathReachable()
 VOID ProgramSlice::RunSlicing(DgNodeSet &SinksSet)
 {
     DWORD SinkNo = 0;
+    m_StartTime = Stat::GetWallTime ();
     
     /* 1. forward traverse by data flow, determine partial reachability */
+    m_Stage = "forward";
     ForwardTraverse(SinksSet);
     
     /* 2. backward traverse by control flow, identify branch pass */
-    for (auto it = m_Sinks.begin(), end = m_Sinks.end(); it != end; ++it) 
+    m_Stage = "backward";
+    for (auto it = m_Sinks.begin(), end = m_Sinks.end(); it != end && m_OverBudget == BG_NONE; ++it) 
     {
         DgNode *Sink = *it;
 
@@ -539,18 +987,40 @@ VOID ProgramSlice::RunSlicing(DgNodeSet &SinksSet)
     }
 
     /* 3. compute all path reachability */
+    m_Stage = "path";
     DEBUG ("Sinks.size = %u \r\n", (DWORD)m_Sinks.size());
     if (m_Sinks.size() != 0)
     {
-        ComputePathReachable ();
+        if (m_OverBudget == BG_NONE)
+        {
+            ComputePathReachable ();
+        }
     }
     else
     {
         m_ReachType = REACH_NONE;
     }
 
+    /* what is explored so far is kept for the report */
+    if (m_OverBudget != BG_NONE)
+    {
+        m_ReachType = REACH_INCONCLUSIVE;
+    }
+
     return;
 }
 
+std::string ProgramSlice::GetBudgetInfo ()
+{
+    static const CHAR *BudgetName[] = {"none", "time", "node", "path", "total"};
+    
+    CHAR Info[256];
+    snprintf (Info, sizeof (Info), "%s budget in %s slicing: %u nodes, %u paths, %u sinks reached, %u ms",
+              BudgetName[m_OverBudget], m_Stage, m_VisitNum, m_PathNum, (DWORD)m_Sinks.size (), 
+              Stat::GetWallTime () - m_StartTime);
+    
+    return std::string (Info);
+}
+
 
 
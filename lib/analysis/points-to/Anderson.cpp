@@ -20,6 +20,7 @@
 #include "llvmadpt/LlvmAdpt.h"
 #include "analysis/points-to/Anderson.h"
 #include "analysis/CycleDetect.h"
+#include "common/Checkpoint.h"
 
 using namespace llvm;
 using namespace std;
@@ -141,90 +142,102 @@ VOID Anderson::AddGlbInitialCst(DWORD ObjId, Constant *Const)
     }
 }
 
-VOID Anderson::CollectCstOfGlobal()
+BOOL Anderson::CreateGlobalNode (GlobalVariable *Global)
 {
-    DWORD ValId, ObjId;
-    GlobalVariable *Global;
-    Function *Func;
+    BOOL IsStr = IsGlobalStr(Global);
+    DWORD ObjId;
 
-    DWORD GlobStrNum = 0, Total = 0;
-    for (auto It = m_ModMange.global_begin (); 
-              It != m_ModMange.global_end (); It++) 
+    DWORD ValId = CreateValueNode(Global);
+    if (IsStr)
+    {
+        ObjId = CreateObjNode(Global, GetUniversalObjNode());
+    }
+    else
     {
-        Global = *It;
+        ObjId = CreateObjNode(Global);
+    }  
 
-        ValId = CreateValueNode(Global);
-        if (IsGlobalStr(Global))
-        {
-            ObjId = CreateObjNode(Global, GetUniversalObjNode());
-            GlobStrNum++;
-        }
-        else
-        {
-            ObjId = CreateObjNode(Global);
-        }  
+    AddCosntraint(Constraint::E_ADDR_OF, ValId, ObjId);
+    return IsStr;
+}
 
-        Total++;
-        AddCosntraint(Constraint::E_ADDR_OF, ValId, ObjId);
+VOID Anderson::CreateFuncNode (Function *Func)
+{
+    DWORD ValId = CreateValueNode(Func);
+    DWORD ObjId = CreateObjNode(Func);
+    AddCosntraint(Constraint::E_ADDR_OF, ValId, ObjId);
+
+    if (Func->isDeclaration() || Func->isIntrinsic())
+    {
+        return;
     }
 
-    DEBUG ("GlobStrNum = [%u/%u] \r\n", GlobStrNum, Total);
+    /* return a pointer */
+    if (llvmAdpt::IsFunctionPtrType (Func)) 
+    {
+        ValId = CreateRetNode(Func);
+    }
 
-    for (auto It = m_ModMange.func_begin (); 
-              It != m_ModMange.func_end (); It++)
+    /* var arg function */
+    if (llvmAdpt::IsFunctionVarArg (Func))
     {
-        Func  = *It;
-        
-        ValId = CreateValueNode(Func);
-        ObjId = CreateObjNode(Func);
-        AddCosntraint(Constraint::E_ADDR_OF, ValId, ObjId);
+        ValId = CreateVarArgNode(Func);
+    }
 
-        if (Func->isDeclaration() || Func->isIntrinsic())
+    /* Add nodes for all formal arguments.*/
+    for (Function::arg_iterator itr = Func->arg_begin(); itr != Func->arg_end(); ++itr) 
+    {
+        if (llvmAdpt::IsValuePtrType (&*itr))
         {
-            continue;
+            ValId = CreateValueNode(&*itr);
         }
+    }
 
-        /* return a pointer */
-        if (llvmAdpt::IsFunctionPtrType (Func)) 
-        {
-            ValId = CreateRetNode(Func);
-        }
+    return;
+}
 
-        /* var arg function */
-        if (llvmAdpt::IsFunctionVarArg (Func))
-        {
-            ValId = CreateVarArgNode(Func);
-        }
+VOID Anderson::AddGlobalInitCst (GlobalVariable *Global)
+{
+    DWORD ObjId = GetObjNode(Global);
+    assert(ObjId != 0);
 
-        /* Add nodes for all formal arguments.*/
-        for (Function::arg_iterator itr = Func->arg_begin(); itr != Func->arg_end(); ++itr) 
-        {
-            if (llvmAdpt::IsValuePtrType (&*itr))
-            {
-                ValId = CreateValueNode(&*itr);
-            }
-        }
+    if (Global->hasDefinitiveInitializer()) 
+    {
+        AddGlbInitialCst(ObjId, Global->getInitializer());
+    } 
+    else 
+    {
+        /* If it doesn't have an initializer (i.e. it's defined in another
+           translation unit), it points to the universal set. */
+        AddCosntraint(Constraint::E_COPY, ObjId, GetUniversalObjNode());
     }
 
-    // Init globals here since an initializer may refer to a global var/func below
+    return;
+}
+
+VOID Anderson::CollectCstOfGlobal()
+{
+    DWORD GlobStrNum = 0, Total = 0;
     for (auto It = m_ModMange.global_begin (); 
               It != m_ModMange.global_end (); It++) 
     {
-        Global = *It;
+        GlobStrNum += CreateGlobalNode (*It);
+        Total++;
+    }
+
+    DEBUG ("GlobStrNum = [%u/%u] \r\n", GlobStrNum, Total);
 
-        DWORD ObjId = GetObjNode(Global);
-        assert(ObjId != 0);
+    for (auto It = m_ModMange.func_begin (); 
+              It != m_ModMange.func_end (); It++)
+    {
+        CreateFuncNode (*It);
+    }
 
-        if (Global->hasDefinitiveInitializer()) 
-        {
-            AddGlbInitialCst(ObjId, Global->getInitializer());
-        } 
-        else 
-        {
-            /* If it doesn't have an initializer (i.e. it's defined in another
-               translation unit), it points to the universal set. */
-            AddCosntraint(Constraint::E_COPY, ObjId, GetUniversalObjNode());
-        }
+    // Init globals here since an initializer may refer to a global var/func below
+    for (auto It = m_ModMange.global_begin (); 
+              It != m_ModMange.global_end (); It++) 
+    {
+        AddGlobalInitCst (*It);
     }
 }
 
@@ -376,7 +389,7 @@ VOID Anderson::AddCallSiteCst(ImmutableCallSite Cs)
             }
         }
 
-        if (IsDebugFunction(Func->getName()))
+        if (IsDebugFunction(Func))
         {
             return;
         }
@@ -785,11 +798,46 @@ VOID Anderson::CollectCstOfInst(Instruction *Inst)
 }
 
 
-VOID Anderson::CollectConstraints() 
+VOID Anderson::CollectCstOfFunc (Function *Func)
 {
-    Function *Func;
     Instruction *Inst;
-    
+
+    if (Func->isDeclaration() || Func->isIntrinsic() || IsDebugFunction (Func))
+    {
+        return;
+    }
+
+    /* First, create a value node for each instruction with pointer type */
+    for (inst_iterator itr = inst_begin(*Func), ite = inst_end(*Func); itr != ite; ++itr) 
+    {
+        Inst = &*itr.getInstructionIterator();
+        if (llvmAdpt::IsValuePtrType (Inst))
+        {
+            CreateValueNode(Inst);
+        }
+    }
+
+    //errs()<<"Collect Func: "<<Func->getName()<<"\r\n";
+    /* Sec, collect constraint for each relevant instruction */
+    for (inst_iterator itr = inst_begin(*Func), ite = inst_end(*Func); itr != ite; ++itr) 
+    {
+        Inst = &*itr.getInstructionIterator();
+
+        /* a call site may resolve to another module, it waits until all are loaded */
+        if (m_IsStream && (Inst->getOpcode() == Instruction::Call || Inst->getOpcode() == Instruction::Invoke))
+        {
+            m_DeferCall.push_back (Inst);
+            continue;
+        }
+        
+        CollectCstOfInst(Inst);
+    }
+
+    return;
+}
+
+VOID Anderson::InitConstraints() 
+{
     /* 1. the universal set points to itself */
     AddCosntraint(Constraint::E_ADDR_OF, UniversalPtr, UniversalObj);
     AddCosntraint(Constraint::E_STORE, UniversalObj, UniversalObj);
@@ -797,43 +845,112 @@ VOID Anderson::CollectConstraints()
     /* 2. the null pointer points to the null object */
     AddCosntraint(Constraint::E_ADDR_OF, NullPtr, NullObject);
 
-    /* 3. add any constraints on global variables and their initializers. */
+    return;
+}
+
+VOID Anderson::ClearCollect() 
+{
+    m_ObjectNodes.clear();
+    m_ReturnNodes.clear();
+    m_VarargNodes.clear();
+    m_UnsolvedFunc.clear();
+    return;
+}
+
+VOID Anderson::CollectConstraints() 
+{
+    /* 1. universal and null */
+    InitConstraints ();
+
+    /* 2. add any constraints on global variables and their initializers. */
     CollectCstOfGlobal ();
 
-    /* 4. collect function internal instruction objects */
+    /* 3. collect function internal instruction objects */
     for (auto It = m_ModMange.func_begin (), End = m_ModMange.func_end (); 
               It != End; It++)
     {
-        Func  = *It;
-       
-        if (Func->isDeclaration() || Func->isIntrinsic() || IsDebugFunction (Func->getName()))
-        {
-            continue;
-        }
+        CollectCstOfFunc (*It);
+    }
 
-        /* First, create a value node for each instruction with pointer type */
-        for (inst_iterator itr = inst_begin(*Func), ite = inst_end(*Func); itr != ite; ++itr) 
-        {
-            Inst = &*itr.getInstructionIterator();
-            if (llvmAdpt::IsValuePtrType (Inst))
-            {
-                CreateValueNode(Inst);
-            }
-        }
+    ClearCollect ();
+    return;
+}
 
-        //errs()<<"Collect Func: "<<Func->getName()<<"\r\n";
-        /* Sec, collect constraint for each relevant instruction */
-        for (inst_iterator itr = inst_begin(*Func), ite = inst_end(*Func); itr != ite; ++itr) 
-        {
-            Inst = &*itr.getInstructionIterator();
-            CollectCstOfInst(Inst);
-        }
+/*
+   pipelined collection: a module only refers to its own globals and functions,
+   so their nodes and the constraints of all but the call sites are collected
+   as soon as it is parsed. the call sites need the definitions of the other
+   modules and are collected by EndStream.
+*/
+VOID Anderson::BeginStream ()
+{
+    m_IsStream  = AF_TRUE;
+    m_StreamNum = 0;
+    m_StreamTime = 0;
+
+    InitConstraints ();
+    return;
+}
+
+VOID Anderson::CollectModule (Module *Mod)
+{
+    DWORD StartTime = Stat::GetWallTime ();
+
+    for (Module::global_iterator It = Mod->global_begin(), End = Mod->global_end(); It != End; ++It) 
+    {
+        CreateGlobalNode (&*It);
     }
 
-    m_ObjectNodes.clear();
-    m_ReturnNodes.clear();
-    m_VarargNodes.clear();
-    m_UnsolvedFunc.clear();
+    for (Module::iterator It = Mod->begin(), End = Mod->end(); It != End; ++It) 
+    {
+        CreateFuncNode (&*It);
+    }
+
+    for (Module::global_iterator It = Mod->global_begin(), End = Mod->global_end(); It != End; ++It) 
+    {
+        AddGlobalInitCst (&*It);
+    }
+
+    for (Module::iterator It = Mod->begin(), End = Mod->end(); It != End; ++It) 
+    {
+        CollectCstOfFunc (&*It);
+    }
+
+    m_StreamNum++;
+    m_StreamTime += Stat::GetWallTime () - StartTime;
+    return;
+}
+
+VOID Anderson::StreamHook (VOID *Ctx, Module *Mod)
+{
+    Anderson *Andersen = (Anderson *)Ctx;
+    Andersen->CollectModule (Mod);
+}
+
+VOID Anderson::EndStream ()
+{
+    DWORD StartTime = Stat::GetWallTime ();
+
+    /* the modules loaded on demand after the pipeline */
+    DWORD StreamNum = m_StreamNum;
+    for (DWORD Id = StreamNum; Id < m_ModMange.GetModuleNum (); Id++)
+    {
+        CollectModule (m_ModMange.GetModule (Id));
+    }
+
+    m_IsStream = AF_FALSE;
+    for (auto It = m_DeferCall.begin (), End = m_DeferCall.end (); It != End; It++)
+    {
+        CollectCstOfInst (*It);
+    }
+
+    printf("Andersen: %u modules collected in the pipeline (%u ms), %u call sites after it (%u ms)\r\n",
+           StreamNum, m_StreamTime, (DWORD)m_DeferCall.size (), Stat::GetWallTime () - StartTime);
+    
+    std::vector<Instruction*> Empty;
+    m_DeferCall.swap (Empty);
+
+    ClearCollect ();
     return;
 }
 
@@ -982,11 +1099,23 @@ DWORD Anderson::SolveConstraints()
 DWORD Anderson::RunPtsAnalysis ()
 {
     printf("---> start points-to analysis...\r\n");
-    /* 1. compute constraints */
-    CollectConstraints();
+    /* 1. compute constraints, the pipeline collected them while loading */
+    if (m_IsStream)
+    {
+        EndStream ();
+    }
+    else
+    {
+        CollectConstraints();
+    }
     
-    /* 2. solve constraints */
-    SolveConstraints();
+    /* 2. solve constraints, or take the solution of a resumed run */
+    m_CstPrint = GetCstPrint ();
+    if (!LoadCheckpoint ())
+    {
+        SolveConstraints();
+        StoreCheckpoint ();
+    }
 
     //UpdatePointsTo ();
     
@@ -999,6 +1128,123 @@ DWORD Anderson::RunPtsAnalysis ()
     return AF_SUCCESS;
 }
 
+/*
+   the solved graph of a checkpoint: the nodes are created by the collection
+   in the same order for the same input, so the merge target and points-to
+   set of every node are kept by id, for the constraints hashed in CstPrint.
+   sections: Target[NodeNum] | PtsOff[NodeNum+1] | PtsId[] | CstPrint
+*/
+ULONG Anderson::GetCstPrint ()
+{
+    ULONG Hash = CK_HASH_INIT;
+    for (Constraint &Cst : m_Constraints) 
+    {
+        DWORD Word[4] = {(DWORD)Cst.GetType (), Cst.GetDst (), Cst.GetSrc (), Cst.GetOffset ()};
+        Hash = Checkpoint::HashBytes (Hash, Word, sizeof (Word));
+    }
+
+    return Hash;
+}
+
+VOID Anderson::StoreCheckpoint ()
+{
+    if (Checkpoint::GetStorePath (CK_PTS) == "")
+    {
+        return;
+    }
+
+    DWORD NodeNum = m_CstGraph->GetNodeNum ();
+    std::vector<DWORD> Target (NodeNum);
+    std::vector<DWORD> PtsOff (NodeNum+1);
+    std::vector<DWORD> PtsId;
+    for (DWORD Id = 0; Id < NodeNum; Id++)
+    {
+        ConstraintNode *CstNode = m_CstGraph->GetGNode (Id);
+        assert (CstNode != NULL);
+
+        Target[Id] = CstNode->GetMergeTarget ();
+        PtsOff[Id] = PtsId.size ();
+
+        PtsSet *Pts = CstNode->GetPtsSet ();
+        for (auto It = Pts->begin (), End = Pts->end (); It != End; It++)
+        {
+            PtsId.push_back (*It);
+        }
+    }
+    PtsOff[NodeNum] = PtsId.size ();
+
+    std::vector<std::string> Sections (4);
+    Checkpoint::PutArray (Sections[0], Target);
+    Checkpoint::PutArray (Sections[1], PtsOff);
+    Checkpoint::PutArray (Sections[2], PtsId);
+    Checkpoint::PutArray (Sections[3], std::vector<ULONG> (1, m_CstPrint));
+    Checkpoint::Store (CK_PTS, Sections);
+
+    return;
+}
+
+BOOL Anderson::LoadCheckpoint ()
+{
+    std::vector<std::string> Sections;
+    if (!Checkpoint::Load (CK_PTS, Sections) || Sections.size () != 4)
+    {
+        return AF_FALSE;
+    }
+
+    const ULONG *CstPrint;
+    if (Checkpoint::GetArray (Sections[3], CstPrint) != 1 || *CstPrint != m_CstPrint)
+    {
+        printf ("Andersen: the checkpoint was solved from other constraints, solve again\r\n");
+        return AF_FALSE;
+    }
+
+    const DWORD *Target;
+    const DWORD *PtsOff;
+    const DWORD *PtsId;
+    DWORD NodeNum = m_CstGraph->GetNodeNum ();
+    DWORD PtsNum  = Checkpoint::GetArray (Sections[2], PtsId);
+    if (Checkpoint::GetArray (Sections[0], Target) != NodeNum ||
+        Checkpoint::GetArray (Sections[1], PtsOff) != NodeNum + 1 || PtsOff[NodeNum] != PtsNum)
+    {
+        printf ("Andersen: the checkpoint does not match the constraint graph, solve again\r\n");
+        return AF_FALSE;
+    }
+
+    BOOL IsValid = AF_TRUE;
+    for (DWORD Id = 0; Id < NodeNum && IsValid; Id++)
+    {
+        IsValid = (Target[Id] < NodeNum && PtsOff[Id] <= PtsOff[Id+1]);
+    }
+
+    for (DWORD Index = 0; Index < PtsNum && IsValid; Index++)
+    {
+        IsValid = (PtsId[Index] < NodeNum);
+    }
+
+    if (!IsValid)
+    {
+        printf ("Andersen: the checkpoint is corrupted, solve again\r\n");
+        return AF_FALSE;
+    }
+
+    for (DWORD Id = 0; Id < NodeNum; Id++)
+    {
+        ConstraintNode *CstNode = m_CstGraph->GetGNode (Id);
+
+        CstNode->SetMergeTarget (Target[Id]);
+        for (DWORD Index = PtsOff[Id]; Index < PtsOff[Id+1]; Index++)
+        {
+            CstNode->SetPointsTo (PtsId[Index]);
+        }
+    }
+
+    /* the constraints are solved, the graph is not built from them */
+    m_Constraints.clear();
+    printf("Andersen: %u nodes, %u points-to of the solved graph restored\r\n", NodeNum, PtsNum);
+
+    return AF_TRUE;
+}
+
 VOID Anderson::GetPtsTo (Value *Src, std::vector<Value*>& Dst)
 {
     DWORD ValId = GetValueNode (Src);
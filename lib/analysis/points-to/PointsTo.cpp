@@ -49,6 +49,20 @@ DWORD PointsTo::RunPtsAnalysis (T_PTS Type)
     return AF_SUCCESS;
 }
 
+DWORD PointsTo::RunPipeline (T_PTS Type, const std::vector<std::string> &ModulePathVec)
+{
+    assert (Type == T_ANDRESEN && m_Andersen == NULL);
+
+    m_Andersen = new Anderson(m_ModMange);
+    m_Andersen->BeginStream ();
+
+    m_ModMange.LoadModules (ModulePathVec, Anderson::StreamHook, m_Andersen);
+    m_Andersen->RunPtsAnalysis ();
+
+    m_PtsType = T_ANDRESEN;
+    return AF_SUCCESS;
+}
+
 VOID PointsTo::GetPtsTo (llvm::Value *Src, std::vector<llvm::Value*>& Dst)
 {
     if (m_PtsType == T_ANDRESEN)
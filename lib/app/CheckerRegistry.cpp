@@ -0,0 +1,160 @@
+//===- CheckerRegistry.cpp -- dependence-based checkers on one graph -------//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+#include "app/CheckerRegistry.h"
+#include "app/leakdetect/MemLeak.h"
+#include "common/Stat.h"
+
+std::vector<T_CheckerEntry> CheckerRegistry::m_Entries;
+
+VOID CheckerRegistry::InitBuiltin ()
+{
+    if (m_Entries.size () != 0)
+    {
+        return;
+    }
+    
+    Register ("memleak", MemLeak::Create, "memory allocated but not freed on all paths");
+    return;
+}
+
+VOID CheckerRegistry::Register (std::string Name, CheckerCreate Create, std::string Desc)
+{
+    assert (GetEntry (Name) == NULL);
+    
+    T_CheckerEntry Entry;
+    Entry.m_Name   = Name;
+    Entry.m_Create = Create;
+    Entry.m_Desc   = Desc;
+
+    m_Entries.push_back (Entry);
+    return;
+}
+
+T_CheckerEntry* CheckerRegistry::GetEntry (std::string &Name)
+{
+    for (auto It = m_Entries.begin (), End = m_Entries.end (); It != End; It++)
+    {
+        if (It->m_Name == Name)
+        {
+            return &(*It);
+        }
+    }
+
+    return NULL;
+}
+
+LeakDetector* CheckerRegistry::GetChecker (std::string Name)
+{
+    for (auto It = m_Runs.begin (), End = m_Runs.end (); It != End; It++)
+    {
+        if (It->m_Name == Name)
+        {
+            return It->m_Checker;
+        }
+    }
+
+    return NULL;
+}
+
+MemLeak* CheckerRegistry::GetMemLeak ()
+{
+    std::string Name = "memleak";
+    
+    LeakDetector *Checker = GetChecker (Name);
+    assert (Checker == NULL || GetEntry (Name)->m_Create == MemLeak::Create);
+    
+    return static_cast<MemLeak *> (Checker);
+}
+
+DWORD CheckerRegistry::Run (std::string Names)
+{
+    if (Names == "")
+    {
+        Names = "memleak";
+    }
+
+    std::vector<std::string> NameVec;
+    size_t Start = 0;
+    while (Start <= Names.size ())
+    {
+        size_t End = Names.find (',', Start);
+        if (End == std::string::npos)
+        {
+            End = Names.size ();
+        }
+        
+        if (End > Start)
+        {
+            NameVec.push_back (Names.substr (Start, End - Start));
+        }
+        Start = End + 1;
+    }
+
+    for (auto It = NameVec.begin (), End = NameVec.end (); It != End; It++)
+    {
+        T_CheckerEntry *Entry = GetEntry (*It);
+        if (Entry == NULL)
+        {
+            printf ("Alert: unknown checker %s, the checkers are:\r\n", It->c_str());
+            for (auto Eit = m_Entries.begin (), Eend = m_Entries.end (); Eit != Eend; Eit++)
+            {
+                printf ("\t%-16s %s\r\n", Eit->m_Name.c_str(), Eit->m_Desc.c_str());
+            }
+            continue;
+        }
+
+        if (GetChecker (*It) != NULL)
+        {
+            continue;
+        }
+
+        T_CheckerRun Run;
+        Run.m_Name    = *It;
+        Run.m_Checker = Entry->m_Create (m_Dg);
+        Run.m_Time    = 0;
+        assert (Run.m_Checker != NULL);
+
+        printf ("#==========================================================\r\n");
+        printf ("#start %s checking....\r\n", Run.m_Name.c_str());
+        printf ("#==========================================================\r\n");
+
+        DWORD StartTime = Stat::GetWallTime ();
+        Stat::StartTime ("Checker " + Run.m_Name);
+        Run.m_Checker->RunDetector ();
+        Stat::EndTime ("Checker " + Run.m_Name);
+        Run.m_Time = Stat::GetWallTime () - StartTime;
+
+        m_Runs.push_back (Run);
+    }
+
+    PrintStat ();
+    return m_Runs.size ();
+}
+
+VOID CheckerRegistry::PrintStat ()
+{
+    for (auto It = m_Runs.begin (), End = m_Runs.end (); It != End; It++)
+    {
+        printf ("Checker: %-16s %u sources, %u sinks, wall %u (ms)\r\n", It->m_Name.c_str(),
+                It->m_Checker->GetSrcNum (), It->m_Checker->GetSinkNum (), It->m_Time);
+    }
+
+    return;
+}
@@ -20,6 +20,9 @@
 //
 //===----------------------------------------------------------------------===//
 #include "app/leakdetect/MemLeak.h"
+#include "common/Stat.h"
+#include "common/SoftPara.h"
+#include "common/MultiTask.h"
 
 bool MemLeak::IsNormalCheck(llvm::Function *CallFunc)
 {
@@ -47,15 +50,15 @@ bool MemLeak::IsNormalCheck(llvm::Function *CallFunc)
 }
 
 
-bool MemLeak::IsSrcInAWrapper(DgNode *Root, ComQueue<DgNode *>* SrcQueue) 
+bool MemLeak::IsSrcInAWrapper(DgNode *Root, MarkQueue<DgNode *>* SrcQueue) 
 {
     DgNode *Node;
     DgNode *RetNode;
     bool IsReachExit = false;
 
-    DgNodeSet Visited;
+    VisitMark Visited (m_DgGraph->GetNodeNum () + 1);
     
-    ComQueue<DgNode *> Queue;
+    MarkQueue<DgNode *> Queue (m_DgGraph->GetNodeNum () + 1);
     Queue.InQueue(Root);
 
     llvm::Function *CurFunc = Root->GetFunction ();
@@ -67,26 +70,23 @@ bool MemLeak::IsSrcInAWrapper(DgNode *Root, ComQueue<DgNode *>* SrcQueue)
     while (!Queue.IsEmpty ())
     {
         Node  = Queue.OutQueue();
-        if (Visited.find (Node) != Visited.end())
+        if (!Visited.Mark (Node->GetId ()))
         {
             continue;
         }
-        else
-        {
-            Visited.insert (Node);
-        }
+        m_DgGraph->ExpandNode (Node);
 
-        for (auto it = Node->OutEdgeBegin(), end = Node->OutEdgeEnd(); it != end; ++it) 
+        /* follow the data flow */
+        for (DgEdge* Edge : Node->OutEdges<EA_DD> ()) 
         {
-            DgEdge* Edge = (*it);
-
-            /* follow the data flow */
-            if (!(Edge->GetAttr () & EA_DD))
+            DgNode *DstNode = Edge->GetDstNode ();
+            if (DstNode->IsHub ())
             {
-                 continue;
+                /* its uses in the current function are followed from the hub */
+                Queue.InQueue(DstNode);
+                continue;
             }
-     
-            DgNode *DstNode = Edge->GetDstNode ();
+            
             llvm::Instruction *Inst = DstNode->GetInst();
             
             /* reach ret */
@@ -117,10 +117,10 @@ bool MemLeak::IsSrcInAWrapper(DgNode *Root, ComQueue<DgNode *>* SrcQueue)
     }
 
     /* add callsite node */
-    for (auto cit = RetNode->OutEdgeBegin(), cend = RetNode->OutEdgeEnd(); cit != cend; ++cit)
+    m_DgGraph->ExpandNode (RetNode);
+    for (DgEdge* Edge : RetNode->OutEdges<EA_DD> ())
     {
-        DgEdge* Edge = (*cit);
-        if (!(Edge->GetAttr () & EA_RET) || !(Edge->GetAttr () & EA_DD))
+        if (!(Edge->GetAttr () & EA_RET))
         {
              continue;
         }
@@ -138,7 +138,7 @@ VOID MemLeak::CollectSources()
     CallGraph *Cg = m_DgGraph->GetCallGraph ();
     T_CallSiteToIdMap::iterator It, End;
     T_CallSitePair CsPair;
-    DgNodeSet Visited;
+    VisitMark Visited (m_DgGraph->GetNodeNum () + 1);
 
     for (auto It = Cg->CItoIdBegin (), End = Cg->CItoIdEnd (); It != End; It++)
     {
@@ -154,24 +154,20 @@ VOID MemLeak::CollectSources()
 
         llvm::Instruction *Inst = Cs.getInstruction();
         
-        DgNode *Node = m_DgGraph->GetDgNode (Cs.getInstruction());
+        DgNode *Node = m_DgGraph->RequireDgNode (Inst);
         if (Node == NULL)
         {
             continue;
         }
 
-        if (Visited.find (Node) != Visited.end())
+        if (!Visited.Mark (Node->GetId ()))
         {
             continue;
         }
-        else
-        {
-            Visited.insert (Node);
-        }
 
         DEBUG("Source like function: %s -> %s\r\n", Func->getName().data(), llvmAdpt::GetSourceLoc(Inst).c_str());
 
-        ComQueue<DgNode *> Queue;
+        MarkQueue<DgNode *> Queue;
         Queue.InQueue(Node);
         do
         {
@@ -204,6 +200,13 @@ VOID MemLeak::CollectSinks()
             continue;
         }
 
+        /* the function of the sink may not be materialized yet */
+        if (m_DgGraph->IsLazy ())
+        {
+            m_DgGraph->WatchDgNode (Cs.getInstruction(), &m_SinkSet);
+            continue;
+        }
+
         DgNode *Node = m_DgGraph->GetDgNode (Cs.getInstruction());
         if (Node == NULL)
         {
@@ -218,11 +221,11 @@ VOID MemLeak::CollectSinks()
     
 
 
-VOID MemLeak::ReportBug(ProgramSlice *PgSlice, DgNode *Source)
+VOID MemLeak::ReportBug(DgNode *Source, DWORD Reach)
 { 
     string BugInfo = llvmAdpt::GetSourceLoc(Source->GetInst ());
     
-    switch (PgSlice->Reachability())
+    switch (Reach)
     {
         case REACH_NONE:
         {  
@@ -252,23 +255,254 @@ VOID MemLeak::ReportBug(ProgramSlice *PgSlice, DgNode *Source)
 }
 
 
+VOID MemLeak::ReportInconclusive (DgNode *Source, DWORD Budget, std::string &Info)
+{
+    static const CHAR *BudgetStat[] = {"", "BudgetTime", "BudgetNode", "BudgetPath", "BudgetTotal"};
+    string BugInfo = llvmAdpt::GetSourceLoc(Source->GetInst ());
+
+    printf ("%s memory allocation at : %s (%s)\r\n", WarnMsg("\t Inconclusive :").c_str(), BugInfo.c_str(), Info.c_str());
+    InsertCheckResult (BugInfo, REACH_INCONCLUSIVE);
+
+    Stat::IncStatNum (BudgetStat[Budget]);
+    m_BudgetNum++;
+    return;
+}
+
+VOID MemLeak::InitTask (T_SliceTask &Task, DgNode *Source)
+{
+    Task.m_Leak   = this;
+    Task.m_Source = Source;
+    Task.m_Reach  = REACH_NONE;
+    Task.m_Depth  = 0;
+    Task.m_Sinks  = (m_Batch != NULL) ? m_Batch->GetReachSinks (Source) : &m_SinkSet;
+    Task.m_Budget = BG_NONE;
+    Task.m_SumLookup = 0;
+    Task.m_SumHit    = 0;
+    return;
+}
+
+VOID MemLeak::ReportTask (T_SliceTask &Task)
+{
+    if (Task.m_Reach == REACH_INCONCLUSIVE)
+    {
+        ReportInconclusive (Task.m_Source, Task.m_Budget, Task.m_Info);
+    }
+    else
+    {
+        ReportBug (Task.m_Source, Task.m_Reach);
+    }
+
+    m_SumLookup += Task.m_SumLookup;
+    m_SumHit    += Task.m_SumHit;
+    return;
+}
+
+VOID* MemLeak::SliceTask (VOID *Arg)
+{
+    T_SliceTask *Task = (T_SliceTask *)Arg;
+    MemLeak *Leak = Task->m_Leak;
+
+    /* the sources left when the whole detection runs out of time are not sliced */
+    T_SliceBudget &Budget = Leak->m_Budget;
+    if (Budget.m_TotalMs != 0 && Stat::GetWallTime () - Budget.m_TotalStart > Budget.m_TotalMs)
+    {
+        Task->m_Reach  = REACH_INCONCLUSIVE;
+        Task->m_Budget = BG_TOTAL;
+        Task->m_Info   = "total budget, not sliced";
+        return NULL;
+    }
+
+    ProgramSlice PgSlice (Task->m_Source, Leak->m_DgGraph);
+    PgSlice.SetBudget (Leak->m_Budget);
+    PgSlice.SetFreeSum (Leak->m_FreeSum);
+    PgSlice.RunSlicing (*Task->m_Sinks);
+
+    Task->m_Reach  = PgSlice.Reachability ();
+    Task->m_Depth  = PgSlice.GetMaxDepth ();
+    Task->m_Budget = PgSlice.GetOverBudget ();
+    Task->m_SumLookup = PgSlice.GetSumLookup ();
+    Task->m_SumHit    = PgSlice.GetSumHit ();
+    if (Task->m_Budget != BG_NONE)
+    {
+        Task->m_Info = PgSlice.GetBudgetInfo ();
+    }
+    
+    return NULL;
+}
+
+VOID MemLeak::InitBudget ()
+{
+    m_Budget.m_TimeMs  = (DWORD)atoi (llaf::GetParaValue (PARA_SRC_TIME).c_str());
+    m_Budget.m_NodeNum = (DWORD)atoi (llaf::GetParaValue (PARA_SRC_NODES).c_str());
+    m_Budget.m_PathNum = (DWORD)atoi (llaf::GetParaValue (PARA_SRC_PATHS).c_str());
+    m_Budget.m_TotalMs = (DWORD)atoi (llaf::GetParaValue (PARA_TOTAL_TIME).c_str());
+
+    /* a slice running when the detection is out of time stops there */
+    m_Budget.m_TotalStart = Stat::GetWallTime ();
+    return;
+}
+
+DWORD MemLeak::RunSlicing (DWORD ThreadNum)
+{
+    std::vector<T_SliceTask> Tasks (m_SrcSet.size ());
+    
+    DWORD Index = 0;
+    for (auto it = m_SrcSet.begin(), end = m_SrcSet.end(); it != end; ++it, ++Index) 
+    {
+        InitTask (Tasks[Index], *it);
+    }
+
+    DWORD StartTime = Stat::GetWallTime ();
+    {
+        MultiTask Pool (ThreadNum);
+        for (auto it = Tasks.begin(), end = Tasks.end(); it != end; ++it)
+        {
+            if (IsPruned (it->m_Source))
+            {
+                continue;
+            }
+            
+            Pool.Submit (SliceTask, &(*it));
+        }
+        Pool.Wait ();
+    }
+    printf ("ProgramSlice: %u sources on %u threads, wall %u (ms)\r\n", 
+            (DWORD)Tasks.size (), ThreadNum, Stat::GetWallTime () - StartTime);
+
+    /* report in the order of the sequential run */
+    DWORD MaxDepth = 0;
+    for (auto it = Tasks.begin(), end = Tasks.end(); it != end; ++it)
+    {
+        ReportTask (*it);
+        MaxDepth = std::max (MaxDepth, it->m_Depth);
+    }
+    
+    return MaxDepth;
+}
+
+DWORD MemLeak::CheckFunction (const llvm::Function *Func, map<string, DWORD> &Result)
+{
+    /* the budgets of a new detection, the sources and the indexes are those of the run;
+       every source is sliced again, no verdict of the run is taken */
+    InitBudget ();
+
+    DWORD SrcNum = 0;
+    for (auto it = m_SrcSet.begin(), end = m_SrcSet.end(); it != end; ++it) 
+    {
+        DgNode *Source = *it;
+        if (Source->GetInst ()->getParent ()->getParent () != Func)
+        {
+            continue;
+        }
+
+        T_SliceTask Task;
+        InitTask (Task, Source);
+        if (!IsPruned (Task.m_Source))
+        {
+            SliceTask (&Task);
+        }
+
+        Result[llvmAdpt::GetSourceLoc (Source->GetInst ())] = Task.m_Reach;
+        SrcNum++;
+    }
+
+    return SrcNum;
+}
+
 DWORD MemLeak::RunDetector ()
 {
     /* 1. collect source and sinks */
     CollectSources();
     CollectSinks();
 
-    /* 2. start analysis by each source */
-    auto end = m_SrcSet.end();
-    for (auto it = m_SrcSet.begin(); it != end; ++it) 
+    /* 2. sources that reach no sink on the ddg are never free */
+    if (llaf::GetParaValue (PARA_DDG_REACH) == "1" && !m_DgGraph->IsLazy ())
     {
-        DgNode *Source = *it;
+        m_Reach = new DdgReach (m_DgGraph, &m_SinkSet);
+        m_Reach->PrintStat ();
+    }
+
+    /* free summaries of the formals, bottom-up once for all sources */
+    if (llaf::GetParaValue (PARA_FREE_SUM) == "1" && !m_DgGraph->IsLazy ())
+    {
+        std::string ThreadNum = llaf::GetParaValue (PARA_THREAD_NUM);
+        
+        m_FreeSum = new FreeSum (m_DgGraph, &m_SinkSet);
+        m_FreeSum->Build ((ThreadNum != "" && atoi (ThreadNum.c_str()) >= 1) ? (DWORD)atoi (ThreadNum.c_str()) : 1);
+        m_FreeSum->PrintStat ();
+    }
 
-        ProgramSlice PgSlice (Source, m_DgGraph);
-        PgSlice.RunSlicing(m_SinkSet);
+    /* many sources: the sinks of each are found by the bit-parallel sweeps first, 
+       a source is then only sliced against its own sinks */
+    std::string BatchPara = llaf::GetParaValue (PARA_FWD_BATCH);
+    DWORD BatchMin = (BatchPara != "") ? (DWORD)atoi (BatchPara.c_str()) : FB_MIN_SOURCES;
+    if (BatchMin != 0 && m_SrcSet.size () >= BatchMin && !m_DgGraph->IsLazy ())
+    {
+        m_Batch = new FwdBatch (m_DgGraph, &m_SinkSet);
+        m_Batch->Run (m_SrcSet);
+        m_Batch->PrintStat ();
+    }
+
+    /* 3. start analysis by each source */
+    Stat::StartTime ("ProgramSlice");
+    InitBudget ();
     
+    /* slicing only reads the graph once it is built, the lazy mode grows it on the way */
+    DWORD MaxDepth = 0;
+    std::string ThreadPara = llaf::GetParaValue (PARA_THREAD_NUM);
+    if (ThreadPara != "" && atoi (ThreadPara.c_str()) >= 1 && !m_DgGraph->IsLazy ())
+    {
+        MaxDepth = RunSlicing ((DWORD)atoi (ThreadPara.c_str()));
+    }
+    else
+    {
+        auto end = m_SrcSet.end();
+        for (auto it = m_SrcSet.begin(); it != end; ++it) 
+        {
+            T_SliceTask Task;
+            InitTask (Task, *it);
+            
+            if (!IsPruned (Task.m_Source))
+            {
+                SliceTask (&Task);
+            }
+            MaxDepth = std::max (MaxDepth, Task.m_Depth);
+
+            ReportTask (Task);
+        }
+    }
+    Stat::EndTime ("ProgramSlice");
+    if (m_BudgetNum != 0)
+    {
+        printf ("ProgramSlice: %u/%u sources inconclusive on budgets\r\n", m_BudgetNum, (DWORD)m_SrcSet.size ());
+        Stat::GetStatNum ("BudgetTime");
+        Stat::GetStatNum ("BudgetNode");
+        Stat::GetStatNum ("BudgetPath");
+        Stat::GetStatNum ("BudgetTotal");
+    }
+    printf ("ProgramSlice: max traversal depth %u nodes\r\n", MaxDepth);
+
+    if (m_Reach != NULL)
+    {
+        printf ("DdgReach: pruned %u/%u sources (%.1f%%)\r\n", m_PrunedNum, (DWORD)m_SrcSet.size (),
+                m_SrcSet.size () ? (m_PrunedNum * 100.0 / m_SrcSet.size ()) : 0.0);
+    }
 
-        ReportBug(&PgSlice, Source);
+    if (m_FreeSum != NULL)
+    {
+        printf ("FreeSum: %u/%u call site lookups answered by the summaries (%.1f%%)\r\n", m_SumHit, m_SumLookup,
+                m_SumLookup ? (m_SumHit * 100.0 / m_SumLookup) : 0.0);
+    }
+
+    if (m_Batch != NULL)
+    {
+        printf ("FwdBatch: %u/%u sources settled by the sweeps, %u sliced one by one\r\n", 
+                m_BatchPruned, (DWORD)m_SrcSet.size (), (DWORD)m_SrcSet.size () - m_BatchPruned - m_PrunedNum);
+    }
+
+    if (m_DgGraph->IsLazy ())
+    {
+        m_DgGraph->PrintLazyStat ();
     }
     
     return AF_SUCCESS;
@@ -45,7 +45,7 @@ VOID CallGraph::BuildCallGraph()
     {
         Function *Func = *ItF;
 
-        if (llvmAdpt::IsDebugFunction (Func->getName ()))
+        if (llvmAdpt::IsDebugFunction (Func))
         {
             continue;
         }
@@ -135,10 +135,20 @@ VOID CallGraph::LinkGraph()
     return;
 }
 
+/* the pts update of a function depends on the set of functions above it on the path only,
+   the same (node, context) reached again would repeat a whole subtree: merge it */
 VOID CallGraph::DFSNode (DgGraph *Dg, CallGraphNode *Node)
 {
+    if (!m_DfsCtx.insert (std::make_pair (Node, m_CtxHash)).second)
+    {
+        m_MergeNum++;
+        return;
+    }
+    
     m_DfsNode.insert(Node);
     m_NodeStack.push_back(Node->GetFunction ());
+    m_CtxStack.push_back(m_CtxHash);
+    m_CtxHash ^= GetCtxKey (Node);
 
     DWORD StackSize = m_NodeStack.size();
 
@@ -150,7 +160,7 @@ VOID CallGraph::DFSNode (DgGraph *Dg, CallGraphNode *Node)
             printf ("1-UpdatePtsByFs [%-6u]\r", m_PathCount);
         }
         
-        Dg->UpdatePtsByFs (m_NodeStack);
+        Dg->UpdatePtsByFs (m_NodeStack, m_CtxStack);
         #if 0
         printf ("[%u] path length = %u \r\n", m_PathCount, m_NodeStack.size());
         for (auto it = m_NodeStack.begin(); it != m_NodeStack.end(); it++)
@@ -186,6 +196,8 @@ VOID CallGraph::DFSNode (DgGraph *Dg, CallGraphNode *Node)
         }
     }
 
+    m_CtxHash ^= GetCtxKey (Node);
+    m_CtxStack.pop_back();
     m_NodeStack.pop_back();
     m_DfsNode.erase(Node);
 }
@@ -204,8 +216,9 @@ VOID CallGraph::UpdatePtsByFs(DgGraph *Dg)
     DFSNode (Dg, Node);
 
     m_DfsNode.clear();
+    m_DfsCtx.clear();
 
-    printf ("1-UpdatePtsByFs [%-6u] paths\r\n", m_PathCount);
+    printf ("1-UpdatePtsByFs [%-6u] paths, %u subtrees merged by context\r\n", m_PathCount, m_MergeNum);
     return;
 }
 
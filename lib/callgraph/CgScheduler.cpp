@@ -0,0 +1,295 @@
+//===- CgScheduler.cpp -- bottom-up SCC wavefront over the call graph ------//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <set>
+#include "callgraph/CgScheduler.h"
+#include "common/Stat.h"
+
+using namespace llvm;
+using namespace std;
+
+static inline bool CompareNodeId (CallGraphNode *A, CallGraphNode *B)
+{
+    return A->GetId () < B->GetId ();
+}
+
+VOID CgScheduler::GetCallee (CallGraphNode *Node, std::vector<CallGraphNode*> &Callee)
+{
+    for (auto It = Node->OutEdgeBegin (), End = Node->OutEdgeEnd (); It != End; It++)
+    {
+        CallGraphNode *DstNode = (*It)->GetDstNode ();
+        if (!DstNode->IsReachable () || DstNode->GetFunction ()->getInstructionCount () == 0)
+        {
+            continue;
+        }
+
+        Callee.push_back (DstNode);
+    }
+
+    return;
+}
+
+/* iterative tarjan: an SCC is closed only after every SCC it calls, so the
+   SCC ids are a bottom-up order */
+VOID CgScheduler::Condense ()
+{
+    struct Frame
+    {
+        CallGraphNode *m_Node;
+        std::vector<CallGraphNode*> m_Callee;
+        DWORD m_Next;
+    };
+
+    std::vector<CallGraphNode*> Roots;
+    for (auto GIt = m_CallGraph->begin (), End = m_CallGraph->end (); GIt != End; GIt++)
+    {
+        CallGraphNode *CgNode = GIt->second;
+        if (!CgNode->IsReachable () || CgNode->GetFunction ()->getInstructionCount () == 0)
+        {
+            continue;
+        }
+
+        Roots.push_back (CgNode);
+    }
+    std::sort (Roots.begin (), Roots.end (), CompareNodeId);
+
+    DenseMap<CallGraphNode*, DWORD> Index;
+    DenseMap<CallGraphNode*, DWORD> LowLink;
+    DenseMap<CallGraphNode*, DWORD> NodeToScc;
+    std::set<CallGraphNode*> OnStack;
+    std::vector<CallGraphNode*> Stack;
+    std::vector<std::vector<CallGraphNode*>> SccNodes;
+    std::vector<Frame> Dfs;
+    DWORD NextIndex = 0;
+
+    for (auto RIt = Roots.begin (), REnd = Roots.end (); RIt != REnd; RIt++)
+    {
+        if (Index.find (*RIt) != Index.end ())
+        {
+            continue;
+        }
+
+        Dfs.push_back (Frame ());
+        Dfs.back ().m_Node = *RIt;
+        Dfs.back ().m_Next = 0;
+        GetCallee (*RIt, Dfs.back ().m_Callee);
+        Index[*RIt] = LowLink[*RIt] = NextIndex++;
+        Stack.push_back (*RIt);
+        OnStack.insert (*RIt);
+
+        while (!Dfs.empty ())
+        {
+            Frame &Top = Dfs.back ();
+            CallGraphNode *Node = Top.m_Node;
+            if (Top.m_Next < Top.m_Callee.size ())
+            {
+                CallGraphNode *Callee = Top.m_Callee[Top.m_Next++];
+                
+                auto It = Index.find (Callee);
+                if (It == Index.end ())
+                {
+                    Dfs.push_back (Frame ());
+                    Dfs.back ().m_Node = Callee;
+                    Dfs.back ().m_Next = 0;
+                    GetCallee (Callee, Dfs.back ().m_Callee);
+                    Index[Callee] = LowLink[Callee] = NextIndex++;
+                    Stack.push_back (Callee);
+                    OnStack.insert (Callee);
+                }
+                else if (OnStack.find (Callee) != OnStack.end ())
+                {
+                    LowLink[Node] = std::min (LowLink[Node], It->second);
+                }
+                continue;
+            }
+
+            if (LowLink[Node] == Index[Node])
+            {
+                DWORD SccId = SccNodes.size ();
+                SccNodes.push_back (std::vector<CallGraphNode*> ());
+
+                CallGraphNode *Member;
+                do
+                {
+                    Member = Stack.back ();
+                    Stack.pop_back ();
+                    OnStack.erase (Member);
+
+                    NodeToScc[Member] = SccId;
+                    SccNodes[SccId].push_back (Member);
+                } while (Member != Node);
+            }
+
+            Dfs.pop_back ();
+            if (!Dfs.empty ())
+            {
+                CallGraphNode *Parent = Dfs.back ().m_Node;
+                LowLink[Parent] = std::min (LowLink[Parent], LowLink[Node]);
+            }
+        }
+    }
+
+    /* callers, callee counts and waves: the callees of an SCC have smaller ids */
+    m_Scc.resize (SccNodes.size ());
+    for (DWORD SccId = 0; SccId < SccNodes.size (); SccId++)
+    {
+        CgScc &Scc = m_Scc[SccId];
+        std::vector<CallGraphNode*> &Nodes = SccNodes[SccId];
+        std::sort (Nodes.begin (), Nodes.end (), CompareNodeId);
+
+        std::set<DWORD> CalleeScc;
+        for (auto NIt = Nodes.begin (), NEnd = Nodes.end (); NIt != NEnd; NIt++)
+        {
+            Scc.m_Funcs.push_back ((*NIt)->GetFunction ());
+
+            std::vector<CallGraphNode*> Callee;
+            GetCallee (*NIt, Callee);
+            for (auto CIt = Callee.begin (), CEnd = Callee.end (); CIt != CEnd; CIt++)
+            {
+                DWORD CalleeId = NodeToScc[*CIt];
+                if (CalleeId != SccId)
+                {
+                    CalleeScc.insert (CalleeId);
+                }
+            }
+        }
+
+        Scc.m_CalleeNum = CalleeScc.size ();
+        for (auto CIt = CalleeScc.begin (), CEnd = CalleeScc.end (); CIt != CEnd; CIt++)
+        {
+            m_Scc[*CIt].m_Callers.push_back (SccId);
+            Scc.m_Wave = std::max (Scc.m_Wave, m_Scc[*CIt].m_Wave + 1);
+        }
+
+        m_WaveNum = std::max (m_WaveNum, Scc.m_Wave + 1);
+    }
+
+    return;
+}
+
+VOID* CgScheduler::SccProc (VOID *Arg)
+{
+    std::pair<CgScheduler*, DWORD> *SccArg = (std::pair<CgScheduler*, DWORD> *)Arg;
+
+    SccArg->first->RunScc (SccArg->second);
+
+    return NULL;
+}
+
+VOID CgScheduler::RunScc (DWORD SccId)
+{
+    CgScc &Scc = m_Scc[SccId];
+
+    DWORD StartTime = Stat::GetWallTime ();
+    for (auto It = Scc.m_Funcs.begin (), End = Scc.m_Funcs.end (); It != End; It++)
+    {
+        m_Task (m_Ctx, *It);
+    }
+    Scc.m_Time = Stat::GetWallTime () - StartTime;
+
+    /* release the callers whose last callee SCC this is */
+    pthread_mutex_lock (&m_Mutex);
+    Scc.m_CpTime += Scc.m_Time;
+    for (auto It = Scc.m_Callers.begin (), End = Scc.m_Callers.end (); It != End; It++)
+    {
+        CgScc &Caller = m_Scc[*It];
+
+        Caller.m_CpTime = std::max (Caller.m_CpTime, Scc.m_CpTime);
+        if (--Caller.m_Pending == 0)
+        {
+            m_Pool->Submit (SccProc, &m_SccArg[*It]);
+        }
+    }
+    pthread_mutex_unlock (&m_Mutex);
+
+    return;
+}
+
+VOID CgScheduler::Run (std::string Phase, CgTask Task, VOID *Ctx, DWORD ThreadNum)
+{
+    DWORD StartTime = Stat::GetWallTime ();
+
+    m_Task = Task;
+    m_Ctx  = Ctx;
+    
+    m_SccArg.clear ();
+    for (DWORD SccId = 0; SccId < m_Scc.size (); SccId++)
+    {
+        CgScc &Scc = m_Scc[SccId];
+        Scc.m_Pending = Scc.m_CalleeNum;
+        Scc.m_Time    = 0;
+        Scc.m_CpTime  = 0;
+
+        m_SccArg.push_back (std::make_pair (this, SccId));
+    }
+
+    MultiTask Pool (ThreadNum);
+    m_Pool = &Pool;
+    
+    for (DWORD SccId = 0; SccId < m_Scc.size (); SccId++)
+    {
+        if (m_Scc[SccId].m_Pending == 0)
+        {
+            Pool.Submit (SccProc, &m_SccArg[SccId]);
+        }
+    }
+    Pool.Wait ();
+    
+    m_Pool = NULL;
+
+    PrintStat (Phase, ThreadNum, Stat::GetWallTime () - StartTime);
+    return;
+}
+
+VOID CgScheduler::PrintStat (std::string &Phase, DWORD ThreadNum, DWORD WallTime)
+{
+    std::vector<DWORD> WaveScc (m_WaveNum, 0);
+    std::vector<DWORD> WaveFunc (m_WaveNum, 0);
+    std::vector<DWORD> WaveTime (m_WaveNum, 0);
+
+    DWORD FuncNum   = 0;
+    DWORD WorkTime  = 0;
+    DWORD CpTime    = 0;
+    DWORD MaxWidth  = 0;
+    for (auto It = m_Scc.begin (), End = m_Scc.end (); It != End; It++)
+    {
+        WaveScc[It->m_Wave]++;
+        WaveFunc[It->m_Wave] += It->m_Funcs.size ();
+        WaveTime[It->m_Wave] += It->m_Time;
+
+        FuncNum  += It->m_Funcs.size ();
+        WorkTime += It->m_Time;
+        CpTime    = std::max (CpTime, It->m_CpTime);
+    }
+
+    printf ("Scheduler[%s]: %u functions in %u sccs, %u waves, %u threads\r\n", 
+            Phase.c_str(), FuncNum, (DWORD)m_Scc.size (), m_WaveNum, ThreadNum);
+    for (DWORD Wave = 0; Wave < m_WaveNum; Wave++)
+    {
+        printf ("\twave %-4u: %-6u sccs, %-6u functions, %u (ms)\r\n", 
+                Wave, WaveScc[Wave], WaveFunc[Wave], WaveTime[Wave]);
+        MaxWidth = std::max (MaxWidth, WaveScc[Wave]);
+    }
+
+    printf ("Scheduler[%s]: max width %u sccs, critical path %u waves / %u (ms) of %u (ms) work, wall %u (ms)\r\n",
+            Phase.c_str(), MaxWidth, m_WaveNum, CpTime, WorkTime, WallTime);
+    return;
+}
@@ -0,0 +1,402 @@
+//===- Checkpoint.cpp - phase checkpoints of a long run -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+#include <errno.h>
+#include "common/Checkpoint.h"
+#include "common/SoftPara.h"
+#include "common/Stat.h"
+
+using namespace std;
+
+ULONG Checkpoint::m_InputPrint = 0;
+string Checkpoint::m_StoreDir  = "";
+string Checkpoint::m_ResumeDir = "";
+
+static const CHAR *PhaseName[CK_PHASE_NUM] = {"load", "pts", "ddg"};
+
+string Checkpoint::GetPath (string &Dir, DWORD Phase)
+{
+    assert (Phase < CK_PHASE_NUM);
+    return Dir + "/" + PhaseName[Phase] + ".ckpt";
+}
+
+VOID Checkpoint::Init ()
+{
+    m_StoreDir  = llaf::GetParaValue (PARA_CHECKPOINT_DIR);
+    m_ResumeDir = llaf::GetParaValue (PARA_RESUME_FROM);
+
+    if (m_StoreDir != "" && mkdir (m_StoreDir.c_str (), 0755) != 0 && errno != EEXIST)
+    {
+        printf ("Checkpoint: create %s fail, errno = %d, no checkpoint is written\r\n", m_StoreDir.c_str (), errno);
+        m_StoreDir = "";
+    }
+
+    return;
+}
+
+VOID Checkpoint::SetInputs (const vector<string> &ModulePathVec, const string &DataFile)
+{
+    if (m_StoreDir == "" && m_ResumeDir == "")
+    {
+        return;
+    }
+
+    /* the settings that change what a phase computes */
+    const string Settings[] = {PARA_GLOBAL_HUB, PARA_LAZY_DDG, PARA_LAZY_LOAD, PARA_PIPELINE};
+
+    ULONG Hash = CK_HASH_INIT;
+    for (DWORD Index = 0; Index < sizeof (Settings) / sizeof (Settings[0]); Index++)
+    {
+        string Value = llaf::GetParaValue (Settings[Index]);
+        Hash = HashBytes (Hash, Value.c_str (), Value.size () + 1);
+    }
+
+    for (auto It = ModulePathVec.begin (), End = ModulePathVec.end (); It != End; It++)
+    {
+        Hash = HashBytes (Hash, It->c_str (), It->size () + 1);
+
+        struct stat St;
+        ULONG MTime = 0;
+        ULONG Size  = 0;
+        if (stat (It->c_str (), &St) == 0)
+        {
+            MTime = (ULONG)St.st_mtime;
+            Size  = (ULONG)St.st_size;
+        }
+        Hash = HashBytes (Hash, &MTime, sizeof (MTime));
+        Hash = HashBytes (Hash, &Size, sizeof (Size));
+    }
+
+    /* the class lists change the constraints, wherever the file is found */
+    FILE *F = fopen (DataFile.c_str (), "rb");
+    if (F != NULL)
+    {
+        CHAR Buf[4096];
+        size_t Len;
+        while ((Len = fread (Buf, 1, sizeof (Buf), F)) > 0)
+        {
+            Hash = HashBytes (Hash, Buf, Len);
+        }
+        fclose (F);
+    }
+    m_InputPrint = Hash;
+
+    if (m_ResumeDir == "")
+    {
+        return;
+    }
+
+    /* the latest phase a resumed run starts after */
+    INT Latest = -1;
+    for (DWORD Phase = 0; Phase < CK_PHASE_NUM; Phase++)
+    {
+        string Path = GetPath (m_ResumeDir, Phase);
+
+        CkHeader Hdr;
+        if (Phase == CK_DDG ? IsSnapStamped (m_ResumeDir) : ReadHeader (Path, Phase, Hdr))
+        {
+            Latest = Phase;
+        }
+    }
+
+    if (Latest < 0)
+    {
+        printf ("Checkpoint: no checkpoint of these inputs in %s, start over\r\n", m_ResumeDir.c_str ());
+    }
+    else
+    {
+        printf ("Checkpoint: resume after the %s phase from %s\r\n", PhaseName[Latest], m_ResumeDir.c_str ());
+    }
+
+    return;
+}
+
+string Checkpoint::GetStorePath (DWORD Phase)
+{
+    return (m_StoreDir != "") ? GetPath (m_StoreDir, Phase) : "";
+}
+
+string Checkpoint::GetResumePath (DWORD Phase)
+{
+    return (m_ResumeDir != "") ? GetPath (m_ResumeDir, Phase) : "";
+}
+
+string Checkpoint::GetSnapPath (string &Dir)
+{
+    return Dir + "/" + PhaseName[CK_DDG] + ".snap";
+}
+
+string Checkpoint::GetStoreSnap ()
+{
+    return (m_StoreDir != "") ? GetSnapPath (m_StoreDir) : "";
+}
+
+string Checkpoint::GetResumeSnap ()
+{
+    return (m_ResumeDir != "" && IsSnapStamped (m_ResumeDir)) ? GetSnapPath (m_ResumeDir) : "";
+}
+
+static BOOL GetSnapStat (string &Path, ULONG Stamp[2])
+{
+    struct stat St;
+    if (stat (Path.c_str (), &St) != 0)
+    {
+        return AF_FALSE;
+    }
+
+    Stamp[0] = (ULONG)St.st_size;
+    Stamp[1] = (ULONG)St.st_mtime;
+    return AF_TRUE;
+}
+
+/* written after the snapshot: a stamp of these inputs names the snapshot they produced */
+VOID Checkpoint::StampSnap ()
+{
+    string SnapPath = GetStoreSnap ();
+    
+    vector<ULONG> Stamp (2);
+    if (SnapPath == "" || !GetSnapStat (SnapPath, Stamp.data ()))
+    {
+        return;
+    }
+
+    vector<string> Sections (1);
+    PutArray (Sections[0], Stamp);
+    Store (CK_DDG, Sections);
+    return;
+}
+
+/* the stamp is of these inputs and the snapshot is still the one it was written for */
+BOOL Checkpoint::IsSnapStamped (string &Dir)
+{
+    string Path = GetPath (Dir, CK_DDG);
+    FILE *F = fopen (Path.c_str (), "rb");
+    if (F == NULL)
+    {
+        return AF_FALSE;
+    }
+
+    CkHeader Hdr;
+    DWORD Size = 0;
+    ULONG Stamp[2];
+    BOOL IsOk = (fread (&Hdr, sizeof (Hdr), 1, F) == 1 &&
+                 Hdr.Magic == CK_MAGIC && Hdr.Version == CK_VERSION && Hdr.Phase == CK_DDG && 
+                 Hdr.InputPrint == m_InputPrint && Hdr.SecNum == 1 &&
+                 fread (&Size, sizeof (Size), 1, F) == 1 && Size == sizeof (Stamp) &&
+                 fread (Stamp, sizeof (Stamp), 1, F) == 1);
+    fclose (F);
+
+    ULONG Cur[2];
+    string SnapPath = GetSnapPath (Dir);
+    return IsOk && GetSnapStat (SnapPath, Cur) && Cur[0] == Stamp[0] && Cur[1] == Stamp[1];
+}
+
+BOOL Checkpoint::ReadHeader (string &Path, DWORD Phase, CkHeader &Hdr)
+{
+    FILE *F = fopen (Path.c_str (), "rb");
+    if (F == NULL)
+    {
+        return AF_FALSE;
+    }
+
+    BOOL IsValid = (fread (&Hdr, sizeof (Hdr), 1, F) == 1 &&
+                    Hdr.Magic == CK_MAGIC && Hdr.Version == CK_VERSION &&
+                    Hdr.Phase == Phase && Hdr.InputPrint == m_InputPrint);
+    fclose (F);
+
+    return IsValid;
+}
+
+VOID Checkpoint::Report (const CHAR *Op, DWORD Phase, string &Path, DWORD Time)
+{
+    struct stat St;
+    DWORD Size = (stat (Path.c_str (), &St) == 0) ? (DWORD)(St.st_size / 1024) : 0;
+
+    printf ("Checkpoint: %s %s %s, %u (K), %u (ms)\r\n", Op, PhaseName[Phase], Path.c_str (), Size, Time);
+    return;
+}
+
+/* written aside and renamed, a run killed on the way leaves the old checkpoint */
+BOOL Checkpoint::Store (DWORD Phase, vector<string> &Sections)
+{
+    string Path = GetStorePath (Phase);
+    if (Path == "")
+    {
+        return AF_FALSE;
+    }
+
+    DWORD StartTime = Stat::GetWallTime ();
+
+    CkHeader Hdr;
+    memset (&Hdr, 0, sizeof (Hdr));
+    Hdr.Magic      = CK_MAGIC;
+    Hdr.Version    = CK_VERSION;
+    Hdr.Phase      = Phase;
+    Hdr.SecNum     = Sections.size ();
+    Hdr.InputPrint = m_InputPrint;
+
+    vector<DWORD> SecSize;
+    for (auto It = Sections.begin (), End = Sections.end (); It != End; It++)
+    {
+        while (It->size () % sizeof (DWORD))
+        {
+            It->push_back ('\0');
+        }
+        SecSize.push_back (It->size ());
+    }
+
+    string TmpPath = Path + ".tmp";
+    FILE *F = fopen (TmpPath.c_str (), "wb");
+    if (F == NULL)
+    {
+        printf ("Checkpoint: open %s fail\r\n", TmpPath.c_str ());
+        return AF_FALSE;
+    }
+
+    BOOL IsOk = (fwrite (&Hdr, sizeof (Hdr), 1, F) == 1);
+    IsOk = IsOk && (fwrite (SecSize.data (), sizeof (DWORD), SecSize.size (), F) == SecSize.size ());
+    for (auto It = Sections.begin (), End = Sections.end (); It != End && IsOk; It++)
+    {
+        IsOk = (fwrite (It->data (), 1, It->size (), F) == It->size ());
+    }
+    IsOk = (fclose (F) == 0) && IsOk;
+
+    if (!IsOk || rename (TmpPath.c_str (), Path.c_str ()) != 0)
+    {
+        printf ("Checkpoint: write %s fail\r\n", Path.c_str ());
+        unlink (TmpPath.c_str ());
+        return AF_FALSE;
+    }
+
+    Report ("write", Phase, Path, Stat::GetWallTime () - StartTime);
+    return AF_TRUE;
+}
+
+BOOL Checkpoint::Load (DWORD Phase, vector<string> &Sections)
+{
+    string Path = GetResumePath (Phase);
+    if (Path == "")
+    {
+        return AF_FALSE;
+    }
+
+    DWORD StartTime = Stat::GetWallTime ();
+
+    FILE *F = fopen (Path.c_str (), "rb");
+    if (F == NULL)
+    {
+        return AF_FALSE;
+    }
+
+    CkHeader Hdr;
+    BOOL IsOk = (fread (&Hdr, sizeof (Hdr), 1, F) == 1 &&
+                 Hdr.Magic == CK_MAGIC && Hdr.Version == CK_VERSION && Hdr.Phase == Phase && Hdr.SecNum <= CK_SECTION_MAX);
+    if (IsOk && Hdr.InputPrint != m_InputPrint)
+    {
+        printf ("Checkpoint: %s was written for other inputs or settings, recompute\r\n", Path.c_str ());
+        fclose (F);
+        return AF_FALSE;
+    }
+
+    vector<DWORD> SecSize (IsOk ? Hdr.SecNum : 0);
+    IsOk = IsOk && (fread (SecSize.data (), sizeof (DWORD), SecSize.size (), F) == SecSize.size ());
+
+    /* the sections of a truncated file are never allocated */
+    struct stat St;
+    ULONG Expect = sizeof (Hdr) + SecSize.size () * sizeof (DWORD);
+    for (auto It = SecSize.begin (), End = SecSize.end (); It != End; It++)
+    {
+        Expect += *It;
+    }
+    IsOk = IsOk && (fstat (fileno (F), &St) == 0) && (ULONG)St.st_size == Expect;
+
+    Sections.clear ();
+    Sections.resize (SecSize.size ());
+    for (DWORD Index = 0; Index < SecSize.size () && IsOk; Index++)
+    {
+        Sections[Index].resize (SecSize[Index]);
+        IsOk = (fread (&Sections[Index][0], 1, SecSize[Index], F) == SecSize[Index]);
+    }
+    fclose (F);
+
+    if (!IsOk)
+    {
+        printf ("Checkpoint: %s is corrupted, recompute\r\n", Path.c_str ());
+        Sections.clear ();
+        return AF_FALSE;
+    }
+
+    Report ("read", Phase, Path, Stat::GetWallTime () - StartTime);
+    return AF_TRUE;
+}
+
+VOID Checkpoint::StoreModules (const vector<string> &ModulePathVec)
+{
+    if (m_StoreDir == "")
+    {
+        return;
+    }
+
+    vector<string> Sections (1);
+    for (auto It = ModulePathVec.begin (), End = ModulePathVec.end (); It != End; It++)
+    {
+        Sections[0].append (It->c_str (), It->size () + 1);
+    }
+
+    Store (CK_LOAD, Sections);
+    return;
+}
+
+/* the module list of the resumed run, when no input is given */
+BOOL Checkpoint::LoadModules (vector<string> &ModulePathVec)
+{
+    string Path = llaf::GetParaValue (PARA_RESUME_FROM);
+    if (Path == "")
+    {
+        return AF_FALSE;
+    }
+    Path = GetPath (Path, CK_LOAD);
+
+    FILE *F = fopen (Path.c_str (), "rb");
+    if (F == NULL)
+    {
+        printf ("Checkpoint: no module list in %s\r\n", Path.c_str ());
+        return AF_FALSE;
+    }
+
+    /* the list is taken whatever the print: the phases after it check theirs */
+    CkHeader Hdr;
+    DWORD Size = 0;
+    struct stat St;
+    BOOL IsOk = (fread (&Hdr, sizeof (Hdr), 1, F) == 1 &&
+                 Hdr.Magic == CK_MAGIC && Hdr.Version == CK_VERSION && Hdr.Phase == CK_LOAD && Hdr.SecNum == 1 &&
+                 fread (&Size, sizeof (Size), 1, F) == 1);
+    IsOk = IsOk && (fstat (fileno (F), &St) == 0) && (ULONG)St.st_size == sizeof (Hdr) + sizeof (Size) + Size;
+
+    string Section (IsOk ? Size : 0, '\0');
+    IsOk = IsOk && (fread (&Section[0], 1, Size, F) == Size);
+    fclose (F);
+
+    if (!IsOk)
+    {
+        printf ("Checkpoint: %s is corrupted\r\n", Path.c_str ());
+        return AF_FALSE;
+    }
+
+    size_t Pos = 0;
+    while (Pos < Section.size () && Section[Pos] != '\0')
+    {
+        string ModulePath = Section.c_str () + Pos;
+        Pos += ModulePath.size () + 1;
+
+        ModulePathVec.push_back (ModulePath);
+    }
+
+    return !ModulePathVec.empty ();
+}
@@ -12,108 +12,121 @@
 
 using namespace std;
 
-VOID* TaskProc(VOID* Arg)
+MultiTask::MultiTask (DWORD TaskNum, TaskFunc T)
 {
-    Task *T = (Task *)Arg;
+    m_TaskNum = TaskNum;
+    assert (m_TaskNum != 0);
 
-    T->Run ();
+    m_Func    = T;
+    m_Pending = 0;
+    m_Exit    = AF_FALSE;
 
-    return NULL;
-}
+    pthread_mutex_init (&m_Mutex, NULL);
+    pthread_cond_init (&m_TaskCond, NULL);
+    pthread_cond_init (&m_DoneCond, NULL);
 
-Task::Task (TaskFunc *T)
-{
-    Func = T;
-    m_Status = INIT;
-    
-    int Ret = pthread_create(&m_Tid, NULL, TaskProc, this);
-    assert (Ret == 0);
+    m_Threads.resize (m_TaskNum);
+    for (DWORD Index = 0; Index < m_TaskNum; Index++)
+    {
+        int Ret = pthread_create(&m_Threads[Index], NULL, TaskProc, this);
+        assert (Ret == 0);
+    }
 }
 
-VOID Task::Run ()
+MultiTask::~MultiTask ()
 {
-    m_Status = RUNNING;
-    
-    while (m_Status != READY_EXIT || !Finish())
+    pthread_mutex_lock (&m_Mutex);
+    m_Exit = AF_TRUE;
+    pthread_cond_broadcast (&m_TaskCond);
+    pthread_mutex_unlock (&m_Mutex);
+
+    for (auto It = m_Threads.begin(), End = m_Threads.end(); It != End; It++)
     {
-        while (VOID *Data = PopData ())
-        {
-            printf("[thread:%-4lu]", m_Tid);
-            Func (Data);
-        }
+        pthread_join (*It, NULL);
     }
 
-    m_Status = EXITED;
+    pthread_cond_destroy (&m_DoneCond);
+    pthread_cond_destroy (&m_TaskCond);
+    pthread_mutex_destroy (&m_Mutex);
 }
 
-MultiTask::MultiTask (DWORD TaskNum, TaskFunc T)
+VOID* MultiTask::TaskProc (VOID *Arg)
 {
-    m_TaskNum = TaskNum;
-    assert (m_TaskNum != 0);
+    MultiTask *Mt = (MultiTask *)Arg;
 
-    DWORD Index = 0;
-    while (Index < TaskNum)
-    {
-        Task *Tk = new Task (T);
-        assert (Tk != NULL);
+    Mt->Loop ();
 
-        m_TaskAry.push_back(Tk);
-
-        Index++;
-    }
+    return NULL;
 }
 
-VOID MultiTask::Wait ()
+VOID MultiTask::Loop ()
 {
-    DWORD Index = 0;
-    DWORD ExitNum = 0;
-    
-    for (auto It = m_TaskAry.begin(), End = m_TaskAry.end(); It != End; It++)
-    {
-        Task *T = *It;
-
-        T->SetStatus (READY_EXIT);
-    }
-
+    pthread_mutex_lock (&m_Mutex);
     while (1)
     {
-        ExitNum = 0;
-        for (auto It = m_TaskAry.begin(), End = m_TaskAry.end(); It != End; It++)
+        while (m_TaskQueue.empty () && !m_Exit)
         {
-            Task *T = *It;
-
-            ExitNum += (DWORD)(T->GetStatus() == EXITED);
+            pthread_cond_wait (&m_TaskCond, &m_Mutex);
         }
 
-        if (ExitNum == m_TaskNum)
+        if (m_TaskQueue.empty ())
         {
             break;
-        }        
+        }
+
+        std::pair<TaskFunc*, VOID*> Task = m_TaskQueue.front ();
+        m_TaskQueue.pop ();
+        pthread_mutex_unlock (&m_Mutex);
+
+        Task.first (Task.second);
+
+        pthread_mutex_lock (&m_Mutex);
+        m_Pending--;
+        if (m_Pending == 0)
+        {
+            pthread_cond_broadcast (&m_DoneCond);
+        }
     }
+    pthread_mutex_unlock (&m_Mutex);
+
+    return;
 }
 
+VOID MultiTask::Submit (TaskFunc *Func, VOID *Arg)
+{
+    pthread_mutex_lock (&m_Mutex);
+    m_TaskQueue.push (std::make_pair (Func, Arg));
+    m_Pending++;
+    pthread_cond_signal (&m_TaskCond);
+    pthread_mutex_unlock (&m_Mutex);
+
+    return;
+}
+
+VOID MultiTask::Wait ()
+{
+    pthread_mutex_lock (&m_Mutex);
+    while (m_Pending != 0)
+    {
+        pthread_cond_wait (&m_DoneCond, &m_Mutex);
+    }
+    pthread_mutex_unlock (&m_Mutex);
+
+    return;
+}
 
 VOID MultiTask::Run (std::vector<VOID *> &DataSet)
 {
-    DWORD Index  = 0;
-    DWORD TaskNo;
+    assert (m_Func != NULL);
     
     for (auto It = DataSet.begin(), End = DataSet.end(); It != End; It++)
     {
-        TaskNo = Index++ % m_TaskNum;
-
-        Task *T = m_TaskAry[TaskNo];
-        assert (T != NULL);
-        
-        T->AddData (*It);
+        Submit (m_Func, *It);
     }
 
     Wait ();
 
-    printf ("DataNum = %d, TaskNum = %d: All tasks finished....\r\n", Index, m_TaskNum);
+    printf ("DataNum = %u, TaskNum = %u: All tasks finished....\r\n", (DWORD)DataSet.size (), m_TaskNum);
 
     return;
 }
-
-
-
@@ -17,6 +17,27 @@ VOID SoftPara::InitParaList()
     m_ParaToValue[PARA_CFG_DUMP] = "";
     m_ParaToValue[PARA_CFG_WEIGHT] = "";
     m_ParaToValue[PARA_DDG_DUMP] = "";
+    m_ParaToValue[PARA_DDG_SNAPSHOT] = "";
+    m_ParaToValue[PARA_DDG_INCREMENTAL] = "";
+    m_ParaToValue[PARA_LAZY_DDG] = "";
+    m_ParaToValue[PARA_GLOBAL_HUB] = "";
+    m_ParaToValue[PARA_THREAD_NUM] = "";
+    m_ParaToValue[PARA_DDG_REACH] = "";
+    m_ParaToValue[PARA_PATH_ENGINE] = "";
+    m_ParaToValue[PARA_SRC_TIME] = "";
+    m_ParaToValue[PARA_SRC_NODES] = "";
+    m_ParaToValue[PARA_SRC_PATHS] = "";
+    m_ParaToValue[PARA_TOTAL_TIME] = "";
+    m_ParaToValue[PARA_FWD_BATCH] = "";
+    m_ParaToValue[PARA_FREE_SUM] = "";
+    m_ParaToValue[PARA_CHECKERS] = "";
+    m_ParaToValue[PARA_FUNC_CLASS] = "";
+    m_ParaToValue[PARA_LOAD_THREAD] = "";
+    m_ParaToValue[PARA_LAZY_LOAD] = "";
+    m_ParaToValue[PARA_PIPELINE] = "";
+    m_ParaToValue[PARA_SERVER] = "";
+    m_ParaToValue[PARA_CHECKPOINT_DIR] = "";
+    m_ParaToValue[PARA_RESUME_FROM] = "";
 }
 
 
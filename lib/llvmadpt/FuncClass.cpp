@@ -0,0 +1,133 @@
+//===- FuncClass.cpp -- function classes interned once per module set ------//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+
+#include <stdlib.h>
+#include "llvmadpt/FuncClass.h"
+#include "common/SoftPara.h"
+
+using namespace std;
+using namespace llvm;
+
+struct T_ClassSection
+{
+    const char *m_Name;
+    DWORD m_Flag;
+};
+
+static const T_ClassSection Sections[] =
+{
+    {"ext_normal",  FF_NORMAL},
+    {"ext_malloc",  FF_MALLOC},
+    {"ext_realloc", FF_REALLOC},
+    {"ext_memcpy",  FF_MEMCPY},
+    {"ext_retarg0", FF_RETARG0},
+    {"ext_cast",    FF_CAST},
+    {"debug",       FF_DEBUG},
+    {"leak_source", FF_LEAK_SRC},
+    {"leak_sink",   FF_LEAK_SINK},
+};
+
+static DWORD GetSectionFlag (string &Name)
+{
+    DWORD Num = sizeof (Sections) / sizeof (Sections[0]);
+    for (DWORD Index = 0; Index < Num; Index++)
+    {
+        if (Name == Sections[Index].m_Name)
+        {
+            return Sections[Index].m_Flag;
+        }
+    }
+
+    return 0;
+}
+
+/* -func-class first, then $PCA_DATA_DIR, then the data directory of the source tree */
+string FuncClass::GetDataPath ()
+{
+    string Path = llaf::GetParaValue (PARA_FUNC_CLASS);
+    if (Path != "")
+    {
+        return Path;
+    }
+
+    const char *Dir = getenv ("PCA_DATA_DIR");
+    if (Dir != NULL && Dir[0] != 0)
+    {
+        return string (Dir) + "/" + FUNC_CLASS_FILE;
+    }
+
+    return string (PCA_DATA_DIR) + "/" + FUNC_CLASS_FILE;
+}
+
+VOID FuncClass::LoadNames (string Path)
+{
+    char Line[1024];
+
+    FILE *F = fopen (Path.c_str (), "r");
+    if (F == NULL)
+    {
+        printf("load function classes: %s failed\r\n", Path.c_str ());
+        exit(1);
+    }
+
+    DWORD Flag = 0;
+    DWORD LineNo = 0;
+    while (fgets (Line, sizeof (Line), F) != NULL)
+    {
+        LineNo++;
+
+        string Name = Line;
+        size_t End = Name.find_last_not_of (" \t\r\n");
+        if (End == string::npos || Name[0] == '#')
+        {
+            continue;
+        }
+        Name = Name.substr (0, End + 1);
+
+        if (Name[0] == '[')
+        {
+            string Section = Name.substr (1, Name.size () - 2);
+            Flag = GetSectionFlag (Section);
+            if (Flag == 0)
+            {
+                printf("load function classes: %s:%u unknown class [%s]\r\n", Path.c_str (), LineNo, Section.c_str ());
+                exit(1);
+            }
+            continue;
+        }
+
+        if (Flag == 0)
+        {
+            printf("load function classes: %s:%u %s is out of a class\r\n", Path.c_str (), LineNo, Name.c_str ());
+            exit(1);
+        }
+        m_NameFlags[Name] |= Flag;
+    }
+
+    fclose (F);
+    return;
+}
+
+VOID FuncClass::PrintStat ()
+{
+    printf("FuncClass: names = %u, functions = %u, build time = %u ms, lookup misses = %u\r\n",
+           (DWORD)m_NameFlags.size (), (DWORD)m_FuncFlags.size (), m_BuildTime, (DWORD)m_MissNum);
+    return;
+}
@@ -0,0 +1,366 @@
+//===- FuncModIndex.cpp -- mapped index from function names to modules -----//
+//
+// Copyright (C) <2019-2024>  <Wen Li>
+//
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/SourceMgr.h>
+#include "llvmadpt/FuncModIndex.h"
+#include "common/MultiTask.h"
+#include "common/Stat.h"
+
+using namespace std;
+using namespace llvm;
+
+/* the modules of one task, parsed without their bodies for the defined names */
+struct T_CollectTask
+{
+    const vector<string> *m_Paths;
+    vector<vector<string>> *m_Names;
+    vector<DWORD> m_Ids;
+};
+
+DWORD FuncModIndex::HashName (const CHAR *Name)
+{
+    DWORD Hash = 2166136261U;
+    while (*Name != 0)
+    {
+        Hash ^= (BYTE)*Name++;
+        Hash *= 16777619U;
+    }
+
+    return Hash;
+}
+
+BOOL FuncModIndex::Open (const CHAR *Path)
+{
+    Close ();
+
+    int Fd = open (Path, O_RDONLY);
+    if (Fd < 0)
+    {
+        return AF_FALSE;
+    }
+
+    struct stat St;
+    if (fstat (Fd, &St) != 0 || (size_t)St.st_size < sizeof(FmHeader))
+    {
+        close (Fd);
+        return AF_FALSE;
+    }
+
+    VOID *Base = mmap (NULL, St.st_size, PROT_READ, MAP_PRIVATE, Fd, 0);
+    close (Fd);
+    if (Base == MAP_FAILED)
+    {
+        return AF_FALSE;
+    }
+
+    m_Base = Base;
+    m_Size = St.st_size;
+    m_Hdr  = (const FmHeader *)Base;
+    if (!CheckLayout ())
+    {
+        printf ("FuncModIndex: %s is not a valid index, rerun with -pre=1\r\n", Path);
+        Close ();
+        return AF_FALSE;
+    }
+
+    return AF_TRUE;
+}
+
+VOID FuncModIndex::Close ()
+{
+    if (m_Base != NULL)
+    {
+        munmap (m_Base, m_Size);
+        m_Base = NULL;
+        m_Hdr  = NULL;
+    }
+
+    return;
+}
+
+BOOL FuncModIndex::CheckLayout ()
+{
+    const FmHeader *Hdr = m_Hdr;
+    if (Hdr->Magic != FM_INDEX_MAGIC || Hdr->Version != FM_INDEX_VERSION || Hdr->BucketNum == 0)
+    {
+        return AF_FALSE;
+    }
+
+    size_t Expect = sizeof(FmHeader) +
+                    (size_t)Hdr->ModNum * sizeof(FmModule) +
+                    (size_t)Hdr->BucketNum * sizeof(DWORD) +
+                    (size_t)Hdr->FuncNum * sizeof(FmEntry) + Hdr->StrSize;
+    if (Expect != m_Size)
+    {
+        return AF_FALSE;
+    }
+
+    m_Modules = (const FmModule *)(Hdr + 1);
+    m_Buckets = (const DWORD *)(m_Modules + Hdr->ModNum);
+    m_Entries = (const FmEntry *)(m_Buckets + Hdr->BucketNum);
+    m_StrTab  = (const CHAR *)(m_Entries + Hdr->FuncNum);
+
+    /* every offset lands in the table, and the table ends a string */
+    if ((Hdr->BucketNum & (Hdr->BucketNum - 1)) != 0 || (Hdr->StrSize != 0 && m_StrTab[Hdr->StrSize - 1] != '\0'))
+    {
+        return AF_FALSE;
+    }
+
+    for (DWORD Id = 0; Id < Hdr->ModNum; Id++)
+    {
+        const FmModule *Mod = &m_Modules[Id];
+        if (Mod->PathOff >= Hdr->StrSize || Mod->FuncBegin > Hdr->FuncNum || Mod->FuncNum > Hdr->FuncNum - Mod->FuncBegin)
+        {
+            return AF_FALSE;
+        }
+    }
+
+    for (DWORD Index = 0; Index < Hdr->BucketNum; Index++)
+    {
+        if (m_Buckets[Index] != FM_INDEX_NONE && m_Buckets[Index] >= Hdr->FuncNum)
+        {
+            return AF_FALSE;
+        }
+    }
+
+    /* a chain only goes to entries added before, so it ends */
+    for (DWORD Index = 0; Index < Hdr->FuncNum; Index++)
+    {
+        const FmEntry *Entry = &m_Entries[Index];
+        if (Entry->NameOff >= Hdr->StrSize || Entry->ModId >= Hdr->ModNum ||
+            (Entry->Next != FM_INDEX_NONE && Entry->Next >= Index))
+        {
+            return AF_FALSE;
+        }
+    }
+
+    return AF_TRUE;
+}
+
+string FuncModIndex::GetModulePath (const string &FuncName) const
+{
+    if (m_Hdr == NULL)
+    {
+        return "";
+    }
+
+    DWORD Hash = HashName (FuncName.c_str ());
+    DWORD Index = m_Buckets[Hash & (m_Hdr->BucketNum - 1)];
+    while (Index != FM_INDEX_NONE)
+    {
+        const FmEntry *Entry = &m_Entries[Index];
+        if (Entry->Hash == Hash && FuncName == &m_StrTab[Entry->NameOff])
+        {
+            return &m_StrTab[m_Modules[Entry->ModId].PathOff];
+        }
+
+        Index = Entry->Next;
+    }
+
+    return "";
+}
+
+VOID* FuncModIndex::CollectTask (VOID *Arg)
+{
+    T_CollectTask *Task = (T_CollectTask*)Arg;
+    LLVMContext Ctx;
+
+    for (auto It = Task->m_Ids.begin (), End = Task->m_Ids.end (); It != End; It++)
+    {
+        SMDiagnostic Err;
+        const string &Path = (*Task->m_Paths)[*It];
+
+        unique_ptr<Module> Mod = getLazyIRFileModule (Path, Err, Ctx);
+        if (!Mod)
+        {
+            printf("load module: %s failed\n",  Path.c_str());
+            continue;
+        }
+
+        vector<string> &Names = (*Task->m_Names)[*It];
+        for (Module::iterator Fit = Mod->begin(), End = Mod->end(); Fit != End; ++Fit)
+        {
+            /* a local function is never the definition of a declaration elsewhere */
+            if (Fit->isDeclaration () || Fit->hasLocalLinkage ())
+            {
+                continue;
+            }
+
+            Names.push_back (Fit->getName().str());
+        }
+    }
+
+    return NULL;
+}
+
+VOID FuncModIndex::Build (const vector<string> &ModulePaths, DWORD ThreadNum, const CHAR *Path)
+{
+    DWORD StartTime = Stat::GetWallTime ();
+    DWORD ModNum = ModulePaths.size ();
+
+    /* modules of the open index by path */
+    map<string, DWORD> OldModules;
+    if (m_Hdr != NULL)
+    {
+        for (DWORD Id = 0; Id < m_Hdr->ModNum; Id++)
+        {
+            OldModules[&m_StrTab[m_Modules[Id].PathOff]] = Id;
+        }
+    }
+
+    vector<vector<string>> Names (ModNum);
+    vector<FmModule> Modules (ModNum);
+    vector<DWORD> Changed;
+    for (DWORD Id = 0; Id < ModNum; Id++)
+    {
+        FmModule &Mod = Modules[Id];
+        memset (&Mod, 0, sizeof (Mod));
+
+        struct stat St;
+        if (stat (ModulePaths[Id].c_str (), &St) == 0)
+        {
+            Mod.MTime = (ULONG)St.st_mtime;
+            Mod.Size  = (ULONG)St.st_size;
+        }
+
+        auto It = OldModules.find (ModulePaths[Id]);
+        if (It == OldModules.end () || Mod.MTime == 0 ||
+            m_Modules[It->second].MTime != Mod.MTime || m_Modules[It->second].Size != Mod.Size)
+        {
+            Changed.push_back (Id);
+            continue;
+        }
+
+        const FmModule &Old = m_Modules[It->second];
+        for (DWORD Index = Old.FuncBegin; Index < Old.FuncBegin + Old.FuncNum; Index++)
+        {
+            Names[Id].push_back (&m_StrTab[m_Entries[Index].NameOff]);
+        }
+    }
+
+    /* the changed modules in parallel, one context per task */
+    ThreadNum = std::max (1U, std::min (ThreadNum, (DWORD)Changed.size ()));
+    vector<T_CollectTask> Tasks (ThreadNum);
+    for (DWORD Index = 0; Index < Changed.size (); Index++)
+    {
+        Tasks[Index % ThreadNum].m_Ids.push_back (Changed[Index]);
+    }
+
+    if (!Changed.empty ())
+    {
+        MultiTask Pool (ThreadNum);
+        for (auto It = Tasks.begin (), End = Tasks.end (); It != End; It++)
+        {
+            It->m_Paths = &ModulePaths;
+            It->m_Names = &Names;
+            Pool.Submit (CollectTask, &(*It));
+        }
+        Pool.Wait ();
+    }
+
+    /* a module that failed to load, or defines nothing, is parsed again next time */
+    for (auto It = Changed.begin (), End = Changed.end (); It != End; It++)
+    {
+        if (Names[*It].empty ())
+        {
+            Modules[*It].MTime = 0;
+        }
+    }
+
+    /* the sections in module order */
+    string StrTab;
+    vector<FmEntry> Entries;
+    for (DWORD Id = 0; Id < ModNum; Id++)
+    {
+        FmModule &Mod = Modules[Id];
+        Mod.PathOff   = StrTab.size ();
+        StrTab.append (ModulePaths[Id].c_str (), ModulePaths[Id].size () + 1);
+
+        Mod.FuncBegin = Entries.size ();
+        Mod.FuncNum   = Names[Id].size ();
+        for (auto It = Names[Id].begin (), End = Names[Id].end (); It != End; It++)
+        {
+            FmEntry Entry;
+            Entry.Hash    = HashName (It->c_str ());
+            Entry.NameOff = StrTab.size ();
+            Entry.ModId   = Id;
+            Entry.Next    = FM_INDEX_NONE;
+            StrTab.append (It->c_str (), It->size () + 1);
+
+            Entries.push_back (Entry);
+        }
+    }
+
+    DWORD BucketNum = 1;
+    while (BucketNum < Entries.size () * 2)
+    {
+        BucketNum <<= 1;
+    }
+
+    /* pushed at the head: the last module of a name comes first */
+    vector<DWORD> Buckets (BucketNum, FM_INDEX_NONE);
+    for (DWORD Index = 0; Index < Entries.size (); Index++)
+    {
+        DWORD &Head = Buckets[Entries[Index].Hash & (BucketNum - 1)];
+        Entries[Index].Next = Head;
+        Head = Index;
+    }
+
+    FmHeader Hdr;
+    Hdr.Magic     = FM_INDEX_MAGIC;
+    Hdr.Version   = FM_INDEX_VERSION;
+    Hdr.ModNum    = ModNum;
+    Hdr.FuncNum   = Entries.size ();
+    Hdr.BucketNum = BucketNum;
+    Hdr.StrSize   = StrTab.size ();
+
+    /* the old index stays mapped until the new one is in place */
+    string TmpPath = string (Path) + ".tmp";
+    FILE *F = fopen (TmpPath.c_str (), "wb");
+    if (F == NULL)
+    {
+        printf ("FuncModIndex: open %s fail\r\n", TmpPath.c_str ());
+        return;
+    }
+
+    fwrite (&Hdr, sizeof(Hdr), 1, F);
+    fwrite (Modules.data(), sizeof(FmModule), Modules.size(), F);
+    fwrite (Buckets.data(), sizeof(DWORD), Buckets.size(), F);
+    fwrite (Entries.data(), sizeof(FmEntry), Entries.size(), F);
+    fwrite (StrTab.data(), 1, StrTab.size(), F);
+    fclose (F);
+
+    Close ();
+    rename (TmpPath.c_str (), Path);
+    Open (Path);
+
+    printf ("FuncModIndex: %u modules (%u parsed, %u reused), %u functions, wall %u (ms)\r\n",
+            ModNum, (DWORD)Changed.size (), ModNum - (DWORD)Changed.size (), Hdr.FuncNum,
+            Stat::GetWallTime () - StartTime);
+    return;
+}
@@ -165,12 +165,9 @@ VOID  InstAnalyzer::GetPDefUseInfo(std::set<llvm::Value*> *ValueSet)
                 SetPUse (Du, Puse);
                 if (!IsActualPara (Puse))
                 {
-                    for (auto It = m_ElemSet.begin(); It != m_ElemSet.end(); It++)
+                    for (auto It = ElemBaseBegin (&m_ElemSet, Puse); 
+                         It != m_ElemSet.end() && It->Base == Puse; It++)
                     {
-                        if (It->Base != Puse)
-                        {
-                            continue;
-                        }
                         Du->SetUse (It->DefVal, true);
                     }
                 }
@@ -204,6 +201,40 @@ VOID  InstAnalyzer::GetPDefUseInfo(std::set<llvm::Value*> *ValueSet)
     return;
 }
 
+/* the values GetPDefUseInfo adds to ValueSet, without updating the def-use */
+VOID  InstAnalyzer::CollectDefs(std::set<llvm::Value*> *ValueSet)
+{
+    m_ValueSet  = ValueSet;
+        
+    for (inst_iterator iIt = inst_begin(m_Function), iEnd = inst_end(m_Function); iIt != iEnd; ++iIt) 
+    {
+        Instruction *Inst = &(*iIt);
+
+        if (llvmAdpt::IsInstrinsicDbgInst(Inst))
+        {
+            continue;
+        }
+
+        switch (Inst->getOpcode()) 
+        {
+            case Instruction::Store:
+            case Instruction::Br:
+            case Instruction::Ret:
+            {
+                continue;
+            }
+            default:
+            {
+                break;
+            }
+        }
+
+        CollectDefOfInst(Inst);
+    }
+
+    return;
+}
+
 
 
 VOID InstAnalyzer::ProcInst (llvm::Instruction* Inst, DefUse* Du)
@@ -25,7 +25,12 @@
 #include <llvm/IRReader/IRReader.h>	
 #include <llvm/Support/FileSystem.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InstIterator.h>
 #include "llvmadpt/ModuleSet.h"
+#include "common/MultiTask.h"
+#include "common/BoundQueue.h"
+#include "common/Stat.h"
+#include "common/Checkpoint.h"
 
 using namespace std;
 using namespace llvm;
@@ -204,6 +209,13 @@ ModuleSet *ModuleManage::m_ModuleSet = NULL;
 ModuleSet::ModuleSet(const vector<string> &ModulePathVec)
 {
     m_ModuleNum = 0;
+    m_CtxNum    = 0;
+
+    m_IsLazy      = (llaf::GetParaValue (PARA_LAZY_LOAD) == "1");
+    m_BodyNum     = 0;
+    m_MaterialNum = 0;
+    m_Hook        = NULL;
+    m_HookCtx     = NULL;
     
     m_LlvmCtx   = NULL;
     m_Modules   = NULL;
@@ -217,6 +229,13 @@ ModuleSet::ModuleSet(const vector<string> &ModulePathVec)
 ModuleSet::ModuleSet(llvm::Module &Mod) 
 {
     m_ModuleNum = 1;
+    m_CtxNum    = 0;
+
+    m_IsLazy      = AF_FALSE;
+    m_BodyNum     = 0;
+    m_MaterialNum = 0;
+    m_Hook        = NULL;
+    m_HookCtx     = NULL;
     m_EntryFunc = NULL;
     
     m_LlvmCtx = &(Mod.getContext());
@@ -229,9 +248,173 @@ ModuleSet::ModuleSet(llvm::Module &Mod)
     InitModuleSet();
 }
 
+/* the functions a constant refers to, global variables are seeded by their initializers */
+static VOID GetRefFuncs (Constant *C, std::set<Constant*> &Visited, std::vector<Function*> &Funcs)
+{
+    if (isa<GlobalVariable>(C) || !Visited.insert (C).second)
+    {
+        return;
+    }
+
+    if (Function *Func = dyn_cast<Function>(C))
+    {
+        Funcs.push_back (Func);
+        return;
+    }
+
+    for (auto It = C->op_begin (), End = C->op_end (); It != End; It++)
+    {
+        if (Constant *Op = dyn_cast<Constant>(*It))
+        {
+            GetRefFuncs (Op, Visited, Funcs);
+        }
+    }
+
+    return;
+}
+
+/*
+   a body is materialized when main reaches it through direct calls or takes its
+   address, the address-taken functions cover the indirect calls. a declaration
+   is resolved by name to the definition of another module. the bodies never
+   reached are dropped, so they are declarations to the rest of the analysis.
+*/
+VOID ModuleSet::MaterializeReachable ()
+{
+    std::map<std::string, Function*> NameToDef;
+    std::vector<Function*> WorkList;
+    std::set<Constant*> Visited;
+    std::set<Function*> Reached;
+    BOOL HasEntry = AF_FALSE;
+
+    DWORD StartTime = Stat::GetWallTime ();
+    for (DWORD Id = 0; Id < m_ModuleNum; ++Id) 
+    {
+        llvm::Module *M = m_Modules[Id].get();
+        for (Module::iterator it = M->begin(), eit = M->end(); it != eit; ++it) 
+        {
+            Function *Func = &*it;
+            if (Func->isDeclaration ())
+            {
+                continue;
+            }
+
+            m_BodyNum++;
+            if (!Func->hasLocalLinkage ())
+            {
+                NameToDef[Func->getName().str()] = Func;
+            }
+
+            if (IsEntryFunction (Func))
+            {
+                WorkList.push_back (Func);
+                HasEntry = AF_TRUE;
+            }
+        }
+
+        for (Module::global_iterator it = M->global_begin(), eit = M->global_end(); it != eit; ++it) 
+        {
+            if (it->hasInitializer ())
+            {
+                GetRefFuncs (it->getInitializer (), Visited, WorkList);
+            }
+        }
+    }
+
+    /* no entry: every body may be needed */
+    if (!HasEntry)
+    {
+        for (DWORD Id = 0; Id < m_ModuleNum; ++Id) 
+        {
+            for (Module::iterator it = m_Modules[Id]->begin(), eit = m_Modules[Id]->end(); it != eit; ++it) 
+            {
+                WorkList.push_back (&*it);
+            }
+        }
+    }
+
+    while (!WorkList.empty ())
+    {
+        Function *Func = WorkList.back ();
+        WorkList.pop_back ();
+
+        if (Func->isDeclaration ())
+        {
+            auto It = NameToDef.find (Func->getName().str());
+            if (It == NameToDef.end ())
+            {
+                continue;
+            }
+            Func = It->second;
+        }
+
+        if (!Reached.insert (Func).second)
+        {
+            continue;
+        }
+
+        if (Func->isMaterializable ())
+        {
+            if (Error Err = Func->materialize ())
+            {
+                printf("materialize function: %s failed\n",  Func->getName().data());
+                exit(0);
+            }
+        }
+        m_MaterialNum++;
+
+        for (inst_iterator ItI = inst_begin(*Func), Ed = inst_end(*Func); ItI != Ed; ++ItI) 
+        {
+            Instruction *Inst = &*ItI;
+            for (auto It = Inst->op_begin (), End = Inst->op_end (); It != End; It++)
+            {
+                if (Constant *Op = dyn_cast<Constant>(*It))
+                {
+                    GetRefFuncs (Op, Visited, WorkList);
+                }
+            }
+        }
+    }
+
+    for (DWORD Id = 0; Id < m_ModuleNum; ++Id) 
+    {
+        llvm::Module *M = m_Modules[Id].get();
+        for (Module::iterator it = M->begin(), eit = M->end(); it != eit; ++it) 
+        {
+            if (it->isMaterializable ())
+            {
+                it->deleteBody ();
+            }
+        }
+    }
+
+    printf("LazyLoad: %u/%u bodies materialized, wall %u (ms), peak memory %u (K)\r\n",
+           m_MaterialNum, m_BodyNum, Stat::GetWallTime () - StartTime, Stat::GetPeakMemUse ());
+    return;
+}
+
 VOID ModuleSet::InitModuleSet ()
 {
     llvm::Function *Func;
+
+    /* the modules on demand first, the lazy bodies are then materialized over all of them */
+    for (DWORD Id = 0; Id < m_ModuleNum; ++Id) 
+    {
+        llvm::Module *M = m_Modules[Id].get();
+        for (Module::iterator it = M->begin(), eit = M->end(); it != eit; ++it) 
+        {
+            Func = &*it;
+            if (Func->isDeclaration ())
+            {
+                LoadModuleOnDemand(Func->getName().data());
+            }
+        }
+    }
+
+    if (m_IsLazy)
+    {
+        MaterializeReachable ();
+    }
     
     for (DWORD Id = 0; Id < m_ModuleNum; ++Id) 
     {
@@ -245,11 +428,6 @@ VOID ModuleSet::InitModuleSet ()
             {
                 //continue;
             }
-
-            if (Func->isDeclaration ())
-            {
-                LoadModuleOnDemand(Func->getName().data());
-            }
             
             m_FuncSet.AddFunction( Func);
 
@@ -266,14 +444,33 @@ VOID ModuleSet::InitModuleSet ()
         }
     }
 
-    m_FuncSet.BuildFuncMap();   
+    m_FuncSet.BuildFuncMap();
+
+    m_FuncClass.Build (m_FuncSet.begin(), m_FuncSet.end());
 }
 
-void ModuleSet::loadOneModule(string &ModulePath, DWORD Id)
+/* distinct ids on distinct contexts may be parsed concurrently */
+VOID ModuleSet::ParseModule (const string &ModulePath, DWORD Id, LLVMContext &Ctx)
 {
     SMDiagnostic Err;
 
-    m_Modules[Id] = parseIRFile(ModulePath, Err, m_LlvmCtx[0]);
+    DWORD StartTime = Stat::GetWallTime ();
+    if (m_IsLazy)
+    {
+        m_Modules[Id] = getLazyIRFileModule(ModulePath, Err, Ctx);
+    }
+    else
+    {
+        m_Modules[Id] = parseIRFile(ModulePath, Err, Ctx);
+    }
+    m_LoadTime[Id] = Stat::GetWallTime () - StartTime;
+
+    return;
+}
+
+void ModuleSet::loadOneModule(string &ModulePath, DWORD Id)
+{
+    ParseModule (ModulePath, Id, m_LlvmCtx[0]);
     if (!m_Modules[Id]) 
     {
         printf("load module: %s failed\n",  ModulePath.c_str());
@@ -285,94 +482,229 @@ void ModuleSet::loadOneModule(string &ModulePath, DWORD Id)
     return;
 }
 
-VOID ModuleSet::loadModules(const vector<string> &ModulePathVec) 
+/* the modules of one context, parsed in id order by one task */
+struct T_LoadTask
 {
-    DWORD Ret;
-    DWORD Id = 0;
+    ModuleSet *m_Set;
+    LLVMContext *m_Ctx;
+    std::vector<DWORD> m_Ids;
+    BoundQueue<DWORD> *m_Queue;   /* pipeline: the parsed ids handed to the consumer */
+};
 
-    m_ModulePathVec = ModulePathVec;
-    
-    m_ModuleNum = ModulePathVec.size();
-    assert (m_ModuleNum != 0);
+VOID* ModuleSet::LoadTask (VOID *Arg)
+{
+    T_LoadTask *Task = (T_LoadTask*)Arg;
+    ModuleSet *Set = Task->m_Set;
 
-    m_LlvmCtx = new LLVMContext[1];
-    m_Modules = new unique_ptr<Module>[m_ModuleNum+MAX_MODULE_NUM];
+    for (auto It = Task->m_Ids.begin (), End = Task->m_Ids.end (); It != End; It++)
+    {
+        Set->ParseModule (Set->m_ModulePathVec[*It], *It, *Task->m_Ctx);
+
+        /* the context is not parsed into again while the consumer reads the module */
+        if (Task->m_Queue != NULL)
+        {
+            Task->m_Queue->Push (*It);
+            Task->m_Queue->WaitEmpty ();
+        }
+    }
+
+    return NULL;
+}
 
-    for (vector<string>::const_iterator it = ModulePathVec.begin(), end = ModulePathVec.end();
-         it != end; it++)
+/*
+   an LLVMContext is not thread safe and a module can not move to another one,
+   so each task parses its modules into a context of its own. the ids are fixed
+   by the path order before the tasks start, the modules on demand go to
+   context 0 as in the sequential load.
+*/
+VOID ModuleSet::loadParallel (DWORD CtxNum)
+{
+    std::vector<T_LoadTask> Tasks (CtxNum);
+    for (DWORD Index = 0; Index < CtxNum; Index++)
     {
-        string ModulePath = *it;
-        loadOneModule (ModulePath, Id);
-        Id++;
-        printf("---> Load Module:[%-2d/%-2d]\r", Id, m_ModuleNum);
+        Tasks[Index].m_Set   = this;
+        Tasks[Index].m_Ctx   = &m_LlvmCtx[Index];
+        Tasks[Index].m_Queue = (m_Hook != NULL) ? new BoundQueue<DWORD> (1) : NULL;
     }
-    printf("\n");
 
-    if (llaf::GetParaValue (PARA_PREPROFESS) == "1")
+    for (DWORD Id = 0; Id < m_ModuleNum; Id++)
     {
-        PreProcess ();
+        Tasks[Id % CtxNum].m_Ids.push_back (Id);
     }
-    else
+
+    MultiTask Pool (CtxNum);
+    for (auto It = Tasks.begin (), End = Tasks.end (); It != End; It++)
     {
-        InitModuleSet();        
+        Pool.Submit (LoadTask, &(*It));
+    }
+
+    if (m_Hook != NULL)
+    {
+        ConsumeModules (Tasks);
+    }
+    Pool.Wait ();
+
+    for (DWORD Id = 0; Id < m_ModuleNum; Id++)
+    {
+        if (!m_Modules[Id]) 
+        {
+            printf("load module: %s failed\n",  m_ModulePathVec[Id].c_str());
+            exit(0);
+        }
+
+        m_IdToName[Id] = m_ModulePathVec[Id];
+        printf("---> Load Module:[%-2d/%-2d] %u (ms) %s\r\n", Id+1, m_ModuleNum, m_LoadTime[Id], m_ModulePathVec[Id].c_str());
+    }
+
+    for (auto It = Tasks.begin (), End = Tasks.end (); It != End; It++)
+    {
+        delete It->m_Queue;
     }
 
     return;
 }
 
-VOID ModuleSet::PreProcess ()
+/*
+   module i is parsed by task i % N in id order, so it is the head of that
+   queue when the consumer asks for it: the hook sees the modules in id order
+   while the other tasks keep parsing. busy and idle are summed per stage.
+*/
+VOID ModuleSet::ConsumeModules (std::vector<T_LoadTask> &Tasks)
 {
-    llvm::Function *Func;
+    DWORD TaskNum = Tasks.size ();
+    DWORD HookTime = 0;
+    DWORD StartTime = Stat::GetWallTime ();
 
-    FILE *f = fopen (FUNC_MODULE, "w");
-    if (f == NULL)
+    for (DWORD Id = 0; Id < m_ModuleNum; Id++)
     {
-        return;
+        BoundQueue<DWORD> *Queue = Tasks[Id % TaskNum].m_Queue;
+
+        DWORD Head = Queue->Front ();
+        assert (Head == Id);
+        if (!m_Modules[Id]) 
+        {
+            printf("load module: %s failed\n",  m_ModulePathVec[Id].c_str());
+            exit(0);
+        }
+
+        DWORD HookStart = Stat::GetWallTime ();
+        m_Hook (m_HookCtx, m_Modules[Id].get());
+        HookTime += Stat::GetWallTime () - HookStart;
+
+        Queue->Pop ();
     }
 
-    printf("Start preprocessing....\r\n ");
-    for (DWORD Id = 0; Id < m_ModuleNum; ++Id) 
+    DWORD ParseBusy = 0, ParseIdle = 0, HookIdle = 0;
+    for (DWORD Id = 0; Id < m_ModuleNum; Id++)
     {
-        printf("preprocess module:%-4d\r ", Id);
-        llvm::Module *M = m_Modules[Id].get();
-        for (Module::iterator it = M->begin(), eit = M->end(); it != eit; ++it) 
-        {  
-            Func = &*it;
-            if (Func->isDeclaration ())
-            {
-                continue;
-            }
-            fprintf (f, "%s %s \r\n", Func->getName().data (), m_IdToName[Id].c_str());          
-        }
+        ParseBusy += m_LoadTime[Id];
+    }
+    for (auto It = Tasks.begin (), End = Tasks.end (); It != End; It++)
+    {
+        ParseIdle += It->m_Queue->GetPushWait ();
+        HookIdle  += It->m_Queue->GetPopWait ();
     }
-    printf("Finish preprocessing....\r\n ");
-    fclose(f);
 
+    printf("Pipeline: parse on %u tasks busy %u idle %u (ms), module hook busy %u idle %u (ms), wall %u (ms)\r\n",
+           TaskNum, ParseBusy, ParseIdle, HookTime, HookIdle, Stat::GetWallTime () - StartTime);
     return;
 }
 
+VOID ModuleSet::LoadModules (const vector<string> &ModulePathVec, ModuleHook Hook, VOID *HookCtx)
+{
+    assert (m_ModuleNum == 0 && "modules loaded twice?");
 
-VOID ModuleSet::InitFmMap()
+    m_Hook    = Hook;
+    m_HookCtx = HookCtx;
+    m_IsLazy  = AF_FALSE;
+
+    InitFmMap();
+    m_FuncClass.Init ();
+    
+    loadModules(ModulePathVec);
+
+    m_Hook    = NULL;
+    m_HookCtx = NULL;
+    return;
+}
+
+static DWORD GetLoadThreadNum ()
 {
-    char FuncName[1024];
-    char ModuleName[1024];
+    std::string ThreadPara = llaf::GetParaValue (PARA_LOAD_THREAD);
+    return (ThreadPara != "" && atoi (ThreadPara.c_str()) > 1) ? (DWORD)atoi (ThreadPara.c_str()) : 1;
+}
+
+VOID ModuleSet::loadModules(const vector<string> &ModulePathVec) 
+{
+    DWORD Id = 0;
+
+    m_ModulePathVec = ModulePathVec;
     
-    FILE *f = fopen (FUNC_MODULE, "r");
-    if (f == NULL)
+    m_ModuleNum = ModulePathVec.size();
+    assert (m_ModuleNum != 0);
+
+    /* the index only needs the defined names, no module is kept */
+    if (llaf::GetParaValue (PARA_PREPROFESS) == "1")
     {
+        PreProcess ();
         return;
     }
 
-    while (!feof(f))
+    /* the pipeline overlaps the hook with parsing on at least one other context,
+       one context is not thread safe. the contexts do not change the results:
+       field elements are keyed by the value of a constant offset, not by its
+       llvm::Value (see GetElemOffset) */
+    m_CtxNum = GetLoadThreadNum ();
+    if (m_Hook != NULL)
+    {
+        m_CtxNum = std::max (m_CtxNum, (DWORD)PIPELINE_MIN_CTX);
+    }
+    m_CtxNum = std::min (m_CtxNum, m_ModuleNum);
+
+    m_LlvmCtx = new LLVMContext[m_CtxNum];
+    m_Modules = new unique_ptr<Module>[m_ModuleNum+MAX_MODULE_NUM];
+    m_LoadTime.resize (m_ModuleNum+MAX_MODULE_NUM, 0);
+
+    DWORD StartTime = Stat::GetWallTime ();
+    if (m_CtxNum > 1 || m_Hook != NULL)
     {
-        if (fscanf(f, "%s %s", FuncName, ModuleName) < 2)
+        loadParallel (m_CtxNum);
+    }
+    else
+    {
+        for (vector<string>::const_iterator it = ModulePathVec.begin(), end = ModulePathVec.end();
+             it != end; it++)
         {
-            break;
+            string ModulePath = *it;
+            loadOneModule (ModulePath, Id);
+            Id++;
+            printf("---> Load Module:[%-2d/%-2d] %u (ms) %s\r\n", Id, m_ModuleNum, m_LoadTime[Id-1], ModulePath.c_str());
         }
-        
-        m_FuncToModule[FuncName] = ModuleName;
-    } 
+    }
+    printf("LoadModules: %u modules on %u contexts, wall %u (ms)\r\n", 
+           m_ModuleNum, m_CtxNum, Stat::GetWallTime () - StartTime);
+
+    InitModuleSet();        
+
+    /* the checkpoints are of the modules actually loaded */
+    Checkpoint::SetInputs (m_ModulePathVec, m_FuncClass.GetDataFile ());
+    return;
+}
+
+VOID ModuleSet::PreProcess ()
+{
+    printf("Start preprocessing....\r\n ");
+    m_FmIndex.Build (m_ModulePathVec, GetLoadThreadNum (), FUNC_MODULE);
+    printf("Finish preprocessing....\r\n ");
+
+    m_ModuleNum = 0;
+    return;
+}
+
 
+VOID ModuleSet::InitFmMap()
+{
+    m_FmIndex.Open (FUNC_MODULE);
     return;
 }
 
@@ -396,13 +728,7 @@ BOOL ModuleSet::IsModuleExist(std::string ModulePath)
 
 string ModuleSet::GetModulePathByFname(string FuncName)
 {
-    auto it = m_FuncToModule.find(FuncName);
-    if (it == m_FuncToModule.end())
-    {
-        return "";
-    } 
-
-    return it->second;
+    return m_FmIndex.GetModulePath (FuncName);
 }
 
 
@@ -420,8 +746,8 @@ VOID ModuleSet::LoadModuleOnDemand (string FuncName)
         return;
     }
 
-    printf("LoadModuleOnDemand:[%d]%s \r\n", m_ModuleNum+1, ModulePath.c_str());
     loadOneModule (ModulePath, m_ModuleNum);
+    printf("LoadModuleOnDemand:[%d] %u (ms) %s \r\n", m_ModuleNum+1, m_LoadTime[m_ModuleNum], ModulePath.c_str());
     m_ModuleNum++;
 
     m_ModulePathVec.push_back(ModulePath);
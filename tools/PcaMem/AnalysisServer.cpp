@@ -0,0 +1,475 @@
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include "AnalysisServer.h"
+#include "llvmadpt/LlvmAdpt.h"
+#include "common/Stat.h"
+
+
+using namespace llvm;
+
+
+static const char *ReachName[] = {"NeverFree", "Partial Free", "Free", "Inconclusive"};
+
+std::string AnalysisServer::GetFileName (StringRef Path)
+{
+    size_t Pos = Path.rfind ('/');
+    if (Pos == StringRef::npos)
+    {
+        return Path.str ();
+    }
+
+    return Path.substr (Pos + 1).str ();
+}
+
+std::string AnalysisServer::GetValueDesc (Value *Val)
+{
+    std::string Name = Val->hasName () ? Val->getName ().str () : "<unnamed>";
+
+    if (isa<GlobalValue>(Val))
+    {
+        return "@" + Name;
+    }
+
+    if (Instruction *Inst = dyn_cast<Instruction>(Val))
+    {
+        std::string Loc = llvmAdpt::GetSourceLoc (Inst);
+        return "%" + Name + " in " + Inst->getParent ()->getParent ()->getName ().str () +
+               ((Loc != "") ? " (" + Loc + ")" : "");
+    }
+
+    if (Argument *Arg = dyn_cast<Argument>(Val))
+    {
+        return "%" + Name + " arg of " + Arg->getParent ()->getName ().str ();
+    }
+
+    return Name;
+}
+
+VOID AnalysisServer::IndexLocations (ModuleManage &ModMng)
+{
+    DWORD StartTime = Stat::GetWallTime ();
+    DWORD FuncNum = 0;
+
+    for (auto Fit = ModMng.func_begin (), End = ModMng.func_end (); Fit != End; Fit++)
+    {
+        Function *Func = *Fit;
+        FuncNum++;
+
+        for (inst_iterator It = inst_begin(*Func), Ie = inst_end(*Func); It != Ie; ++It)
+        {
+            Instruction *Inst = &*It;
+
+            MDNode *MdNode = Inst->getMetadata ("dbg");
+            if (MdNode == NULL)
+            {
+                continue;
+            }
+
+            DILocation *Loc = cast<DILocation>(MdNode);
+            std::string Key = GetFileName (Loc->getFilename ()) + ":" + std::to_string (Loc->getLine ());
+            m_LocToInst[Key].push_back (Inst);
+        }
+    }
+
+    printf ("AnalysisServer: %u locations of %u functions indexed, wall %u (ms)\r\n",
+            (DWORD)m_LocToInst.size (), FuncNum, Stat::GetWallTime () - StartTime);
+    return;
+}
+
+BOOL AnalysisServer::Start (std::string Path)
+{
+    struct sockaddr_un Addr;
+    if (Path.size () >= sizeof (Addr.sun_path))
+    {
+        printf ("AnalysisServer: socket path %s is too long\r\n", Path.c_str ());
+        return AF_FALSE;
+    }
+
+    m_Listen = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (m_Listen < 0)
+    {
+        printf ("AnalysisServer: socket fail, errno = %d\r\n", errno);
+        return AF_FALSE;
+    }
+
+    memset (&Addr, 0, sizeof (Addr));
+    Addr.sun_family = AF_UNIX;
+    strncpy (Addr.sun_path, Path.c_str (), sizeof (Addr.sun_path) - 1);
+
+    /* a socket left by a server that did not stop */
+    unlink (Path.c_str ());
+    if (bind (m_Listen, (struct sockaddr *)&Addr, sizeof (Addr)) != 0 || listen (m_Listen, 8) != 0)
+    {
+        printf ("AnalysisServer: listen on %s fail, errno = %d\r\n", Path.c_str (), errno);
+        close (m_Listen);
+        m_Listen = -1;
+        return AF_FALSE;
+    }
+
+    m_Path = Path;
+    printf ("AnalysisServer: listening on %s\r\n", Path.c_str ());
+    return AF_TRUE;
+}
+
+VOID AnalysisServer::Stop ()
+{
+    if (m_Listen >= 0)
+    {
+        close (m_Listen);
+        unlink (m_Path.c_str ());
+        m_Listen = -1;
+    }
+
+    return;
+}
+
+/* one connection at a time: the graph is only read by one request */
+VOID AnalysisServer::Run ()
+{
+    while (!m_Stop && m_Listen >= 0)
+    {
+        int Conn = accept (m_Listen, NULL, NULL);
+        if (Conn < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            printf ("AnalysisServer: accept fail, errno = %d\r\n", errno);
+            break;
+        }
+
+        Serve (Conn);
+        close (Conn);
+    }
+
+    printf ("AnalysisServer: stopped, %u requests, avg %lu (us), max %lu (us)\r\n",
+            m_QueryNum, m_QueryNum ? m_QueryTime / m_QueryNum : 0, m_MaxTime);
+    Stop ();
+    return;
+}
+
+BOOL AnalysisServer::SendAll (int Conn, const std::string &Data)
+{
+    size_t Sent = 0;
+    while (Sent < Data.size ())
+    {
+        /* a peer that went away must fail the send, not raise SIGPIPE */
+        ssize_t Len = send (Conn, Data.data () + Sent, Data.size () - Sent, MSG_NOSIGNAL);
+        if (Len <= 0)
+        {
+            if (Len < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            return AF_FALSE;
+        }
+
+        Sent += Len;
+    }
+
+    return AF_TRUE;
+}
+
+VOID AnalysisServer::Serve (int Conn)
+{
+    std::string Buffer;
+    char Data[SERVER_LINE_MAX];
+
+    while (!m_Stop)
+    {
+        size_t Pos = Buffer.find ('\n');
+        if (Pos == std::string::npos)
+        {
+            if (Buffer.size () > SERVER_LINE_MAX)
+            {
+                SendAll (Conn, "ERR request too long\n");
+                return;
+            }
+
+            ssize_t Len = read (Conn, Data, sizeof (Data));
+            if (Len < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else if (Len <= 0)
+            {
+                return;
+            }
+
+            Buffer.append (Data, Len);
+            continue;
+        }
+
+        std::string Request = Buffer.substr (0, Pos);
+        Buffer.erase (0, Pos + 1);
+        if (!Request.empty () && Request[Request.size () - 1] == '\r')
+        {
+            Request.erase (Request.size () - 1);
+        }
+
+        if (Request == "")
+        {
+            continue;
+        }
+        else if (Request == "quit")
+        {
+            return;
+        }
+        else if (Request == "shutdown")
+        {
+            SendAll (Conn, "OK 0\n");
+            m_Stop = AF_TRUE;
+            return;
+        }
+
+        ULONG StartTime = Stat::GetWallTimeUs ();
+        std::string Reply;
+        BOOL Ret = Dispatch (Request, Reply);
+        ULONG Latency = Stat::GetWallTimeUs () - StartTime;
+
+        m_QueryNum++;
+        m_QueryTime += Latency;
+        m_MaxTime = std::max (m_MaxTime, Latency);
+        printf ("---> Request[%u]: %s, %s %lu (us)\r\n", m_QueryNum, Request.c_str (), Ret ? "ok" : "err", Latency);
+
+        if (Ret)
+        {
+            Reply += "OK " + std::to_string (Latency) + "\n";
+        }
+        else
+        {
+            Reply = "ERR " + Reply + "\n";
+        }
+
+        if (!SendAll (Conn, Reply))
+        {
+            return;
+        }
+    }
+
+    return;
+}
+
+BOOL AnalysisServer::Dispatch (std::string &Request, std::string &Reply)
+{
+    std::string Cmd = Request;
+    std::string Arg = "";
+
+    size_t Pos = Request.find (' ');
+    if (Pos != std::string::npos)
+    {
+        Cmd = Request.substr (0, Pos);
+
+        Pos = Request.find_first_not_of (' ', Pos);
+        if (Pos != std::string::npos)
+        {
+            Arg = Request.substr (Pos);
+        }
+    }
+
+    if (Cmd == "pts")
+    {
+        return QueryPts (Arg, Reply);
+    }
+    else if (Cmd == "leak")
+    {
+        return QueryLeak (Arg, Reply);
+    }
+    else if (Cmd == "slice")
+    {
+        return QuerySlice (Arg, Reply);
+    }
+    else if (Cmd == "stat")
+    {
+        QueryStat (Reply);
+        return AF_TRUE;
+    }
+
+    Reply = "unknown request: " + Cmd;
+    return AF_FALSE;
+}
+
+AnalysisServer::T_InstVec* AnalysisServer::GetLocInsts (std::string Loc, std::string &Reply)
+{
+    size_t Pos = Loc.rfind (':');
+    if (Pos == std::string::npos || Pos == 0 || Pos + 1 == Loc.size ())
+    {
+        Reply = "location is not <file>:<line>: " + Loc;
+        return NULL;
+    }
+
+    /* the file is matched by name, as the debug info may keep another directory */
+    std::string Key = GetFileName (Loc.substr (0, Pos)) + ":" + std::to_string (atoi (Loc.substr (Pos + 1).c_str ()));
+    auto It = m_LocToInst.find (Key);
+    if (It == m_LocToInst.end ())
+    {
+        Reply = "no instruction at " + Key;
+        return NULL;
+    }
+
+    return &It->second;
+}
+
+BOOL AnalysisServer::QueryPts (std::string &Arg, std::string &Reply)
+{
+    T_InstVec *Insts = GetLocInsts (Arg, Reply);
+    if (Insts == NULL)
+    {
+        return AF_FALSE;
+    }
+
+    /* the pointers the instructions define or access */
+    std::vector<Value *> Ptrs;
+    std::set<Value *> Seen;
+    for (auto It = Insts->begin (), End = Insts->end (); It != End; It++)
+    {
+        Instruction *Inst = *It;
+
+        Value *Candidates[3] = {NULL, NULL, NULL};
+        if (Inst->getType ()->isPointerTy ())
+        {
+            Candidates[0] = Inst;
+        }
+
+        if (LoadInst *Load = dyn_cast<LoadInst>(Inst))
+        {
+            Candidates[1] = Load->getPointerOperand ();
+        }
+        else if (StoreInst *Store = dyn_cast<StoreInst>(Inst))
+        {
+            Candidates[1] = Store->getPointerOperand ();
+            if (Store->getValueOperand ()->getType ()->isPointerTy ())
+            {
+                Candidates[2] = Store->getValueOperand ();
+            }
+        }
+
+        for (DWORD Index = 0; Index < 3; Index++)
+        {
+            if (Candidates[Index] != NULL && Seen.insert (Candidates[Index]).second)
+            {
+                Ptrs.push_back (Candidates[Index]);
+            }
+        }
+    }
+
+    for (auto It = Ptrs.begin (), End = Ptrs.end (); It != End; It++)
+    {
+        std::vector<Value *> PtsTo;
+        llvmAdpt::GetPtsTo (*It, PtsTo);
+
+        Reply += GetValueDesc (*It) + " -> {";
+        for (DWORD Index = 0; Index < PtsTo.size (); Index++)
+        {
+            Reply += ((Index != 0) ? ", " : "") + GetValueDesc (PtsTo[Index]);
+        }
+        Reply += "}\n";
+    }
+
+    Reply += std::to_string (Ptrs.size ()) + " pointers\n";
+    return AF_TRUE;
+}
+
+BOOL AnalysisServer::QueryLeak (std::string &Arg, std::string &Reply)
+{
+    if (m_MemLeak == NULL)
+    {
+        Reply = "the memleak checker is not in the run";
+        return AF_FALSE;
+    }
+
+    ModuleManage ModMng;
+    Function *Func = ModMng.GetFunction (Arg);
+    if (Func == NULL || Func->isDeclaration ())
+    {
+        Reply = "no definition of function " + Arg;
+        return AF_FALSE;
+    }
+
+    map<string, DWORD> Result;
+    DWORD SrcNum = m_MemLeak->CheckFunction (Func, Result);
+    for (auto It = Result.begin (), End = Result.end (); It != End; It++)
+    {
+        assert (It->second <= REACH_INCONCLUSIVE);
+        Reply += std::string (ReachName[It->second]) + ": " + It->first + "\n";
+    }
+
+    Reply += std::to_string (SrcNum) + " sources in " + Arg + "\n";
+    return AF_TRUE;
+}
+
+BOOL AnalysisServer::QuerySlice (std::string &Arg, std::string &Reply)
+{
+    T_InstVec *Insts = GetLocInsts (Arg, Reply);
+    if (Insts == NULL)
+    {
+        return AF_FALSE;
+    }
+
+    std::set<DgNode *> Visited;
+    std::vector<DgNode *> Queue;
+    for (auto It = Insts->begin (), End = Insts->end (); It != End; It++)
+    {
+        DgNode *Node = m_Dg->RequireDgNode (*It);
+        if (Node != NULL && Visited.insert (Node).second)
+        {
+            Queue.push_back (Node);
+        }
+    }
+
+    /* the forward data dependence closure, in the order reached */
+    std::vector<std::string> Locs;
+    std::set<std::string> LocSet;
+    for (DWORD Head = 0; Head < Queue.size (); Head++)
+    {
+        DgNode *Node = Queue[Head];
+        m_Dg->ExpandNode (Node);
+
+        if (Node->GetInst () != NULL)
+        {
+            std::string Loc = llvmAdpt::GetSourceLoc (Node->GetInst ());
+            if (Loc != "" && LocSet.insert (Loc).second)
+            {
+                Locs.push_back (Loc);
+            }
+        }
+
+        for (DgEdge *Edge : Node->OutEdges<EA_DD> ())
+        {
+            DgNode *DstNode = Edge->GetDstNode ();
+            if (Visited.insert (DstNode).second)
+            {
+                Queue.push_back (DstNode);
+            }
+        }
+    }
+
+    for (DWORD Index = 0; Index < Locs.size () && Index < SERVER_SLICE_MAX; Index++)
+    {
+        Reply += Locs[Index] + "\n";
+    }
+    if (Locs.size () > SERVER_SLICE_MAX)
+    {
+        Reply += "... " + std::to_string (Locs.size () - SERVER_SLICE_MAX) + " more\n";
+    }
+
+    Reply += std::to_string (Queue.size ()) + " nodes, " + std::to_string (Locs.size ()) + " source lines\n";
+    return AF_TRUE;
+}
+
+VOID AnalysisServer::QueryStat (std::string &Reply)
+{
+    Reply += "requests: " + std::to_string (m_QueryNum) +
+             ", avg " + std::to_string (m_QueryNum ? m_QueryTime / m_QueryNum : 0) + " (us)" +
+             ", max " + std::to_string (m_MaxTime) + " (us)\n";
+    Reply += "ddg nodes: " + std::to_string (m_Dg->GetNodeNum ()) +
+             ", memory: " + std::to_string (Stat::GetPhyMemUse ()) + " (K)\n";
+    return;
+}
@@ -0,0 +1,81 @@
+#ifndef _ANALYSISSERVER_H_
+#define _ANALYSISSERVER_H_
+
+#include <llvm/IR/Instructions.h>
+#include "app/leakdetect/MemLeak.h"
+#include "llvmadpt/ModuleSet.h"
+
+#define SERVER_LINE_MAX     (4096)
+#define SERVER_SLICE_MAX    (256)    /* source lines listed of a slice */
+
+/*
+   the modules, the points-to results and the dependence graph of one run stay
+   resident and the requests are answered on a unix domain socket. a request is
+   one line, its reply some lines and then "OK <us>" or "ERR <reason>":
+     pts <file>:<line>      points-to of the pointers at the location
+     leak <function>        leak check of the sources in the function
+     slice <file>:<line>    forward ddg slice from the location
+     stat                   requests answered and their latency
+     quit                   close the connection
+     shutdown               stop the server
+*/
+class AnalysisServer
+{
+private:
+    typedef std::vector<llvm::Instruction*> T_InstVec;
+
+    DgGraph *m_Dg;
+    MemLeak *m_MemLeak;
+
+    std::string m_Path;
+    int m_Listen;
+    BOOL m_Stop;
+
+    /* "<file name>:<line>" to the instructions there, built once */
+    std::map<std::string, T_InstVec> m_LocToInst;
+
+    DWORD m_QueryNum;
+    ULONG m_QueryTime;
+    ULONG m_MaxTime;
+
+public:
+    AnalysisServer (ModuleManage &ModMng, DgGraph *Dg, MemLeak *Leak)
+    {
+        m_Dg      = Dg;
+        m_MemLeak = Leak;
+        m_Listen  = -1;
+        m_Stop    = AF_FALSE;
+
+        m_QueryNum  = 0;
+        m_QueryTime = 0;
+        m_MaxTime   = 0;
+
+        IndexLocations (ModMng);
+    }
+
+    ~AnalysisServer ()
+    {
+        Stop ();
+    }
+
+    BOOL Start (std::string Path);
+    VOID Run ();
+
+private:
+    VOID Stop ();
+    VOID IndexLocations (ModuleManage &ModMng);
+    VOID Serve (int Conn);
+    BOOL Dispatch (std::string &Request, std::string &Reply);
+
+    T_InstVec* GetLocInsts (std::string Loc, std::string &Reply);
+    BOOL QueryPts (std::string &Arg, std::string &Reply);
+    BOOL QueryLeak (std::string &Arg, std::string &Reply);
+    BOOL QuerySlice (std::string &Arg, std::string &Reply);
+    VOID QueryStat (std::string &Reply);
+
+    static std::string GetFileName (llvm::StringRef Path);
+    static std::string GetValueDesc (llvm::Value *Val);
+    static BOOL SendAll (int Conn, const std::string &Data);
+};
+
+#endif
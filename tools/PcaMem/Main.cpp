@@ -16,9 +16,11 @@
 #include <llvm/IR/DataLayout.h>
 #include "llvmadpt/ModuleSet.h"
 #include "MemCheck.h"
+#include "AnalysisServer.h"
 #include "common/Bitmap.h"
 #include "common/SoftPara.h"
 #include "common/Stat.h"
+#include "common/Checkpoint.h"
 
 
 
@@ -40,6 +42,69 @@ MemLeakTest("memleak-cases automatically test", cl::desc("<memleak-cases automat
 
 static llvm::cl::opt<string> DumpDfg("dump-DDG", cl::init("0"), cl::desc("Dump dot graph of DDG"));
 
+static llvm::cl::opt<string> DdgSnapshot("ddg-snapshot", cl::init(""), 
+                                         cl::desc("DDG snapshot: reused when it matches the input, written otherwise"), cl::value_desc("path"));
+
+static llvm::cl::opt<string> DdgIncremental("ddg-incremental", cl::init(""), 
+                                            cl::desc("with -ddg-snapshot, rebuild only the functions changed since the snapshot: 1 or verify"), cl::value_desc("mode"));
+
+static llvm::cl::opt<string> LazyDdg("lazy-ddg", cl::init(""), 
+                                     cl::desc("build the cfg/ddg of a function when slicing first enters it: 1, or verify against an eager build"), cl::value_desc("mode"));
+
+static llvm::cl::opt<string> GlobalHub("global-hub", cl::init(""), 
+                                       cl::desc("route global def-use through one hub node per global"), cl::value_desc("0/1"));
+
+static llvm::cl::opt<string> ThreadNum("thread-num", cl::init(""), 
+                                       cl::desc("threads of the intra ddg and slicing phases"), cl::value_desc("number"));
+
+static llvm::cl::opt<string> DdgReachIdx("ddg-reach", cl::init(""), 
+                                         cl::desc("skip the sources that reach no sink on the ddg reachability index"), cl::value_desc("0/1"));
+
+static llvm::cl::opt<string> PathEngine("path-engine", cl::init(""), 
+                                        cl::desc("all-path reachability: cfg path dfs, must-free dataflow, or both compared"), cl::value_desc("dfs/dataflow/compare"));
+
+static llvm::cl::opt<string> SrcTime("src-time", cl::init(""), 
+                                     cl::desc("slicing time budget of one source"), cl::value_desc("ms"));
+
+static llvm::cl::opt<string> SrcNodes("src-nodes", cl::init(""), 
+                                      cl::desc("node visit budget of one source"), cl::value_desc("number"));
+
+static llvm::cl::opt<string> SrcPaths("src-paths", cl::init(""), 
+                                      cl::desc("completed cfg path budget of one source"), cl::value_desc("number"));
+
+static llvm::cl::opt<string> TotalTime("total-time", cl::init(""), 
+                                       cl::desc("slicing time budget of all sources, the rest are inconclusive"), cl::value_desc("ms"));
+
+static llvm::cl::opt<string> FwdBatchMin("fwd-batch", cl::init(""), 
+                                         cl::desc("min sources for the bit-parallel forward sweeps, 0 to disable"), cl::value_desc("number"));
+
+static llvm::cl::opt<string> FreeSumOpt("free-sum", cl::init(""), 
+                                        cl::desc("consult bottom-up callee free summaries at the call sites"), cl::value_desc("0/1"));
+
+static llvm::cl::opt<string> Checkers("checkers", cl::init(""), 
+                                      cl::desc("checkers to run on the one dependence graph"), cl::value_desc("memleak,..."));
+
+static llvm::cl::opt<string> FuncClassFile("func-class", cl::init(""), 
+                                           cl::desc("the function class data file"), cl::value_desc("path"));
+
+static llvm::cl::opt<string> LoadThread("load-thread", cl::init(""), 
+                                        cl::desc("parse the modules on threads, one LLVMContext each"), cl::value_desc("number"));
+
+static llvm::cl::opt<string> LazyLoad("lazy-load", cl::init(""), 
+                                      cl::desc("materialize only the function bodies reachable from main"), cl::value_desc("0/1"));
+
+static llvm::cl::opt<string> Pipeline("pipeline", cl::init(""), 
+                                      cl::desc("collect the constraints of a module while the later ones are parsed"), cl::value_desc("0/1"));
+
+static llvm::cl::opt<string> Server("server", cl::init(""), 
+                                    cl::desc("keep the analysis resident and answer requests on a unix socket"), cl::value_desc("socket path"));
+
+static llvm::cl::opt<string> CheckpointDir("checkpoint-dir", cl::init(""), 
+                                           cl::desc("write a checkpoint after the load, points-to and ddg phases"), cl::value_desc("directory"));
+
+static llvm::cl::opt<string> ResumeFrom("resume-from", cl::init(""), 
+                                        cl::desc("restart after the latest checkpoint of the same inputs and settings"), cl::value_desc("directory"));
+
 
 
 VOID GetModulePath (vector<string> &ModulePathVec)
@@ -76,11 +141,67 @@ string GetCaseName (string FileName)
     return FileName.substr(0, Pos);
 }
 
+VOID RunChecks (ModuleManage &ModuleMng, vector<string> &ModulePathVec)
+{
+    string CaseName = "";
+    if (MemLeakTest == "1")
+    {
+        if (InputFilename != "-" && InputFilename != "")
+        {
+            CaseName = GetCaseName(ModulePathVec[0]);
+        }
+        else
+        {
+            /* a multi-module case is named after its directory */
+            string ModuleDir = InputDirectory;
+            while (ModuleDir.size () > 1 && ModuleDir.back () == '/')
+            {
+                ModuleDir.pop_back ();
+            }
+            CaseName = ModuleDir.substr (ModuleDir.find_last_of ('/') + 1);
+        }
+    }
+
+    MemCheck McPass (CaseName);
+    McPass.runOnModule (ModuleMng);
+
+    ModuleMng.GetFuncClass ()->PrintStat ();
+    printf("Total Memory usage:%u (K)\r\n", Stat::GetPhyMemUse ());
+
+    /* the graph of the first run answers the requests till shutdown */
+    string SockPath = llaf::GetParaValue (PARA_SERVER);
+    if (SockPath != "")
+    {
+        AnalysisServer AlzServer (ModuleMng, McPass.GetDgGraph (), McPass.GetMemLeak ());
+        if (AlzServer.Start (SockPath))
+        {
+            AlzServer.Run ();
+        }
+    }
+
+    return;
+}
+
 VOID RunPasses (vector<string> &ModulePathVec)
 {
+    /* the lazy bodies are materialized after all modules, they can not be collected on the way */
+    if (llaf::GetParaValue (PARA_PIPELINE) == "1" &&
+        llaf::GetParaValue (PARA_PREPROFESS) != "1" && llaf::GetParaValue (PARA_LAZY_LOAD) != "1")
+    {
+        Stat::StartTime ("LoadAndersen");
+        ModuleManage ModuleMng;
+        PointsTo PtsTo (ModuleMng, T_ANDRESEN, ModulePathVec);
+        Stat::EndTime ("LoadAndersen");
+        Checkpoint::StoreModules (ModulePathVec);
+
+        RunChecks (ModuleMng, ModulePathVec);
+        return;
+    }
+
     Stat::StartTime ("LoadModule");
     ModuleManage ModuleMng (ModulePathVec);
     Stat::EndTime ("LoadModules");
+    Checkpoint::StoreModules (ModulePathVec);
 
     if (llaf::GetParaValue (PARA_PREPROFESS) == "1")
     {
@@ -91,17 +212,7 @@ VOID RunPasses (vector<string> &ModulePathVec)
     PointsTo PtsTo (ModuleMng, T_ANDRESEN);   
     Stat::EndTime ("Andersen");
 
-    string CaseName = "";
-    if (MemLeakTest == "1")
-    {
-        CaseName = GetCaseName(ModulePathVec[0]);
-    }
-
-    MemCheck McPass (CaseName);
-    McPass.runOnModule (ModuleMng);
-
-    printf("Total Memory usage:%u (K)\r\n", Stat::GetPhyMemUse ());
-
+    RunChecks (ModuleMng, ModulePathVec);
     return;
 }
 
@@ -123,6 +234,153 @@ VOID GetParas(int argc, char ** argv)
         llaf::SetParaValue (Para, Value);    
     }
 
+    if (DdgSnapshot != "")
+    {
+        std::string Para  = PARA_DDG_SNAPSHOT;
+        std::string Value = DdgSnapshot;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (DdgIncremental != "")
+    {
+        std::string Para  = PARA_DDG_INCREMENTAL;
+        std::string Value = DdgIncremental;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (LazyDdg != "")
+    {
+        std::string Para  = PARA_LAZY_DDG;
+        std::string Value = LazyDdg;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (GlobalHub != "")
+    {
+        std::string Para  = PARA_GLOBAL_HUB;
+        std::string Value = GlobalHub;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (ThreadNum != "")
+    {
+        std::string Para  = PARA_THREAD_NUM;
+        std::string Value = ThreadNum;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (DdgReachIdx != "")
+    {
+        std::string Para  = PARA_DDG_REACH;
+        std::string Value = DdgReachIdx;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (PathEngine != "")
+    {
+        std::string Para  = PARA_PATH_ENGINE;
+        std::string Value = PathEngine;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (SrcTime != "")
+    {
+        std::string Para  = PARA_SRC_TIME;
+        std::string Value = SrcTime;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (SrcNodes != "")
+    {
+        std::string Para  = PARA_SRC_NODES;
+        std::string Value = SrcNodes;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (SrcPaths != "")
+    {
+        std::string Para  = PARA_SRC_PATHS;
+        std::string Value = SrcPaths;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (TotalTime != "")
+    {
+        std::string Para  = PARA_TOTAL_TIME;
+        std::string Value = TotalTime;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (FwdBatchMin != "")
+    {
+        std::string Para  = PARA_FWD_BATCH;
+        std::string Value = FwdBatchMin;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (FreeSumOpt != "")
+    {
+        std::string Para  = PARA_FREE_SUM;
+        std::string Value = FreeSumOpt;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (Checkers != "")
+    {
+        std::string Para  = PARA_CHECKERS;
+        std::string Value = Checkers;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (FuncClassFile != "")
+    {
+        std::string Para  = PARA_FUNC_CLASS;
+        std::string Value = FuncClassFile;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (LoadThread != "")
+    {
+        std::string Para  = PARA_LOAD_THREAD;
+        std::string Value = LoadThread;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (LazyLoad != "")
+    {
+        std::string Para  = PARA_LAZY_LOAD;
+        std::string Value = LazyLoad;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (Pipeline != "")
+    {
+        std::string Para  = PARA_PIPELINE;
+        std::string Value = Pipeline;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (Server != "")
+    {
+        std::string Para  = PARA_SERVER;
+        std::string Value = Server;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (CheckpointDir != "")
+    {
+        std::string Para  = PARA_CHECKPOINT_DIR;
+        std::string Value = CheckpointDir;
+        llaf::SetParaValue (Para, Value);    
+    }
+
+    if (ResumeFrom != "")
+    {
+        std::string Para  = PARA_RESUME_FROM;
+        std::string Value = ResumeFrom;
+        llaf::SetParaValue (Para, Value);    
+    }
+
     return;
 }
 
@@ -145,11 +403,18 @@ int main(int argc, char ** argv)
     GetParas(argc, argv);
   
     GetModulePath(ModulePathVec);
+    if (ModulePathVec.size() == 0)
+    {
+        /* a resumed run takes the modules of its checkpoint */
+        Checkpoint::LoadModules (ModulePathVec);
+    }
+    
     if (ModulePathVec.size() == 0)
     {
         errs()<<"get none module paths!!\n";
         return 0;
     }
+    Checkpoint::Init ();
     
     RunPasses (ModulePathVec);
 
@@ -13,19 +13,21 @@ bool MemCheck::runOnModule(ModuleManage& ModMng)
 {
     Stat::StartTime ("Compute MemCheck");
 
-    DgGraph *Dg = new DgGraph (ModMng);
+    m_Dg = new DgGraph (ModMng);
 
-    m_MemLeak = new MemLeak(Dg);
-    assert (m_MemLeak != NULL);
+    /* every checker runs on the one graph */
+    m_Registry = new CheckerRegistry (m_Dg);
+    m_Registry->Run (llaf::GetParaValue (PARA_CHECKERS));
+    m_MemLeak = m_Registry->GetMemLeak ();
 
-    printf ("#==========================================================\r\n");
-    printf ("#start mempory leak detection....\r\n");
-    printf ("#==========================================================\r\n");
-    m_MemLeak->RunDetector ();
+    if (llaf::GetParaValue (PARA_LAZY_DDG) == "verify")
+    {
+        m_Dg->VerifyLazyDdg (ModMng);
+    }
 
     Stat::EndTime ("Compute MemCheck");
 
-    if (m_CaseName != "")
+    if (m_CaseName != "" && m_MemLeak != NULL)
     {
         CaseAssert();        
     }
@@ -68,6 +70,9 @@ VOID MemCheck::InitCase ()
     CaseName = "case10";
     m_CaseSet[CaseName].insert(map<string, DWORD>::value_type ("line: 29 file: source/main.c", REACH_PARITAL));
 
+    CaseName = "fieldpara";
+    m_CaseSet[CaseName].insert(map<string, DWORD>::value_type ("line: 5 file: init.c", REACH_ALL));
+
     CaseName = "malloc0";
     m_CaseSet[CaseName].insert(map<string, DWORD>::value_type ("line: 12 file: malloc0.c", REACH_NONE));
     m_CaseSet[CaseName].insert(map<string, DWORD>::value_type ("line: 13 file: malloc0.c", REACH_NONE));
@@ -299,6 +304,10 @@ VOID MemCheck::InitCase ()
     CaseName = "malloc63.c";
     m_CaseSet[CaseName].insert(map<string, DWORD>::value_type ("line: 17 file: malloc63.c", REACH_PARITAL));
 
+    /* generated by tools/PcaMem/cases/deepchain.sh, deeper than a recursive traversal goes */
+    CaseName = "deepchain.c";
+    m_CaseSet[CaseName].insert(map<string, DWORD>::value_type ("line: 5 file: deepchain.c", REACH_ALL));
+
 }
 
 VOID MemCheck::AssertPrint (bool Con, string Msg)
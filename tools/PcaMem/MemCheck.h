@@ -8,6 +8,7 @@
 #include <llvm/IR/Instructions.h>
 #include "common/VisitDir.h"
 #include "app/leakdetect/MemLeak.h"
+#include "app/CheckerRegistry.h"
 #include "llvmadpt/ModuleSet.h"
 
 class MemCheck 
@@ -17,6 +18,8 @@ public:
     typedef map<string, T_Case> T_CaseSet;
     
 private:
+    DgGraph *m_Dg;
+    CheckerRegistry *m_Registry;
     MemLeak *m_MemLeak;
     string m_CaseName;
 
@@ -26,7 +29,9 @@ public:
 
     MemCheck(string CaseName="")
     {
-        m_MemLeak = NULL;
+        m_Dg       = NULL;
+        m_Registry = NULL;
+        m_MemLeak  = NULL;
         if (CaseName != "")
         {
             m_CaseName = CaseName;
@@ -36,14 +41,31 @@ public:
 
     ~MemCheck()
     {
-        if (m_MemLeak != NULL)
+        /* the checkers use the graph till they are released */
+        if (m_Registry != NULL)
         {
-            delete m_MemLeak;
+            delete m_Registry;
+        }
+
+        if (m_Dg != NULL)
+        {
+            delete m_Dg;
         }
     }
 
     bool runOnModule(ModuleManage& ModMng);
 
+    /* the graph and the checkers stay resident for the analysis server */
+    inline DgGraph* GetDgGraph ()
+    {
+        return m_Dg;
+    }
+
+    inline MemLeak* GetMemLeak ()
+    {
+        return m_MemLeak;
+    }
+
     virtual llvm::StringRef getPassName() const 
     {
         return "Memcheck Pass";
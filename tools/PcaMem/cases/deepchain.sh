@@ -0,0 +1,30 @@
+#  !bash
+# generate the memleak case deepchain.c: main allocates at line 5 and the
+# buffer is freed at the end of a call chain of DEPTH functions, deeper than
+# a recursive traversal can go on the default 8M stack.
+# type './deepchain.sh [depth]', then 'PcaMem -file deepchain.c.bc -memleak-cases automatically test=1'
+
+DEPTH=${1:-20000}
+CASE="deepchain.c"
+
+{
+echo "#include <stdlib.h>"
+echo "void f0 (char *p);"
+echo "int main ()"
+echo "{"
+echo "    char *p = (char *)malloc (16);"
+echo "    f0 (p);"
+echo "    return 0;"
+echo "}"
+
+Index=0
+while [ $Index -lt $DEPTH ]
+do
+    Next=$((Index+1))
+    echo "void f$Next (char *p); void f$Index (char *p) { f$Next (p); }"
+    Index=$Next
+done
+echo "void f$DEPTH (char *p) { free (p); }"
+} > $CASE
+
+clang -flto -g -c $CASE -o $CASE.bc
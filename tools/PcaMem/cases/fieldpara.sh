@@ -0,0 +1,35 @@
+#  !bash
+# generate the multi-module memleak case fieldpara/: init () in init.c defines
+# a field of the caller's struct through its pointer parameter at line 5, and
+# main () in main.c frees that field, so the edge crosses the two modules.
+# type './fieldpara.sh', then 'PcaMem -dir fieldpara -load-thread=2 -memleak-cases automatically test=1'
+
+CASE="fieldpara"
+
+mkdir -p $CASE
+cd $CASE
+
+{
+echo "#include <stdlib.h>"
+echo "struct S { int n; char *p; };"
+echo "void init (struct S *s)"
+echo "{"
+echo "    s->p = (char *)malloc (16);"
+echo "}"
+} > init.c
+
+{
+echo "#include <stdlib.h>"
+echo "struct S { int n; char *p; };"
+echo "void init (struct S *s);"
+echo "int main ()"
+echo "{"
+echo "    struct S s;"
+echo "    init (&s);"
+echo "    free (s.p);"
+echo "    return 0;"
+echo "}"
+} > main.c
+
+clang -flto -g -c init.c -o init.preopt.bc
+clang -flto -g -c main.c -o main.preopt.bc
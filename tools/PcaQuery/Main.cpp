@@ -0,0 +1,178 @@
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "common/BasicMacro.h"
+#include "common/Stat.h"
+
+
+using namespace std;
+
+
+/*
+   client of PcaMem -server=<socket>:
+     PcaQuery <socket> <request>     one request, e.g. PcaQuery /tmp/pca.sock pts main.c:12
+     PcaQuery <socket>               requests read from stdin, one per line
+*/
+
+static int Connect (const CHAR *Path)
+{
+    struct sockaddr_un Addr;
+    if (strlen (Path) >= sizeof (Addr.sun_path))
+    {
+        printf ("socket path %s is too long\r\n", Path);
+        return -1;
+    }
+
+    int Conn = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (Conn < 0)
+    {
+        return -1;
+    }
+
+    memset (&Addr, 0, sizeof (Addr));
+    Addr.sun_family = AF_UNIX;
+    strncpy (Addr.sun_path, Path, sizeof (Addr.sun_path) - 1);
+    if (connect (Conn, (struct sockaddr *)&Addr, sizeof (Addr)) != 0)
+    {
+        printf ("connect %s fail, errno = %d\r\n", Path, errno);
+        close (Conn);
+        return -1;
+    }
+
+    return Conn;
+}
+
+static BOOL SendAll (int Conn, const string &Data)
+{
+    size_t Sent = 0;
+    while (Sent < Data.size ())
+    {
+        /* a peer that went away must fail the send, not raise SIGPIPE */
+        ssize_t Len = send (Conn, Data.data () + Sent, Data.size () - Sent, MSG_NOSIGNAL);
+        if (Len <= 0)
+        {
+            if (Len < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            return AF_FALSE;
+        }
+
+        Sent += Len;
+    }
+
+    return AF_TRUE;
+}
+
+/* print the reply till its "OK <us>" or "ERR <reason>" line */
+static BOOL RecvReply (int Conn, string &Buffer)
+{
+    CHAR Data[4096];
+
+    while (1)
+    {
+        size_t Pos = Buffer.find ('\n');
+        if (Pos == string::npos)
+        {
+            ssize_t Len = read (Conn, Data, sizeof (Data));
+            if (Len < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else if (Len <= 0)
+            {
+                printf ("connection closed by the server\r\n");
+                return AF_FALSE;
+            }
+
+            Buffer.append (Data, Len);
+            continue;
+        }
+
+        string Line = Buffer.substr (0, Pos);
+        Buffer.erase (0, Pos + 1);
+        if (Line.compare (0, 3, "OK ") == 0)
+        {
+            printf ("[server %s (us)]\r\n", Line.substr (3).c_str ());
+            return AF_TRUE;
+        }
+        else if (Line.compare (0, 4, "ERR ") == 0)
+        {
+            printf ("error: %s\r\n", Line.substr (4).c_str ());
+            return AF_TRUE;
+        }
+
+        printf ("%s\r\n", Line.c_str ());
+    }
+}
+
+static BOOL Query (int Conn, string Request, string &Buffer)
+{
+    DWORD StartTime = Stat::GetWallTime ();
+    if (!SendAll (Conn, Request + "\n"))
+    {
+        return AF_FALSE;
+    }
+
+    /* nothing comes back of a quit */
+    if (Request == "quit")
+    {
+        return AF_FALSE;
+    }
+
+    BOOL Ret = RecvReply (Conn, Buffer);
+    printf ("[round trip %u (ms)]\r\n", Stat::GetWallTime () - StartTime);
+
+    return Ret && Request != "shutdown";
+}
+
+int main(int argc, char ** argv)
+{
+    if (argc < 2)
+    {
+        printf ("usage: %s <socket> [pts <file>:<line> | leak <function> | slice <file>:<line> | stat | shutdown]\r\n", argv[0]);
+        return 0;
+    }
+
+    int Conn = Connect (argv[1]);
+    if (Conn < 0)
+    {
+        return 1;
+    }
+
+    string Buffer;
+    if (argc > 2)
+    {
+        string Request = argv[2];
+        for (int Index = 3; Index < argc; Index++)
+        {
+            Request = Request + " " + argv[Index];
+        }
+
+        Query (Conn, Request, Buffer);
+    }
+    else
+    {
+        CHAR Line[4096];
+        while (fgets (Line, sizeof (Line), stdin) != NULL)
+        {
+            string Request = Line;
+            size_t End = Request.find_last_not_of (" \t\r\n");
+            if (End == string::npos)
+            {
+                continue;
+            }
+
+            if (!Query (Conn, Request.substr (0, End + 1), Buffer))
+            {
+                break;
+            }
+        }
+    }
+
+    close (Conn);
+    return 0;
+}